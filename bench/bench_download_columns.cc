@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Compares the columnar filter and sort plans against row-at-a-time
+// evaluation through per-field slots, which is what the command path
+// boils down to once the command lookup is done.
+//
+// Usage: bench_download_columns [downloads] [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/download_columns.h"
+#include "rpc/parse.h"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+using columns    = core::DownloadColumns;
+
+torrent::Object
+parse(const std::string& str) {
+  torrent::Object result;
+  rpc::parse_object(str.c_str(), str.c_str() + str.size(), &result);
+
+  return result;
+}
+
+template<typename Func>
+void
+run(const char* name, size_t rows, unsigned int iterations, Func func) {
+  func();
+
+  auto start = clock_type::now();
+
+  for (unsigned int i = 0; i < iterations; i++)
+    func();
+
+  double seconds =
+    std::chrono::duration<double>(clock_type::now() - start).count() /
+    iterations;
+
+  std::printf("%-28s %10.3f ms %14.0f rows/s\n",
+              name,
+              seconds * 1000,
+              rows / seconds);
+}
+
+}
+
+int
+main(int argc, char** argv) {
+  size_t       size       = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 0;
+  unsigned int iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+
+  size       = size != 0 ? size : 100000;
+  iterations = iterations != 0 ? iterations : 20;
+
+  // Only used for distinct, ordered download addresses.
+  std::vector<char>            storage(size);
+  std::vector<core::Download*> downloads(size);
+  columns                      snapshot;
+  std::mt19937_64              rng(size);
+
+  snapshot.reserve(size);
+
+  for (size_t i = 0; i < size; i++) {
+    columns::value_type values[columns::COLUMN_MAX_SIZE];
+
+    for (auto& value : values)
+      value = rng() % 4096;
+
+    values[columns::COLUMN_STATE]    = rng() % 2;
+    values[columns::COLUMN_COMPLETE] = rng() % 2;
+
+    downloads[i] = reinterpret_cast<core::Download*>(&storage[i]);
+    snapshot.push_back(downloads[i], values);
+  }
+
+  // Stand-ins for the command slots, one indirect call per field read.
+  std::vector<std::function<int64_t(size_t)>> slots;
+
+  for (int c = 0; c < columns::COLUMN_MAX_SIZE; c++)
+    slots.emplace_back(
+      [&snapshot, c](size_t row) { return snapshot.column(c)[row]; });
+
+  std::printf("%zu downloads, %u iterations\n\n", size, iterations);
+
+  core::column_filter filter;
+  columns::mask_type  mask;
+
+  if (!columns::compile_filter(
+        parse("((and,((d.state)),((greater,((d.up.rate)),((value,1024))))))"),
+        &filter))
+    return EXIT_FAILURE;
+
+  run("filter columnar", size, iterations, [&] {
+    snapshot.filter(filter, &mask);
+  });
+
+  run("filter row-wise", size, iterations, [&] {
+    for (size_t i = 0; i < size; i++) {
+      size_t row = snapshot.find(downloads[i]);
+
+      mask[row] = slots[columns::COLUMN_STATE](row) &&
+                  slots[columns::COLUMN_UP_RATE](row) > 1024;
+    }
+  });
+
+  core::column_sort            sort;
+  std::vector<core::Download*> shuffled = downloads;
+  std::vector<core::Download*> sorted;
+
+  if (!columns::compile_sort(parse("((compare,-+,d.complete=,d.up.rate=))"),
+                             &sort))
+    return EXIT_FAILURE;
+
+  std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+  run("sort columnar", size, iterations, [&] {
+    sorted = shuffled;
+    snapshot.sort(sort, sorted.begin(), sorted.end());
+  });
+
+  run("sort row-wise", size, iterations, [&] {
+    auto compare = [&](core::Download* d1, core::Download* d2) {
+      size_t row1 = snapshot.find(d1);
+      size_t row2 = snapshot.find(d2);
+
+      int64_t complete1 = slots[columns::COLUMN_COMPLETE](row1);
+      int64_t complete2 = slots[columns::COLUMN_COMPLETE](row2);
+
+      if (complete1 != complete2)
+        return complete1 > complete2;
+
+      int64_t rate1 = slots[columns::COLUMN_UP_RATE](row1);
+      int64_t rate2 = slots[columns::COLUMN_UP_RATE](row2);
+
+      if (rate1 != rate2)
+        return rate1 < rate2;
+
+      return std::less<>()(d1, d2);
+    };
+
+    sorted = shuffled;
+    std::stable_sort(sorted.begin(), sorted.end(), compare);
+  });
+
+  return EXIT_SUCCESS;
+}
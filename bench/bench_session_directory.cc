@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Compares listing a session directory through utils::Directory, one
+// readdir() call and string per entry followed by filtering, with
+// utils::DirectoryNames filtering names as getdents64 returns them.
+//
+// The directory is filled with the three files of each session torrent
+// and is removed afterwards, unless an existing directory is given.
+//
+// Usage: bench_session_directory [entries] [iterations] [directory]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "core/download_store.h"
+#include "utils/directory.h"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+template<typename Func>
+void
+run(const char* name, unsigned int iterations, Func func) {
+  size_t found = func();
+
+  auto start = clock_type::now();
+
+  for (unsigned int i = 0; i < iterations; i++)
+    func();
+
+  double seconds =
+    std::chrono::duration<double>(clock_type::now() - start).count() /
+    iterations;
+
+  std::printf("%-28s %10.3f ms %10zu found\n", name, seconds * 1000, found);
+}
+
+std::vector<std::string>
+create_entries(const std::string& path, size_t size) {
+  const char* const suffixes[] = { "", ".rtorrent", ".libtorrent_resume" };
+  const char        hex[]      = "0123456789ABCDEF";
+
+  std::vector<std::string> names;
+  std::mt19937_64          rng(size);
+
+  while (names.size() < size) {
+    std::string hash;
+
+    for (int i = 0; i < 40; i++)
+      hash += hex[rng() % 16];
+
+    for (const char* suffix : suffixes)
+      names.push_back(hash + ".torrent" + suffix);
+  }
+
+  names.resize(size);
+
+  for (const auto& name : names) {
+    int fd = ::open((path + name).c_str(), O_WRONLY | O_CREAT, 0600);
+
+    if (fd == -1) {
+      std::perror(name.c_str());
+      std::exit(1);
+    }
+
+    ::close(fd);
+  }
+
+  return names;
+}
+
+}
+
+int
+main(int argc, char** argv) {
+  size_t       size       = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 0;
+  unsigned int iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+
+  size       = size != 0 ? size : 200000;
+  iterations = iterations != 0 ? iterations : 10;
+
+  std::string              path;
+  std::vector<std::string> created;
+
+  if (argc > 3) {
+    path = std::string(argv[3]) + '/';
+  } else {
+    char temp[] = "/tmp/rtorrent_bench_session_XXXXXX";
+
+    if (::mkdtemp(temp) == nullptr) {
+      std::perror("mkdtemp");
+      return 1;
+    }
+
+    path    = std::string(temp) + '/';
+    created = create_entries(path, size);
+  }
+
+  run("Directory::update", iterations, [&path]() {
+    utils::Directory d(path);
+    d.update(utils::Directory::update_hide_dot);
+
+    d.erase(std::remove_if(d.begin(),
+                           d.end(),
+                           [](const utils::directory_entry& entry) {
+                             return !core::DownloadStore::is_correct_format(
+                               entry.d_name);
+                           }),
+            d.end());
+
+    return d.size();
+  });
+
+  run("DirectoryNames::update", iterations, [&path]() {
+    utils::DirectoryNames names;
+    names.update(path,
+                 utils::DirectoryNames::update_hide_dot,
+                 [](const char* name, size_t length) {
+                   return core::DownloadStore::is_correct_format(name, length);
+                 });
+
+    return names.size();
+  });
+
+  run("DirectoryNames::update all", iterations, [&path]() {
+    utils::DirectoryNames names;
+    names.update(path, utils::DirectoryNames::update_hide_dot);
+
+    return names.size();
+  });
+
+  if (!created.empty()) {
+    for (const auto& name : created)
+      ::unlink((path + name).c_str());
+
+    ::rmdir(path.c_str());
+  }
+
+  return 0;
+}
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Throughput of passing closures with a small payload from several
+// producer threads to one consumer, through utils::MpscQueue as used
+// by ThreadBase::queue_item(), and through a mutex-guarded deque of
+// std::function for comparison.
+//
+// Usage: bench_thread_queue [items per producer] [max producers]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/mpsc_queue.h"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+class item_base : public utils::MpscQueueNode {
+public:
+  virtual ~item_base() = default;
+  virtual void call(size_t* sum) = 0;
+};
+
+template<typename Func>
+class item_func : public item_base {
+public:
+  explicit item_func(Func func)
+    : m_func(std::move(func)) {}
+
+  void call(size_t* sum) override {
+    m_func(sum);
+  }
+
+private:
+  Func m_func;
+};
+
+template<typename Func>
+item_base*
+make_item(Func func) {
+  return new item_func<Func>(std::move(func));
+}
+
+class mutex_queue {
+public:
+  using func_type = std::function<void(size_t*)>;
+
+  void push(func_type func) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(std::move(func));
+  }
+
+  // Takes everything queued so far, as a consumer would per wakeup.
+  std::deque<func_type> take() {
+    std::deque<func_type> result;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    result.swap(m_queue);
+
+    return result;
+  }
+
+private:
+  std::mutex            m_mutex;
+  std::deque<func_type> m_queue;
+};
+
+template<typename Produce, typename Consume>
+void
+run(const char* name,
+    unsigned int producers,
+    size_t       items,
+    Produce      produce,
+    Consume      consume) {
+  auto start = clock_type::now();
+
+  std::vector<std::thread> threads;
+
+  for (unsigned int p = 0; p < producers; p++)
+    threads.emplace_back([&produce, items] { produce(items); });
+
+  size_t total = producers * items;
+  size_t sum   = 0;
+
+  for (size_t received = 0; received != total;)
+    received += consume(&sum);
+
+  for (auto& thread : threads)
+    thread.join();
+
+  double seconds =
+    std::chrono::duration<double>(clock_type::now() - start).count();
+
+  std::printf("%-12s %2u producers %10.3f ms %14.0f items/s\n",
+              name,
+              producers,
+              seconds * 1000,
+              total / seconds);
+}
+
+}
+
+int
+main(int argc, char** argv) {
+  size_t       items = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 0;
+  unsigned int max   = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+
+  items = items != 0 ? items : 1000000;
+  max   = max != 0 ? max : 8;
+
+  for (unsigned int producers = 1; producers <= max; producers *= 2) {
+    utils::MpscQueue<item_base> queue;
+
+    run(
+      "MpscQueue",
+      producers,
+      items,
+      [&queue](size_t count) {
+        for (size_t i = 0; i < count; i++) {
+          std::string payload(32, 'a');
+          queue.push(make_item([payload = std::move(payload)](size_t* sum) {
+            *sum += payload.size();
+          }));
+        }
+      },
+      [&queue](size_t* sum) {
+        size_t received = 0;
+
+        while (item_base* item = queue.pop()) {
+          std::unique_ptr<item_base> owned(item);
+          owned->call(sum);
+          received++;
+        }
+
+        return received;
+      });
+
+    mutex_queue locked;
+
+    run(
+      "mutex deque",
+      producers,
+      items,
+      [&locked](size_t count) {
+        for (size_t i = 0; i < count; i++) {
+          std::string payload(32, 'a');
+          locked.push([payload = std::move(payload)](size_t* sum) {
+            *sum += payload.size();
+          });
+        }
+      },
+      [&locked](size_t* sum) {
+        size_t received = 0;
+
+        for (auto& func : locked.take()) {
+          func(sum);
+          received++;
+        }
+
+        return received;
+      });
+  }
+
+  return 0;
+}
@@ -27,6 +27,21 @@ if(USE_RUNTIME_CA_DETECTION)
   file(APPEND ${BUILDINFO_H} "#define RT_USE_RUNTIME_CA_DETECTION 1\n\n")
 endif()
 
+if(USE_TRACING)
+  file(APPEND ${BUILDINFO_H} "/* Request tracing instrumentation */\n")
+  file(APPEND ${BUILDINFO_H} "#define RT_USE_TRACING 1\n\n")
+endif()
+
+if(USE_USDT)
+  file(APPEND ${BUILDINFO_H} "/* USDT static tracepoints */\n")
+  file(APPEND ${BUILDINFO_H} "#define RT_USE_USDT 1\n\n")
+endif()
+
+if(USE_ALLOCATION_COUNT)
+  file(APPEND ${BUILDINFO_H} "/* Per-thread count of allocations */\n")
+  file(APPEND ${BUILDINFO_H} "#define RT_USE_ALLOCATION_COUNT 1\n\n")
+endif()
+
 if(USE_JSONRPC)
   file(APPEND ${BUILDINFO_H} "/* Support for JSON-RPC */\n")
   file(APPEND ${BUILDINFO_H} "#define HAVE_JSON 1\n\n")
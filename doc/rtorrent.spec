@@ -16,6 +16,7 @@ rm -rf %{buildroot}
 
 mkdir -p %{buildroot}%{_bindir}/
 install -m 755 ./usr/bin/rtorrent %{buildroot}%{_bindir}/rtorrent
+install -m 755 ./usr/bin/rtorrent-stats %{buildroot}%{_bindir}/rtorrent-stats
 
 cp -rf ./etc %{buildroot}/
 
@@ -24,5 +25,6 @@ rm -rf %{buildroot}
 
 %files
 %attr(0755, root, root) %{_bindir}/rtorrent
+%attr(0755, root, root) %{_bindir}/rtorrent-stats
 %attr(0644, root, root) /etc/systemd/system/rtorrent@.service
 %attr(0644, root, root) /etc/rtorrent/rtorrent.rc
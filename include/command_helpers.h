@@ -31,6 +31,16 @@ cleanup_commands();
   rpc::commands.insert_slot<rpc::command_base_is_type<rpc::function>::type>(   \
     key, slot, &rpc::function, rpc::CommandMap::flag_dont_delete, NULL, NULL);
 
+#define CMD2_A_FUNCTION_NO_LOCK(key, function, slot, parm, doc)                \
+  rpc::commands.insert_slot<rpc::command_base_is_type<rpc::function>::type>(   \
+    key,                                                                       \
+    slot,                                                                      \
+    &rpc::function,                                                            \
+    rpc::CommandMap::flag_dont_delete | rpc::CommandMap::flag_public |         \
+      rpc::CommandMap::flag_no_target | rpc::CommandMap::flag_no_lock,         \
+    NULL,                                                                      \
+    NULL);
+
 #define CMD2_ANY(key, slot)                                                    \
   CMD2_A_FUNCTION(key, command_base_call<rpc::target_type>, slot, "i:", "")
 
@@ -81,6 +91,13 @@ cleanup_commands();
 #define CMD2_ANY_LIST(key, slot)                                               \
   CMD2_A_FUNCTION(key, command_base_call_list<rpc::target_type>, slot, "i:", "")
 
+#define CMD2_ANY_NO_LOCK(key, slot)                                            \
+  CMD2_A_FUNCTION_NO_LOCK(                                                     \
+    key, command_base_call<rpc::target_type>, slot, "i:", "")
+#define CMD2_ANY_LIST_NO_LOCK(key, slot)                                       \
+  CMD2_A_FUNCTION_NO_LOCK(                                                     \
+    key, command_base_call_list<rpc::target_type>, slot, "i:", "")
+
 #define CMD2_DL(key, slot)                                                     \
   CMD2_A_FUNCTION(key, command_base_call<core::Download*>, slot, "i:", "")
 #define CMD2_DL_V(key, slot)                                                   \
@@ -7,8 +7,12 @@
 #include <atomic>
 #include <cinttypes>
 
+#include <string>
+#include <vector>
+
 #include <sys/types.h>
 
+#include <torrent/object.h>
 #include <torrent/torrent.h>
 #include <torrent/utils/cacheline.h>
 #include <torrent/utils/priority_queue_default.h>
@@ -62,6 +66,39 @@ public:
 
   void handle_shutdown();
 
+  // With a deadline, shutdown completes at most that many seconds
+  // after it started, instead of waiting for stop announces and other
+  // requests to finish. The final session save then syncs the file
+  // system once rather than each file. Zero disables it.
+  uint32_t shutdown_deadline() const {
+    return m_shutdownDeadline;
+  }
+  void set_shutdown_deadline(uint32_t seconds) {
+    m_shutdownDeadline = seconds;
+  }
+
+  // Saves the session after the main loop has exited, and reports how
+  // long each phase of the shutdown took.
+  void shutdown_save();
+
+  // Replaces the process with a new instance of the executable, which
+  // takes over the downloads, the listening port and the SCGI socket
+  // without stopping or announcing. Done shortly after the call, so
+  // that the RPC reply can be sent, and not while commands started by
+  // 'execute.async' are running.
+  void receive_restart();
+
+  // The arguments the executable is started with again on restart.
+  void set_arguments(int argc, char** argv);
+
+  // State passed on by the process this one replaced, if any. Parts
+  // are taken as startup picks them up, and the rest is released by
+  // release_handoff() once startup is done.
+  torrent::Object& handoff() {
+    return m_handoff;
+  }
+  void release_handoff();
+
   void receive_normal_shutdown() {
     m_shutdownReceived = true;
   }
@@ -120,6 +157,8 @@ private:
   Control(const Control&);
   void operator=(const Control&);
 
+  void handle_restart();
+
   std::atomic<bool> lt_cacheline_aligned m_shutdownReceived{ false };
 
   core::Manager*     m_core;
@@ -142,6 +181,15 @@ private:
   std::string m_workingDirectory;
 
   torrent::utils::priority_item m_taskShutdown;
+  torrent::utils::priority_item m_taskRestart;
+
+  std::vector<std::string> m_arguments;
+  torrent::Object          m_handoff;
+
+  uint32_t              m_shutdownDeadline{ 0 };
+  torrent::utils::timer m_shutdownStart;
+  torrent::utils::timer m_shutdownStopped;
+  torrent::utils::timer m_shutdownCompleted;
 };
 
 #endif
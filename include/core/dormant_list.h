@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Stopped session torrents that are kept as lightweight records
+// instead of downloads, when enabled with 'session.dormant.set'.
+//
+// The session data stays in the session directory or pack, and is
+// loaded as a regular download by wake(). Dormant torrents are not in
+// the download list or in any view, so 'd.multicall2' and the UI do
+// not list them, and they are untouched by session saves. RPC calls on
+// a dormant torrent's hash wake it first, and 'session.dormant.list'
+// returns their hashes.
+
+#ifndef RTORRENT_CORE_DORMANT_LIST_H
+#define RTORRENT_CORE_DORMANT_LIST_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <torrent/object.h>
+
+namespace core {
+
+class Download;
+
+class DormantList {
+public:
+  struct entry_type {
+    // The raw info hash.
+    std::string hash;
+    // The session torrent file, empty when in the pack.
+    std::string filename;
+
+    std::string name;
+    std::string directory;
+    int64_t     size_bytes{ 0 };
+    int64_t     chunks_done{ 0 };
+
+    std::array<std::string, 5>         custom_n;
+    std::map<std::string, std::string> custom;
+  };
+
+  using container_type = std::map<std::string, entry_type>;
+  using hash_list      = std::vector<std::string>;
+
+  bool is_enabled() const {
+    return m_enabled;
+  }
+  void set_enabled(bool state) {
+    m_enabled = state;
+  }
+
+  size_t size() const {
+    return m_entries.size();
+  }
+  bool has(const std::string& hash) const {
+    return m_entries.find(hash) != m_entries.end();
+  }
+
+  // Throws input_error if the hash is not dormant.
+  const entry_type& find_throw(const std::string& hash) const;
+  hash_list         hashes() const;
+
+  // Whether a decoded session torrent can be kept dormant: stopped,
+  // not waiting for a hash check and not a magnet link.
+  static bool is_dormant(const torrent::Object& object);
+
+  void insert(const std::string&     hash,
+              const std::string&     filename,
+              const torrent::Object& object);
+  void erase(const std::string& hash) {
+    m_entries.erase(hash);
+  }
+
+  // The entries as a list of maps, passed on by 'system.restart'.
+  torrent::Object save_list() const;
+  void            load_list(const torrent::Object& list);
+
+  // Loads the session torrent as a download and returns it, or
+  // nullptr if the hash is not dormant or the download could not be
+  // created. The entry is only removed once the download exists.
+  Download* wake(const std::string& hash);
+
+  // Returns an empty string if 'hex' is not 40 hex digits.
+  static std::string hash_from_hex(const std::string& hex);
+
+private:
+  bool           m_enabled{ false };
+  container_type m_entries;
+};
+
+}
+
+#endif
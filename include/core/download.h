@@ -135,6 +135,24 @@ public:
   uint32_t priority();
   void     set_priority(uint32_t p);
 
+  // Whether state saved in the session has changed since the last
+  // save. Progress and transfer totals are compared with the values
+  // stored by the last save, anything else has to be flagged with
+  // set_session_dirty().
+  bool is_session_dirty();
+  void set_session_dirty(bool state = true) {
+    m_sessionDirty = state;
+  }
+
+  // Whether the download was passed on by 'system.restart' and has
+  // not been started or stopped since.
+  bool is_handed_over() const {
+    return m_handedOver;
+  }
+  void set_handed_over(bool state) {
+    m_handedOver = state;
+  }
+
   uint32_t resume_flags() {
     return m_resumeFlags;
   }
@@ -172,6 +190,8 @@ private:
   std::string   m_message;
   uint32_t      m_resumeFlags;
   unsigned int  m_group;
+  bool          m_sessionDirty{ true };
+  bool          m_handedOver{ false };
 };
 
 inline bool
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Struct-of-arrays snapshot of the numeric download fields that are
+// most commonly used by view filters and sort keys.
+//
+// Filters and sort keys made only of column commands (see
+// column_index), constants and the 'less', 'greater', 'equal',
+// 'compare', 'not', 'and', 'or', 'true' and 'false' commands are
+// compiled into a plan that is evaluated as flat loops over the
+// columns, rather than calling the command slots once per download
+// or once per comparison. Anything else is left to the regular
+// command path.
+
+#ifndef RTORRENT_CORE_DOWNLOAD_COLUMNS_H
+#define RTORRENT_CORE_DOWNLOAD_COLUMNS_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <torrent/object.h>
+
+namespace core {
+
+class Download;
+
+struct column_filter {
+  enum node_type {
+    NODE_CONSTANT,
+    NODE_COLUMN,
+    NODE_NOT,
+    NODE_AND,
+    NODE_OR,
+    NODE_LESS,
+    NODE_GREATER,
+    NODE_EQUAL
+  };
+
+  node_type                  type{ NODE_CONSTANT };
+  int                        column{ -1 };
+  int64_t                    value{ 1 };
+  std::vector<column_filter> children;
+};
+
+struct column_sort {
+  // Sort by the columns in order, optionally breaking ties on the
+  // address of the download like 'compare' does.
+  std::vector<int>  columns;
+  std::vector<bool> descending;
+  bool              tie_break{ false };
+};
+
+class DownloadColumns {
+public:
+  using value_type  = int64_t;
+  using column_type = std::vector<value_type>;
+  using mask_type   = std::vector<uint8_t>;
+
+  enum {
+    COLUMN_STATE,
+    COLUMN_COMPLETE,
+    COLUMN_HASHING,
+    COLUMN_IS_OPEN,
+    COLUMN_IS_ACTIVE,
+    COLUMN_PRIORITY,
+    COLUMN_UP_RATE,
+    COLUMN_UP_TOTAL,
+    COLUMN_DOWN_RATE,
+    COLUMN_DOWN_TOTAL,
+    COLUMN_BYTES_DONE,
+    COLUMN_COMPLETED_BYTES,
+    COLUMN_LEFT_BYTES,
+    COLUMN_SIZE_BYTES,
+    COLUMN_RATIO,
+    COLUMN_STATE_CHANGED,
+    COLUMN_TIMESTAMP_STARTED,
+    COLUMN_TIMESTAMP_FINISHED,
+
+    COLUMN_MAX_SIZE
+  };
+
+  // Returns the column of a 'd.*' command name, with or without a
+  // trailing '=', or -1 if it has none.
+  static int         column_index(const std::string& command);
+  static const char* column_name(int column);
+
+  size_t size() const {
+    return m_downloads.size();
+  }
+  bool empty() const {
+    return m_downloads.empty();
+  }
+
+  void clear();
+  void reserve(size_t size);
+
+  void push_back(Download* download);
+  void push_back(Download* download, const value_type values[COLUMN_MAX_SIZE]);
+
+  Download* download(size_t row) const {
+    return m_downloads[row];
+  }
+  const column_type& column(int column) const {
+    return m_columns[column];
+  }
+
+  // Returns the row of the download, or size() if it is not part of
+  // the snapshot.
+  size_t find(Download* download) const;
+
+  // Returns false, leaving 'dest' in an unspecified state, if the
+  // command cannot be evaluated on the columns. An empty command
+  // compiles to 'true'.
+  static bool compile_filter(const torrent::Object& cmd, column_filter* dest);
+  static bool compile_sort(const torrent::Object& cmd, column_sort* dest);
+
+  // Sets mask[row] to the result of the filter for every row.
+  void filter(const column_filter& plan, mask_type* mask) const;
+
+  // Stable sort of the range, returns false without modifying it if
+  // any of the downloads is not part of the snapshot.
+  bool sort(const column_sort&                plan,
+            std::vector<Download*>::iterator first,
+            std::vector<Download*>::iterator last) const;
+
+private:
+  void evaluate(const column_filter& node, mask_type* mask) const;
+  void evaluate_compare(const column_filter& node, mask_type* mask) const;
+
+  std::vector<Download*>                m_downloads;
+  std::unordered_map<Download*, size_t> m_rows;
+  column_type                           m_columns[COLUMN_MAX_SIZE];
+};
+
+}
+
+#endif
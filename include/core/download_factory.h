@@ -34,6 +34,11 @@ public:
   // load() or commit().
   void load(const std::string& uri);
   void load_raw_data(const std::string& input);
+  // Takes ownership of an already decoded torrent. Session data is
+  // taken from its 'rtorrent' and 'libtorrent_resume' keys rather
+  // than from files. The uri, if any, is the file it was read from.
+  void load_object(torrent::Object*   object,
+                   const std::string& uri = std::string());
   void commit();
 
   command_list_type& commands() {
@@ -53,6 +58,15 @@ public:
     m_session = v;
   }
 
+  // Downloads passed on by 'system.restart' start without announcing
+  // to their trackers, see DownloadList::start_flags().
+  bool handed_over() const {
+    return m_handedOver;
+  }
+  void set_handed_over(bool v) {
+    m_handedOver = v;
+  }
+
   bool get_start() const {
     return m_start;
   }
@@ -99,10 +113,12 @@ private:
   std::string m_uri;
   std::string m_result;
   bool        m_session{ false };
+  bool        m_handedOver{ false };
   bool        m_start{ false };
   bool        m_printLog{ true };
   bool        m_immediate{ false };
   bool        m_isFile{ false };
+  bool        m_isDecoded{ false };
 
   command_list_type         m_commands;
   torrent::Object::map_type m_variables;
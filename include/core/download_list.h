@@ -4,9 +4,16 @@
 #ifndef RTORRENT_CORE_DOWNLOAD_LIST_H
 #define RTORRENT_CORE_DOWNLOAD_LIST_H
 
+#include <cstdint>
 #include <iosfwd>
 #include <list>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "core/download_columns.h"
+#include "core/event_queue.h"
 
 namespace torrent {
 class HashString;
@@ -49,6 +56,9 @@ public:
 
   void session_save();
 
+  // Marks every download as changed since it was last saved.
+  void set_session_dirty();
+
   iterator find(const torrent::HashString& hash);
 
   iterator  find_hex(const char* hash);
@@ -76,6 +86,12 @@ public:
   void resume(Download* d, int flags = 0);
   void pause(Download* d, int flags = 0);
 
+  // The flags resume() starts a download with. A download passed on by
+  // 'system.restart' is still running as far as its trackers and files
+  // are concerned, so it is started like confirm_finished() restarts
+  // one: without an announce, creating files or resetting the baseline.
+  static int start_flags(int resume_flags, bool handed_over);
+
   void resume_default(Download* d) {
     resume(d);
   }
@@ -85,6 +101,62 @@ public:
 
   void check_hash(Download* d);
 
+  // When deferred events are enabled, download events other than
+  // 'inserted' and 'erased' are queued and dispatched at the end of
+  // the main loop tick by flush_events(). Within a tick:
+  //
+  // - Events are dispatched in the order they were last triggered.
+  // - A (download, event) pair triggered more than once is dispatched
+  //   once, at the position of its last occurrence, so that e.g. opened,
+  //   closed, opened runs as closed, opened.
+  // - Pending events of a download are dispatched when it is erased,
+  //   before 'erased'. Events its 'erased' handlers trigger are dropped.
+  // - Events triggered by handlers during the flush are dispatched
+  //   in a later pass of the same flush.
+  // - 'view.filter_download' calls made by handlers are batched and
+  //   applied once per view and download at the end of each pass.
+  bool is_deferring_events() const {
+    return m_deferEvents;
+  }
+  void set_defer_events(bool state);
+
+  void flush_events();
+
+  bool has_pending_events() const {
+    return !m_pendingEvents.empty();
+  }
+
+  uint64_t events_deferred() const {
+    return m_eventsDeferred;
+  }
+  uint64_t events_coalesced() const {
+    return m_eventsCoalesced;
+  }
+
+  // Columnar snapshot of the downloads, refreshed on first use in a
+  // main loop tick or after it has been invalidated. Download events
+  // invalidate it, other code that changes the snapshotted fields
+  // outside of a tick should call invalidate_columns().
+  DownloadColumns* columns();
+
+  void invalidate_columns() {
+    m_columnsValid = false;
+  }
+
+  // Lowercase names of the downloads, used by views to evaluate
+  // name substring filters without calling 'match' and lowercasing
+  // every name on each filter. Built when enabled and then kept up
+  // to date by insert and erase.
+  bool is_indexing_names() const {
+    return m_indexNames;
+  }
+  void set_index_names(bool state);
+
+  // Returns nullptr if names are not indexed.
+  const std::string* find_name(Download* d) const;
+
+  static std::string lowercase_name(Download* d);
+
   enum {
     D_SLOTS_INSERT,
     D_SLOTS_ERASE,
@@ -154,6 +226,26 @@ private:
   void received_inactive(Download* d);
 
   void process_meta_download(Download* d);
+
+  bool defer_event(Download* d, const char* event_name);
+  void flush_events(Download* d);
+  void drop_events(Download* d);
+
+  void call_event(const EventQueue::event_type& event);
+
+  bool                   m_deferEvents{ false };
+  EventQueue             m_pendingEvents;
+  EventQueue::queue_type m_flushingEvents;
+
+  uint64_t m_eventsDeferred{ 0 };
+  uint64_t m_eventsCoalesced{ 0 };
+
+  DownloadColumns m_columns;
+  bool            m_columnsValid{ false };
+  uint64_t        m_columnsTick{ 0 };
+
+  bool                                       m_indexNames{ false };
+  std::unordered_map<Download*, std::string> m_names;
 };
 
 }
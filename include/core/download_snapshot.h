@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Immutable copy of per-download scalar state and view memberships,
+// published by the main thread so that RPC handlers can read it
+// without taking the global lock.
+//
+// A snapshot is never modified after creation; readers keep it alive
+// through the shared_ptr returned by Manager::snapshot() for as long
+// as they need it.
+
+#ifndef RTORRENT_CORE_DOWNLOAD_SNAPSHOT_H
+#define RTORRENT_CORE_DOWNLOAD_SNAPSHOT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <torrent/object.h>
+
+#include "core/download_columns.h"
+
+namespace core {
+
+class DownloadList;
+class ViewManager;
+
+class DownloadSnapshot {
+public:
+  using value_type = DownloadColumns::value_type;
+  using view_type  = std::vector<uint32_t>;
+
+  enum {
+    FIELD_HASH = DownloadColumns::COLUMN_MAX_SIZE,
+    FIELD_NAME,
+
+    FIELD_MAX_SIZE
+  };
+
+  struct entry_type {
+    std::string hash;
+    std::string name;
+    value_type  values[DownloadColumns::COLUMN_MAX_SIZE];
+  };
+
+  static std::shared_ptr<const DownloadSnapshot> create(DownloadList* list,
+                                                        ViewManager*  views,
+                                                        uint64_t      tick);
+
+  // Returns the field of a 'd.*' command name, with or without a
+  // trailing '=', or -1 if it is not part of the snapshot.
+  static int field_index(const std::string& command);
+
+  uint64_t tick() const {
+    return m_tick;
+  }
+  // Microseconds, as torrent::utils::timer::usec().
+  int64_t time() const {
+    return m_time;
+  }
+
+  size_t size() const {
+    return m_entries.size();
+  }
+  const entry_type& entry(size_t index) const {
+    return m_entries[index];
+  }
+
+  // The hash is case-insensitive, returns nullptr if not found.
+  const entry_type* find(const std::string& hash) const;
+  const view_type*  find_view(const std::string& name) const;
+
+  static torrent::Object get(const entry_type& entry, int field);
+
+private:
+  DownloadSnapshot() = default;
+
+  uint64_t m_tick{ 0 };
+  int64_t  m_time{ 0 };
+
+  std::vector<entry_type>                    m_entries;
+  std::unordered_map<std::string, size_t>    m_hashes;
+  std::unordered_map<std::string, view_type> m_views;
+};
+
+}
+
+#endif
@@ -5,11 +5,17 @@
 #define RTORRENT_CORE_DOWNLOAD_STORE_H
 
 #include <string>
+#include <vector>
 
+#include <torrent/object.h>
+
+#include "core/session_loader.h"
+#include "core/session_pack.h"
+#include "core/session_writer.h"
 #include "utils/lockfile.h"
 
 namespace utils {
-class Directory;
+class DirectoryNames;
 }
 
 namespace core {
@@ -20,6 +26,11 @@ class DownloadStore {
 public:
   static constexpr int flag_skip_static = 0x1;
 
+  // Session torrents are either stored as three files per download in
+  // the session directory, or as records in a single SessionPack
+  // file, 'rtorrent.pack'.
+  enum format_type { FORMAT_FILES, FORMAT_PACKED };
+
   bool is_enabled() {
     return m_lockfile.is_locked();
   }
@@ -32,6 +43,33 @@ public:
   }
   void set_path(const std::string& path);
 
+  format_type format() const {
+    return m_format;
+  }
+  bool is_packed() const {
+    return m_format == FORMAT_PACKED;
+  }
+  const char* format_name() const;
+  void        set_format(const std::string& name);
+
+  SessionPack* pack() {
+    return &m_pack;
+  }
+
+  // With asynchronous saving, session files are serialized on the
+  // main thread and written by a SessionWriter thread. Failed writes
+  // are logged and mark the download dirty again when collected by
+  // collect_writes(). Not used by the packed format.
+  bool is_async() const {
+    return m_async;
+  }
+  void set_async(bool state);
+
+  size_t pending_writes() {
+    return m_writer.pending();
+  }
+  void collect_writes();
+
   bool save(Download* d, int flags);
   bool save_full(Download* d) {
     return save(d, 0);
@@ -41,20 +79,82 @@ public:
   }
   void remove(Download* d);
 
+  // Saves and removes made between begin_batch() and end_batch() are
+  // written to the pack together, with a single fsync. Has no effect
+  // on the per-file format unless sync_once is set.
+  void begin_batch() {
+    m_batch++;
+  }
+  bool end_batch();
+
+  // With sync_once, session files saved in a batch are not synced one
+  // by one. The file system is synced once by end_batch(), before the
+  // files are renamed into place. Used for the final save at
+  // shutdown, as it also flushes any other dirty data on the file
+  // system.
+  bool is_sync_once() const {
+    return m_syncOnce;
+  }
+  void set_sync_once(bool state) {
+    m_syncOnce = state;
+  }
+
+  // Number of threads decoding session torrents at startup, zero
+  // for the number of processors.
+  unsigned int load_threads() const {
+    return m_loadThreads;
+  }
+  void set_load_threads(unsigned int threads) {
+    m_loadThreads = threads;
+  }
+
+  // Read slots for SessionLoader, called from its worker threads.
+  // The torrent comes first, followed by whichever of the session
+  // data parts exist.
+  bool read_packed(const SessionPack::hash_type& hash,
+                   SessionLoader::part_list*     parts) const;
+  static bool read_files(const std::string&        filename,
+                         SessionLoader::part_list* parts);
+
   // Currently shows all entries in the correct format.
-  utils::Directory get_formated_entries();
+  utils::DirectoryNames get_formated_entries();
 
-  static bool is_correct_format(const std::string& f);
+  static bool is_correct_format(const std::string& f) {
+    return is_correct_format(f.c_str(), f.size());
+  }
+  static bool is_correct_format(const char* name, size_t length);
 
 private:
   std::string create_filename(Download* d);
 
-  bool write_bencode(const std::string&     filename,
-                     const torrent::Object& obj,
-                     uint32_t               skip_mask);
+  bool write_file(const std::string&     filename,
+                  const torrent::Object& obj,
+                  uint32_t               skip_mask);
+  bool flush_renames();
+
+  void put_packed(Download*             d,
+                  SessionPack::part_type part,
+                  const torrent::Object& obj,
+                  uint32_t               skip_mask);
+  bool flush_packed();
+
+  static std::string bencode_string(const torrent::Object& obj,
+                                    uint32_t               skip_mask);
 
   std::string     m_path;
   utils::Lockfile m_lockfile;
+
+  format_type m_format{ FORMAT_FILES };
+  SessionPack m_pack;
+  int         m_batch{ 0 };
+
+  bool          m_async{ false };
+  SessionWriter m_writer;
+
+  unsigned int m_loadThreads{ 0 };
+
+  bool                     m_syncOnce{ false };
+  std::vector<std::string> m_renames;
 };
 
 }
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#ifndef RTORRENT_CORE_EVENT_QUEUE_H
+#define RTORRENT_CORE_EVENT_QUEUE_H
+
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace core {
+
+class Download;
+
+// Download events waiting to be dispatched, each (download, event) pair
+// at most once. A pair pushed again moves to the end of the queue, so
+// that the last of a sequence like opened, closed, opened is the one
+// handlers see last.
+//
+// The earlier slot of a moved pair is only marked stale, and skipped
+// when taking, so that pushing stays constant time however long the
+// queue grows.
+class EventQueue {
+public:
+  using event_type = std::pair<Download*, std::string_view>;
+  using queue_type = std::vector<event_type>;
+
+  bool empty() const {
+    return m_index.empty();
+  }
+  size_t size() const {
+    return m_index.size();
+  }
+
+  // Returns false if the pair was already queued.
+  bool push(Download* download, std::string_view event_name);
+
+  // Removes and returns all events, or only those of 'download', in the
+  // order they are to be dispatched.
+  queue_type take();
+  queue_type take(Download* download);
+
+  void erase(Download* download);
+  void clear();
+
+private:
+  struct event_hash {
+    size_t operator()(const event_type& event) const {
+      return std::hash<Download*>()(event.first) ^
+             (std::hash<std::string_view>()(event.second) << 1);
+    }
+  };
+
+  using index_type = std::unordered_map<event_type, size_t, event_hash>;
+
+  static bool is_stale(const event_type& event) {
+    return event.first == nullptr;
+  }
+
+  void compact();
+
+  // Slots in dispatch order, stale ones included.
+  queue_type m_events;
+  index_type m_index;
+};
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Passing state to a new rTorrent process that replaces the current
+// one in place, for 'system.restart'.
+//
+// The state is a bencoded dictionary written to an anonymous file.
+// Its descriptor, along with any listening sockets to keep, stays
+// open across exec(), and the descriptor number is passed in the
+// RTORRENT_HANDOFF_FD environment variable. Every other descriptor is
+// closed by exec().
+
+#ifndef RTORRENT_CORE_HANDOFF_H
+#define RTORRENT_CORE_HANDOFF_H
+
+#include <string>
+#include <vector>
+
+#include <torrent/object.h>
+
+namespace core {
+
+extern const char* const handoff_env;
+
+using handoff_args = std::vector<std::string>;
+using handoff_fds  = std::vector<int>;
+
+// Makes a relative executable path in 'args[0]' absolute, as the
+// working directory may change before the restart. Symbolic links are
+// kept, so that the restart runs whatever the link points to then.
+handoff_args handoff_arguments(int argc, char** argv);
+
+// Replaces the process image, passing 'state' and keeping the
+// descriptors in 'keep' open. Only returns, with false, on failure.
+bool handoff_exec(const handoff_args&    args,
+                  const torrent::Object& state,
+                  const handoff_fds&     keep);
+
+// Reads the state passed by handoff_exec(), if this process was
+// started by one. Closes the descriptor and clears the environment
+// variable. Returns false if there is no state, or it could not be
+// read.
+bool handoff_read(torrent::Object* state);
+
+}
+
+#endif
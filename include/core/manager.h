@@ -19,10 +19,13 @@ class Bencode;
 
 namespace utils {
 class FileStatusCache;
+class StatsSegment;
 }
 
 namespace core {
 
+class DormantList;
+class DownloadSnapshot;
 class DownloadStore;
 class HttpQueue;
 
@@ -34,6 +37,7 @@ class Manager {
 public:
   using DListItr        = DownloadList::iterator;
   using FileStatusCache = utils::FileStatusCache;
+  using StatsSegment    = utils::StatsSegment;
 
   // typedef std::function<void (DownloadList::iterator)> slot_ready;
   // typedef std::function<void ()>                       slot_void;
@@ -47,9 +51,30 @@ public:
   DownloadStore* download_store() {
     return m_downloadStore;
   }
+  DormantList* dormant_list() {
+    return m_dormantList;
+  }
   FileStatusCache* file_status_cache() {
     return m_fileStatusCache;
   }
+  StatsSegment* stats_segment() {
+    return m_statsSegment;
+  }
+
+  // Safe to call from any thread without holding the global lock.
+  std::shared_ptr<const DownloadSnapshot> snapshot() const {
+    return std::atomic_load(&m_snapshot);
+  }
+
+  // Called by the main thread at the end of each tick, publishes a new
+  // snapshot every 'system.snapshot.interval' milliseconds.
+  void publish_snapshot();
+
+  // Called by the main thread at the end of each tick, publishes to
+  // the stats segment if open, at most every
+  // 'system.stats_segment.interval' milliseconds, 1000 by default since
+  // every download's row is rebuilt each time.
+  void publish_stats();
 
   HttpQueue* http_queue() {
     return m_httpQueue;
@@ -132,6 +157,19 @@ public:
     const std::string& uri,
     int                flags,
     command_list_type  commands = command_list_type());
+  // Creates a download from each payload, either raw torrent data or
+  // a base64 data URI, and filters the views once for the whole batch.
+  // The session data is written in one go only with the packed format.
+  // Returns the info hashes, or an empty string for each payload that
+  // failed.
+  torrent::Object try_create_download_batch(
+    const torrent::Object::list_type& payloads,
+    int                               flags);
+  // Returns the flags each payload of a batch is created with, or
+  // throws if any payload is not a string.
+  static std::vector<int> batch_flags(
+    const torrent::Object::list_type& payloads,
+    int                               flags);
   void try_create_download_from_meta_download(torrent::Object*   bencode,
                                               const std::string& metafile);
 
@@ -148,12 +186,18 @@ private:
 
   DownloadList*    m_downloadList;
   DownloadStore*   m_downloadStore;
+  DormantList*     m_dormantList;
   FileStatusCache* m_fileStatusCache;
+  StatsSegment*    m_statsSegment;
   HttpQueue*       m_httpQueue;
   CurlStack*       m_httpStack;
 
   View* m_hashingView{ nullptr };
 
+  std::shared_ptr<const DownloadSnapshot> m_snapshot;
+  int64_t                                 m_snapshotTime{ 0 };
+  int64_t                                 m_statsTime{ 0 };
+
   ThrottleMap        m_throttles;
   AddressThrottleMap m_addressThrottles;
 
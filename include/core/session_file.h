@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Reading and writing of bencoded session files with a checksum
+// trailer.
+//
+// The checksum follows the bencoded object as a fixed 16 byte trailer,
+// "~crc32:" with the CRC32 of every byte before it in eight hex digits
+// and a newline. Bencode readers stop at the end of the object, so
+// earlier versions still load these files, and a tool that rewrites
+// one drops the trailer rather than leaving a stale checksum. Files
+// are written to 'filename.new', synced and renamed over 'filename',
+// in a single pass through a buffered writer that computes the
+// checksum as it goes.
+//
+// Files without a trailer, as written by earlier versions or other
+// tools, are read without validation. The '~checksum' key that some
+// versions stored in the dictionary is removed from the loaded object
+// without being checked.
+
+#ifndef RTORRENT_CORE_SESSION_FILE_H
+#define RTORRENT_CORE_SESSION_FILE_H
+
+#include <cstdint>
+#include <string>
+
+#include <torrent/object.h>
+
+namespace core {
+
+uint32_t session_crc32(uint32_t crc, const char* data, size_t length);
+
+bool session_file_write(const std::string&     filename,
+                        const torrent::Object& object,
+                        uint32_t               skip_mask);
+
+// Only writes 'filename.new', leaving the sync, if 'sync' is false,
+// and the rename to the caller.
+bool session_file_write_new(const std::string&     filename,
+                            const torrent::Object& object,
+                            uint32_t               skip_mask,
+                            bool                   sync);
+
+// Returns the file contents session_file_write() would write, for
+// writing elsewhere.
+std::string session_file_string(const torrent::Object& object,
+                                uint32_t               skip_mask);
+
+// Returns false if the file cannot be read or parsed, or if the
+// checksum does not match.
+bool session_file_read(const std::string& filename, torrent::Object* object);
+
+// Reads a whole file into 'data' with plain reads. Unlike
+// session_file_read(), which maps the file, it is safe to use on files
+// that may be modified while they are read.
+bool session_file_read_data(const std::string& filename, std::string* data);
+
+// Decodes a session file already in memory. The filename is only used
+// for logging.
+bool session_file_parse(const std::string& filename,
+                        const char*        data,
+                        size_t             length,
+                        torrent::Object*   object);
+
+inline bool
+session_file_parse(const std::string& filename,
+                   const std::string& data,
+                   torrent::Object*   object) {
+  return session_file_parse(filename, data.data(), data.size(), object);
+}
+
+// Decodes a bencoded object directly from a buffer, without going
+// through a stream. Data after the object is ignored.
+bool bencode_parse(const char* data, size_t length, torrent::Object* object);
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Reads and decodes session torrents on a pool of worker threads,
+// handing them to the main thread in input order.
+//
+// The workers only run a bounded number of entries ahead of the
+// consumer, so that memory use does not grow with the size of the
+// session. Creating and inserting the downloads is left to the main
+// thread.
+
+#ifndef RTORRENT_CORE_SESSION_LOADER_H
+#define RTORRENT_CORE_SESSION_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <torrent/object.h>
+
+#include "utils/mapped_file.h"
+
+namespace core {
+
+class SessionLoader {
+public:
+  struct part_type {
+    // Empty for the torrent, otherwise the key the decoded part is
+    // inserted under.
+    std::string key;
+    // Used for logging.
+    std::string filename;
+    // The contents are either read into 'data' or, for session files,
+    // mapped.
+    std::string       data;
+    utils::MappedFile mapping;
+  };
+
+  using part_list   = std::vector<part_type>;
+  using object_ptr  = std::unique_ptr<torrent::Object>;
+  using thread_list = std::vector<std::thread>;
+
+  // Called from the worker threads. The first part must be the
+  // torrent; returning false fails the entry.
+  using read_slot = std::function<bool(size_t index, part_list* parts)>;
+
+  static const size_t entries_per_thread = 64;
+
+  SessionLoader(size_t size, read_slot slot);
+  ~SessionLoader();
+  SessionLoader(const SessionLoader&) = delete;
+  void operator=(const SessionLoader&) = delete;
+
+  size_t size() const {
+    return m_entries.size();
+  }
+  unsigned int threads() const {
+    return m_threadCount;
+  }
+
+  // Zero threads uses the number of processors, up to 8.
+  void start(unsigned int threads);
+  void stop();
+
+  // Waits for the next entry in input order. Returns nullptr if it
+  // could not be read or decoded.
+  object_ptr next();
+
+  // Decodes the parts returned by a read slot into a session torrent.
+  static bool decode(const part_list& parts, torrent::Object* object);
+
+  // Time spent in each phase, summed over the worker threads.
+  double read_seconds() const;
+  double decode_seconds() const;
+  // Time the main thread spent waiting in next().
+  double wait_seconds() const;
+
+private:
+  struct entry_type {
+    object_ptr object;
+    bool       done{ false };
+  };
+
+  void run();
+  bool load(size_t index, torrent::Object* object);
+
+  read_slot m_slot;
+
+  std::mutex              m_mutex;
+  std::condition_variable m_workers;
+  std::condition_variable m_consumer;
+
+  std::vector<entry_type> m_entries;
+  thread_list             m_threads;
+  unsigned int            m_threadCount{ 0 };
+  size_t                  m_nextLoad{ 0 };
+  size_t                  m_nextConsume{ 0 };
+  size_t                  m_window{ entries_per_thread };
+  bool                    m_stop{ false };
+
+  std::atomic<int64_t> m_readTime{ 0 };
+  std::atomic<int64_t> m_decodeTime{ 0 };
+  int64_t              m_waitTime{ 0 };
+};
+
+}
+
+#endif
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Append-only packed session store.
+//
+// The pack is a single file in the session directory that holds
+// checksummed records of the bencoded parts of session downloads,
+// keyed on the info hash. New records are collected in a batch that
+// flush() writes with a single write and fsync. The latest valid
+// record of a part wins, and a remove record drops all parts of a
+// download. Superseded records are reclaimed by compact(), which
+// copies the live records to a new file and renames it over the
+// pack.
+//
+// File layout, integers in host byte order:
+//
+//   header: "RTPACK01"
+//   record: u32 magic, u32 crc32, u32 size, u8 type, 20 byte hash,
+//           followed by 'size' bytes of payload
+//
+// The checksum covers everything in the record after itself. An
+// incomplete record at the end of the file, left by a crash during a
+// flush, is cut off when the pack is opened. Records with a bad
+// checksum are skipped, so the previous version of that part is
+// used instead. A corrupt record header is skipped by searching for
+// the next record with a valid checksum, without changing the file.
+
+#ifndef RTORRENT_CORE_SESSION_PACK_H
+#define RTORRENT_CORE_SESSION_PACK_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace core {
+
+class SessionPack {
+public:
+  // The raw 20 byte info hash.
+  using hash_type = std::string;
+  using key_list  = std::vector<hash_type>;
+
+  enum part_type {
+    PART_TORRENT,
+    PART_RESUME,
+    PART_RTORRENT,
+
+    PART_MAX_SIZE
+  };
+
+  static constexpr uint64_t compact_min_size = 16 << 20;
+
+  SessionPack() = default;
+  ~SessionPack();
+  SessionPack(const SessionPack&) = delete;
+  void operator=(const SessionPack&) = delete;
+
+  bool is_open() const {
+    return m_fd != -1;
+  }
+  const std::string& path() const {
+    return m_path;
+  }
+
+  // Creates the file if it does not exist, throws
+  // torrent::storage_error if it cannot be opened or is not a pack.
+  void open(const std::string& path);
+  void close();
+
+  bool empty() const {
+    return m_index.empty();
+  }
+  size_t size() const {
+    return m_index.size();
+  }
+
+  // Bytes in the file, and bytes in records that are still in use.
+  uint64_t file_size() const {
+    return m_fileSize;
+  }
+  uint64_t live_size() const {
+    return m_liveSize;
+  }
+
+  // Hashes of the downloads with a torrent part, in the order of
+  // their latest torrent records.
+  key_list keys() const;
+
+  // Returns false if the part is missing or fails its checksum. Only
+  // flushed records are visible.
+  bool get(const hash_type& hash, part_type part, std::string* data) const;
+
+  // Add records to the current batch.
+  void put(const hash_type& hash, part_type part, const std::string& data);
+  void remove(const hash_type& hash);
+
+  bool has_pending() const {
+    return !m_buffer.empty();
+  }
+
+  // Writes and syncs the current batch. If that fails the batch is
+  // discarded, the file is truncated to its previous size and false
+  // is returned.
+  bool flush();
+
+  bool should_compact() const {
+    return m_fileSize >= compact_min_size && m_fileSize > 2 * m_liveSize;
+  }
+
+  // Flushes, then rewrites the pack with only the live records.
+  bool compact();
+
+private:
+  struct location_type {
+    uint64_t offset{ 0 };
+    uint32_t size{ 0 };
+  };
+
+  struct entry_type {
+    location_type parts[PART_MAX_SIZE];
+  };
+
+  struct pending_type {
+    hash_type hash;
+    int       type;
+    uint64_t  offset;
+    uint32_t  size;
+  };
+
+  using index_type = std::unordered_map<hash_type, entry_type>;
+
+  void scan();
+  void apply(const hash_type& hash, int type, uint64_t offset, uint32_t size);
+  void append(const hash_type& hash, int type, const std::string& data);
+
+  bool read_record(uint64_t offset, uint32_t size, std::string* data) const;
+
+  uint64_t resync(uint64_t offset);
+
+  std::string m_path;
+  int         m_fd{ -1 };
+
+  index_type m_index;
+  uint64_t   m_fileSize{ 0 };
+  uint64_t   m_liveSize{ 0 };
+
+  std::string               m_buffer;
+  std::vector<pending_type> m_pending;
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Background thread that writes session files serialized on the main
+// thread, so that the main thread does not block on file writes and
+// fsyncs.
+//
+// Jobs are processed in the order they were pushed, so a removal
+// queued after a save of the same download is never overtaken by it.
+// Results are collected by the main thread with collect().
+
+#ifndef RTORRENT_CORE_SESSION_WRITER_H
+#define RTORRENT_CORE_SESSION_WRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+class SessionWriter {
+public:
+  struct file_type {
+    std::string filename;
+    std::string data;
+  };
+
+  struct job_type {
+    // The raw info hash, passed back in the result.
+    std::string hash;
+
+    // Written to 'filename.new', synced and renamed over 'filename'.
+    std::vector<file_type> files;
+    // Unlinked after the files have been written.
+    std::vector<std::string> unlinks;
+  };
+
+  struct result_type {
+    std::string hash;
+    bool        success;
+  };
+
+  using result_list = std::vector<result_type>;
+
+  SessionWriter() = default;
+  ~SessionWriter();
+  SessionWriter(const SessionWriter&) = delete;
+  void operator=(const SessionWriter&) = delete;
+
+  bool is_running() const {
+    return m_thread.joinable();
+  }
+
+  void start();
+
+  // Waits for the queued jobs to complete before stopping the thread.
+  void stop();
+
+  void push(job_type&& job);
+
+  // Jobs that are queued or being written.
+  size_t pending();
+
+  // Appends the results of the completed jobs to 'results'.
+  void collect(result_list* results);
+
+  static bool write_file(const file_type& file);
+
+private:
+  void run();
+
+  std::thread             m_thread;
+  std::mutex              m_mutex;
+  std::condition_variable m_condition;
+
+  std::deque<job_type> m_jobs;
+  result_list          m_results;
+  size_t               m_active{ 0 };
+  bool                 m_stop{ false };
+};
+
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include <torrent/object.h>
 #include <torrent/utils/timer.h>
 
+#include "core/download_columns.h"
 #include "globals.h"
 
 namespace core {
@@ -126,25 +127,56 @@ public:
   }
   void set_sort_current(const torrent::Object& s) {
     m_sortCurrent = s;
+    m_hasColumnSort = DownloadColumns::compile_sort(s, &m_columnSort);
   }
 
   // Need to explicity trigger filtering.
   void filter();
+
+  // Only re-checks the visible downloads, for use when the filter can
+  // only have become more restrictive since the last filter(), see
+  // is_filter_temp_refinement(). Filtered downloads whose state has
+  // changed since then stay filtered until the next filter().
+  void filter_narrow();
   void filter_by(const torrent::Object& condition, base_type& result);
   void filter_download(core::Download* download);
 
+  // Queue a filter_download call, applied once per download by
+  // flush_filter().
+  void defer_filter_download(core::Download* download) {
+    m_deferredFilter.push_back(download);
+  }
+  void flush_filter();
+
   const torrent::Object& get_filter() const {
     return m_filter;
   }
   void set_filter(const torrent::Object& s) {
     m_filter = s;
+    update_column_filter();
   }
   const torrent::Object& get_filter_temp() const {
     return m_temp_filter;
   }
   void set_filter_temp(const torrent::Object& s) {
     m_temp_filter = s;
-  }
+    m_hasTempName = filter_name_substring(s, &m_tempName);
+    update_column_filter();
+  }
+
+  // Returns true if every download matching the temporary filter 's'
+  // also matches the current one, i.e. both are name substring filters
+  // and the new substring contains the old one. Without a current
+  // temporary filter the visible downloads may be stale, so a full
+  // filter() is needed.
+  bool is_filter_temp_refinement(const torrent::Object& s) const;
+
+  // Recognizes the case-insensitive name substring filters created
+  // by the filter prompt, 'match={d.name=,.*<text>.*}' where <text>
+  // has no regex metacharacters, and sets 'substring' to the
+  // lowercase <text>.
+  static bool filter_name_substring(const torrent::Object& s,
+                                    std::string*           substring);
   void set_filter_on_event(const std::string& event);
 
   void clear_filter_on();
@@ -162,6 +194,22 @@ public:
     m_event_removed = cmd;
   }
 
+  // Invocation counts and durations, in microseconds, of filter()
+  // and sort().
+  struct stats_type {
+    uint64_t filter_count{ 0 };
+    int64_t  filter_time{ 0 };
+    int64_t  filter_last{ 0 };
+
+    uint64_t sort_count{ 0 };
+    int64_t  sort_time{ 0 };
+    int64_t  sort_last{ 0 };
+  };
+
+  const stats_type& stats() const {
+    return m_stats;
+  }
+
   // The time of the last change to the view, semantics of this is
   // user-dependent. Used by f.ex. ViewManager to decide if it should
   // sort and/or filter a view.
@@ -192,6 +240,9 @@ private:
   void emit_changed();
   void emit_changed_now();
 
+  void update_column_filter();
+  void filter_range(bool narrow);
+
   size_type position(const_iterator itr) const {
     return itr - begin();
   }
@@ -211,10 +262,26 @@ private:
   torrent::Object
     m_temp_filter; // Temporary view filter (eg: name based filter)
 
+  // Set when m_temp_filter is a name substring filter, which is then
+  // checked directly instead of through the command.
+  std::string m_tempName;
+  bool        m_hasTempName{ false };
+
+  // Compiled forms of m_sortCurrent and m_filter && m_temp_filter,
+  // used by sort() and filter() when they are valid. The temporary
+  // filter is left out if m_hasTempName is set.
+  column_sort   m_columnSort;
+  column_filter m_columnFilter;
+  bool          m_hasColumnSort{ false };
+  bool          m_hasColumnFilter{ true };
+
   torrent::Object m_event_added;
   torrent::Object m_event_removed;
 
   torrent::utils::timer m_lastChanged;
+  stats_type            m_stats;
+
+  base_type m_deferredFilter;
 
   signal_void                   m_signal_changed;
   torrent::utils::priority_item m_delayChanged;
@@ -6,6 +6,7 @@
 
 #include <string>
 #include <torrent/utils/unordered_vector.h>
+#include <unordered_map>
 
 #include "core/view.h"
 
@@ -47,6 +48,9 @@ public:
 
   // When erasing, just 'disable' the view so that the users won't
   // suddenly find their pointer dangling?
+  //
+  // Views are never erased, so the index holds positions in the
+  // underlying vector.
 
   iterator find(const std::string& name);
   iterator find_throw(const std::string& name);
@@ -72,12 +76,28 @@ public:
   void set_filter_temp(const std::string& name, const torrent::Object& cmd);
   void set_filter_on(const std::string& name, const filter_args& args);
 
+  // While set, 'view.filter_download' is queued on the view instead
+  // of being applied immediately. See DownloadList::flush_events().
+  bool is_deferring_filter() const {
+    return m_deferFilter;
+  }
+  void set_defer_filter(bool state) {
+    m_deferFilter = state;
+  }
+  void flush_filter();
+
   void set_event_added(const std::string& name, const torrent::Object& cmd) {
     (*find_throw(name))->set_event_added(cmd);
   }
   void set_event_removed(const std::string& name, const torrent::Object& cmd) {
     (*find_throw(name))->set_event_removed(cmd);
   }
+
+private:
+  using index_type = std::unordered_map<std::string, size_type>;
+
+  index_type m_index;
+  bool       m_deferFilter{ false };
 };
 
 }
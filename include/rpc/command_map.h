@@ -4,7 +4,10 @@
 #ifndef RTORRENT_RPC_COMMAND_MAP_H
 #define RTORRENT_RPC_COMMAND_MAP_H
 
+#include <atomic>
+#include <cstdint>
 #include <cstring>
+#include <functional>
 #include <map>
 #include <string>
 
@@ -20,6 +23,21 @@ struct command_map_comp {
   }
 };
 
+// Filled in by CommandMap::call_command() while profiling is enabled.
+// Times are wall time in nanoseconds and include any commands called
+// in turn. Atomic as commands with flag_no_lock run on the RPC thread.
+struct command_map_profile {
+  command_map_profile() = default;
+
+  // Copies, as made for redirects, start from zero.
+  command_map_profile(const command_map_profile&) {}
+
+  std::atomic<uint64_t> m_calls{ 0 };
+  std::atomic<uint64_t> m_time{ 0 };
+  std::atomic<uint64_t> m_timeMax{ 0 };
+  std::atomic<uint64_t> m_allocations{ 0 };
+};
+
 struct command_map_data_type {
   // Some commands will need to share data, like get/set a variable. So
   // instead of using a single virtual member function, each command
@@ -41,6 +59,8 @@ struct command_map_data_type {
 
   const char* m_parm;
   const char* m_doc;
+
+  command_map_profile m_profile;
 };
 
 class CommandMap
@@ -72,6 +92,18 @@ public:
   static constexpr int flag_file_target    = 0x200;
   static constexpr int flag_tracker_target = 0x400;
 
+  // Called by the RPC thread without taking the global lock, so the
+  // command may only read state that is safe to share, such as the
+  // published download snapshot.
+  static constexpr int flag_no_lock = 0x800;
+
+  // Set through set_modifier() on commands that change what is saved
+  // in the session. After such a command has been called,
+  // slot_modified() is called with its target.
+  static constexpr int flag_modifier = 0x1000;
+
+  using slot_modified_type = std::function<void(const target_type&)>;
+
   CommandMap() = default;
   ~CommandMap();
   CommandMap(const CommandMap&) = delete;
@@ -88,6 +120,20 @@ public:
     return itr != end() && (itr->second.m_flags & flag_modifiable);
   }
 
+  void set_modifier(key_type key);
+
+  slot_modified_type& slot_modified() {
+    return m_slotModified;
+  }
+
+  bool is_profiling() const {
+    return m_profiling.load(std::memory_order_relaxed);
+  }
+  void set_profiling(bool state) {
+    m_profiling.store(state, std::memory_order_relaxed);
+  }
+  void profile_reset();
+
   iterator insert(key_type key, int flags, const char* parm, const char* doc);
 
   template<typename T, typename Slot>
@@ -159,6 +205,14 @@ public:
     return call_command(
       key, arg, target_type((int)command_base::target_file, file, nullptr));
   }
+
+private:
+  const mapped_type call_slot(iterator           itr,
+                              const mapped_type& arg,
+                              target_type        target);
+
+  slot_modified_type m_slotModified;
+  std::atomic<bool>  m_profiling{ false };
 };
 
 inline target_type
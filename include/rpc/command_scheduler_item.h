@@ -16,9 +16,7 @@ class CommandSchedulerItem {
 public:
   using slot_void = std::function<void()>;
 
-  CommandSchedulerItem(const std::string& key)
-    : m_key(key)
-    , m_interval(0) {}
+  CommandSchedulerItem(const std::string& key);
   ~CommandSchedulerItem();
   CommandSchedulerItem(const CommandSchedulerItem&) = delete;
   void operator=(const CommandSchedulerItem&) = delete;
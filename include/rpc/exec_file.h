@@ -6,6 +6,8 @@
 
 #include <torrent/object.h>
 
+#include "rpc/exec_watcher.h"
+
 namespace rpc {
 
 class ExecFile {
@@ -29,9 +31,50 @@ public:
 
   torrent::Object execute_object(const torrent::Object& rawArgs, int flags);
 
+  // Starts the command in the arguments after the first and returns its
+  // pid at once. When it has exited, the command named by the first
+  // argument, if not empty, is called with the exit status and the
+  // captured output.
+  torrent::Object execute_async(const torrent::Object& rawArgs, int flags);
+
+  // Number of 'execute_async' commands that have not exited yet.
+  size_t pending() const {
+    return m_watcher.size();
+  }
+
+  // See ExecWatcher::set_poll().
+  void set_poll(torrent::Poll* poll) {
+    m_watcher.set_poll(poll);
+  }
+
+  void cleanup() {
+    m_watcher.cleanup();
+  }
+
 private:
+  // Starts the command with stdin on /dev/null, stdout on 'outFd' or
+  // else the log, stderr on the log, and no other descriptors open.
+  pid_t spawn(const char* file, char* const* argv, int outFd);
+
+  // Starts the command through an intermediate child that exits at
+  // once, so that init reaps it and it outlives a restart. It gets
+  // /dev/null for stdin, stdout and stderr. Returns the intermediate
+  // child's pid.
+  pid_t spawn_detached(const char* file, char* const* argv);
+
+  int execute_background(const char* file, char* const* argv);
+
+  void build_args(const torrent::Object& rawArgs,
+                  int                    flags,
+                  char**                 argsBuffer,
+                  char*                  valueBuffer);
+
+  void log_command(char* const* argv);
+  void log_status(int status);
+
   int         m_logFd{ -1 };
   std::string m_capture;
+  ExecWatcher m_watcher;
 };
 
 }
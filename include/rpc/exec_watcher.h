@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Reaps the commands started by 'execute.async', from the main thread's
+// poll, and hands their exit status and captured output to a slot with
+// the global lock held.
+//
+// Each child is watched through a pidfd where the kernel provides them.
+// Otherwise every child is checked whenever a SIGCHLD arrives, which
+// the signal handler forwards through a pipe.
+
+#ifndef RTORRENT_RPC_EXEC_WATCHER_H
+#define RTORRENT_RPC_EXEC_WATCHER_H
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace torrent {
+class Poll;
+}
+
+namespace rpc {
+
+class ExecWatcher {
+public:
+  using slot_done = std::function<void(int, const std::string&)>;
+
+  ExecWatcher() = default;
+  ExecWatcher(const ExecWatcher&) = delete;
+  ExecWatcher& operator=(const ExecWatcher&) = delete;
+
+  size_t size() const {
+    return m_children.size();
+  }
+
+  // Watches through the main thread's poll unless another is set, for
+  // callers that run their own loop.
+  void set_poll(torrent::Poll* poll) {
+    m_poll = poll;
+  }
+
+  // Takes ownership of 'output', which the child's stdout was written
+  // to and is read back once it has exited. It may be NULL.
+  void insert(pid_t pid, std::FILE* output, slot_done slot);
+
+  // Stops watching without reaping or calling back the children that
+  // are still running.
+  void cleanup();
+
+private:
+  class Child;
+  class Signal;
+
+  torrent::Poll* poll();
+
+  void watch_signal();
+  void reap(Child* child);
+  void reap_signaled();
+
+  void erase(Child* child);
+
+  std::vector<Child*> m_children;
+  Signal*             m_signal{ nullptr };
+  torrent::Poll*      m_poll{ nullptr };
+};
+
+}
+
+#endif
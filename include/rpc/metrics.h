@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Metrics in the Prometheus text exposition format, served to GET
+// requests for '/metrics' on the SCGI listener and by
+// 'network.metrics'.
+//
+// Global values are read from counters libtorrent and the client keep
+// anyway, so a scrape costs a single short hold of the global lock.
+// Views listed in 'network.metrics.views' are also aggregated, which
+// walks their downloads.
+
+#ifndef RTORRENT_RPC_METRICS_H
+#define RTORRENT_RPC_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "rpc/scgi_task.h"
+
+namespace rpc {
+
+class Metrics {
+public:
+  // Counted by the RPC thread for every request on the SCGI listener.
+  static void count_request(SCgiTask::ContentType type,
+                            uint64_t              request_size,
+                            uint64_t              response_size,
+                            bool                  succeeded);
+
+  // Requires the global lock.
+  static std::string render();
+
+  static void render_rpc(std::string* out);
+
+  static void append_family(std::string* out,
+                            const char*  name,
+                            const char*  type,
+                            const char*  help);
+  static void append_sample(std::string*       out,
+                            const char*        name,
+                            int64_t            value,
+                            const std::string& labels = std::string());
+
+  // Returns 'key="value"' with the value escaped.
+  static std::string label(const char* key, const std::string& value);
+
+private:
+  struct counters_type {
+    std::atomic<uint64_t> requests{ 0 };
+    std::atomic<uint64_t> failed{ 0 };
+    std::atomic<uint64_t> request_bytes{ 0 };
+    std::atomic<uint64_t> response_bytes{ 0 };
+  };
+
+  static counters_type m_counters[SCgiTask::CONTENT_TYPE_SIZE];
+};
+
+}
+
+#endif
@@ -30,6 +30,9 @@ public:
 
   void open_port(void* sa, unsigned int length, bool dontRoute);
   void open_named(const std::string& filename);
+  // Takes over a listening socket left open by the process replaced
+  // with 'system.restart'.
+  void open_inherited(int fd, const std::string& path);
 
   void activate();
   void deactivate();
@@ -19,7 +19,7 @@ public:
   static constexpr unsigned int default_buffer_size = 2047;
   static constexpr int          max_header_size     = 2000;
 
-  enum ContentType { XML, JSON };
+  enum ContentType { XML, JSON, METRICS, CONTENT_TYPE_SIZE };
 
   SCgiTask() {
     m_fileDesc = -1;
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Log of RPC requests that took longer than threshold(), kept in a
+// bounded ring and optionally appended as JSON lines to a file by a
+// writer thread.
+//
+// The RPC thread brackets each request with begin_request() and
+// end_request(), and reports what happened in between. Times are in
+// microseconds; serialization is the conversion of results from
+// torrent::Object. Nothing is measured while the threshold is 0.
+
+#ifndef RTORRENT_RPC_SLOW_LOG_H
+#define RTORRENT_RPC_SLOW_LOG_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+namespace rpc {
+
+class SlowLog {
+public:
+  struct entry_type {
+    int64_t     time{ 0 };
+    std::string method;
+
+    uint32_t calls{ 0 };
+    uint32_t targets{ 0 };
+
+    uint64_t request_size{ 0 };
+    uint64_t response_size{ 0 };
+
+    uint64_t lock_wait{ 0 };
+    uint64_t execution{ 0 };
+    uint64_t serialization{ 0 };
+    uint64_t total{ 0 };
+  };
+
+  using container_type = std::deque<entry_type>;
+  using clock_type     = std::chrono::steady_clock;
+
+  static uint64_t threshold();
+  static void     set_threshold(uint64_t usec);
+
+  static uint32_t max_size();
+  static void     set_max_size(uint32_t size);
+
+  static container_type entries();
+  static void           clear();
+
+  // Throws input_error if the file cannot be opened, an empty path
+  // closes it after writing what is pending.
+  static std::string file();
+  static void        set_file(const std::string& path);
+
+  static void begin_request(uint64_t request_size);
+  static void end_request();
+
+  static void add_lock_wait(uint64_t usec);
+  static void add_call(const char* method,
+                       bool        has_target,
+                       uint64_t    execution,
+                       uint64_t    serialization);
+  static void set_response_size(uint64_t size);
+
+  static std::string format(const entry_type& entry);
+
+  static uint64_t usec_between(clock_type::time_point start,
+                               clock_type::time_point end) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+      .count();
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,8 @@
+#include <gtest/gtest.h>
+
+#include "core/dormant_list.h"
+
+class DormantListTest : public ::testing::Test {
+public:
+  static torrent::Object create_session(int64_t state);
+};
@@ -0,0 +1,19 @@
+#include <gtest/gtest.h>
+
+#include "core/download_columns.h"
+
+class DownloadColumnsTest : public ::testing::Test {
+public:
+  void SetUp() override;
+
+  core::Download* download(size_t i) {
+    return reinterpret_cast<core::Download*>(m_storage + i);
+  }
+
+  static torrent::Object parse(const std::string& str);
+
+  core::DownloadColumns m_columns;
+
+  // Only used for distinct, ordered download addresses.
+  char m_storage[5];
+};
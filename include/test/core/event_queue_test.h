@@ -0,0 +1,15 @@
+#include <gtest/gtest.h>
+
+#include "core/event_queue.h"
+
+class EventQueueTest : public ::testing::Test {
+public:
+  core::Download* download(size_t i) {
+    return reinterpret_cast<core::Download*>(m_storage + i);
+  }
+
+  core::EventQueue m_queue;
+
+  // Only used for distinct download addresses.
+  char m_storage[3];
+};
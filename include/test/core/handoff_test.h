@@ -0,0 +1,12 @@
+#include <gtest/gtest.h>
+
+#include "core/handoff.h"
+
+class HandoffTest : public ::testing::Test {
+public:
+  void TearDown() override;
+
+  // Sets up the environment as handoff_exec() leaves it for the new
+  // process, with 'data' as the state.
+  static int pass_state(const std::string& data);
+};
@@ -0,0 +1,8 @@
+#include <gtest/gtest.h>
+
+#include "core/manager.h"
+
+class ManagerTest : public ::testing::Test {
+public:
+  torrent::Object::list_type m_payloads;
+};
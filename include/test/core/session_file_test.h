@@ -0,0 +1,15 @@
+#include <gtest/gtest.h>
+
+#include "core/session_file.h"
+
+class SessionFileTest : public ::testing::Test {
+public:
+  void SetUp() override;
+  void TearDown() override;
+
+  static std::string read_file(const std::string& filename);
+  static void        write_file(const std::string& filename,
+                                const std::string& data);
+
+  std::string m_dir;
+};
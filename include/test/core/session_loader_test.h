@@ -0,0 +1,5 @@
+#include <gtest/gtest.h>
+
+#include "core/session_loader.h"
+
+class SessionLoaderTest : public ::testing::Test {};
@@ -0,0 +1,19 @@
+#include <gtest/gtest.h>
+
+#include "core/session_pack.h"
+
+class SessionPackTest : public ::testing::Test {
+public:
+  void SetUp() override;
+  void TearDown() override;
+
+  static core::SessionPack::hash_type hash(char c) {
+    return core::SessionPack::hash_type(20, c);
+  }
+
+  std::string get(char c, core::SessionPack::part_type part);
+  void        reopen();
+
+  std::string       m_path;
+  core::SessionPack m_pack;
+};
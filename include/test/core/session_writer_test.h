@@ -0,0 +1,14 @@
+#include <gtest/gtest.h>
+
+#include "core/session_writer.h"
+
+class SessionWriterTest : public ::testing::Test {
+public:
+  void SetUp() override;
+  void TearDown() override;
+
+  static std::string read_file(const std::string& filename);
+
+  std::string         m_dir;
+  core::SessionWriter m_writer;
+};
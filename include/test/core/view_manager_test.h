@@ -0,0 +1,10 @@
+#include <gtest/gtest.h>
+
+#include "core/view_manager.h"
+
+class ViewManagerTest : public ::testing::Test {
+public:
+  void SetUp() override;
+
+  core::ViewManager m_views;
+};
@@ -0,0 +1,12 @@
+#include <gtest/gtest.h>
+
+#include "core/view.h"
+
+class ViewTest : public ::testing::Test {
+public:
+  static torrent::Object name_filter(const std::string& text) {
+    return "match={d.name=,.*" + text + ".*}";
+  }
+
+  core::View m_view;
+};
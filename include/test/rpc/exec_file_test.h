@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#include <torrent/utils/thread_base.h>
+
+#include "rpc/exec_file.h"
+#include "test/rpc/exec_watcher_test.h"
+
+// ExecFile releases the global lock while it waits, so hold it as the
+// callers do.
+class ExecFileTest : public ::testing::Test {
+public:
+  void SetUp() override;
+  void TearDown() override;
+
+  torrent::Object execute(std::initializer_list<const char*> args,
+                          int                                flags) {
+    torrent::Object rawArgs = torrent::Object::create_list();
+
+    for (const char* arg : args)
+      rawArgs.as_list().push_back(std::string(arg));
+
+    return m_exec.execute_object(rawArgs, flags);
+  }
+
+  torrent::Object execute_async(std::initializer_list<const char*> args,
+                                int                                flags) {
+    torrent::Object rawArgs = torrent::Object::create_list();
+
+    for (const char* arg : args)
+      rawArgs.as_list().push_back(std::string(arg));
+
+    return m_exec.execute_async(rawArgs, flags);
+  }
+
+  // Polls until every asynchronous command has been reaped, or gives
+  // up after a few seconds.
+  bool wait_pending();
+
+  // Arguments of each call to the 'test_exec_file.done' command.
+  static std::vector<torrent::Object::list_type> callbacks;
+
+protected:
+  torrent::Poll* m_poll{ nullptr };
+  rpc::ExecFile  m_exec;
+};
@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <sys/types.h>
+
+#include <torrent/poll.h>
+
+#include "rpc/exec_watcher.h"
+
+// Runs its own poll, as the tests have no main thread.
+class ExecWatcherTest : public ::testing::Test {
+public:
+  void SetUp() override;
+  void TearDown() override;
+
+  // Starts 'sh -c command' with stdout on 'output', if not NULL.
+  static pid_t start(const char* command, std::FILE* output = nullptr);
+
+  // Polls until every child has been reaped, or gives up after a few
+  // seconds.
+  static bool wait_all(torrent::Poll* poll, rpc::ExecWatcher* watcher);
+
+  static torrent::Poll* create_poll();
+
+protected:
+  torrent::Poll*   m_poll{ nullptr };
+  rpc::ExecWatcher m_watcher;
+};
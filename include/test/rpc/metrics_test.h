@@ -0,0 +1,5 @@
+#include <gtest/gtest.h>
+
+#include "rpc/metrics.h"
+
+class MetricsTest : public ::testing::Test {};
@@ -0,0 +1,18 @@
+#include <gtest/gtest.h>
+
+#include "rpc/slow_log.h"
+
+class SlowLogTest : public ::testing::Test {
+public:
+  void SetUp() override {
+    rpc::SlowLog::set_threshold(1);
+    rpc::SlowLog::set_max_size(64);
+    rpc::SlowLog::clear();
+  }
+
+  void TearDown() override {
+    rpc::SlowLog::set_threshold(0);
+    rpc::SlowLog::set_file("");
+    rpc::SlowLog::clear();
+  }
+};
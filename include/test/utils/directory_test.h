@@ -0,0 +1,14 @@
+#include <gtest/gtest.h>
+
+#include "utils/directory.h"
+
+class DirectoryTest : public ::testing::Test {
+public:
+  void SetUp() override;
+  void TearDown() override;
+
+  void create_file(const std::string& name);
+
+  std::string              m_dir;
+  std::vector<std::string> m_files;
+};
@@ -0,0 +1,16 @@
+#include <gtest/gtest.h>
+
+#include "utils/lock_stats.h"
+
+class LockStatsTest : public ::testing::Test {
+public:
+  void SetUp() override {
+    utils::LockStats::set_enabled(true);
+    utils::LockStats::reset();
+  }
+
+  void TearDown() override {
+    utils::LockStats::set_enabled(true);
+    utils::LockStats::reset();
+  }
+};
@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+#include "utils/stats_segment.h"
+
+class StatsSegmentTest : public ::testing::Test {
+public:
+  void SetUp() override {
+    char path[] = "/tmp/rtorrent_test_stats_XXXXXX";
+    ASSERT_NE(::mkdtemp(path), nullptr);
+
+    m_dir  = path;
+    m_path = m_dir + "/stats";
+  }
+
+  void TearDown() override {
+    ::unlink(m_path.c_str());
+    ::rmdir(m_dir.c_str());
+  }
+
+  std::string m_dir;
+  std::string m_path;
+};
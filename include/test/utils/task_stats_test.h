@@ -0,0 +1,16 @@
+#include <gtest/gtest.h>
+
+#include "utils/task_stats.h"
+
+class TaskStatsTest : public ::testing::Test {
+public:
+  void SetUp() override {
+    utils::TaskStats::set_enabled(true);
+    utils::TaskStats::reset();
+  }
+
+  void TearDown() override {
+    utils::TaskStats::set_enabled(false);
+    utils::TaskStats::reset();
+  }
+};
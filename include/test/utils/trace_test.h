@@ -0,0 +1,18 @@
+#include <gtest/gtest.h>
+
+#include "utils/trace.h"
+
+class TraceTest : public ::testing::Test {
+public:
+  void SetUp() override {
+    utils::Trace::clear();
+    utils::Trace::set_enabled(true);
+  }
+
+  void TearDown() override {
+    utils::Trace::set_enabled(false);
+    utils::Trace::set_slow_request(0);
+    utils::Trace::set_directory("");
+    utils::Trace::clear();
+  }
+};
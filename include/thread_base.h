@@ -4,22 +4,32 @@
 #ifndef RTORRENT_UTILS_THREAD_BASE_H
 #define RTORRENT_UTILS_THREAD_BASE_H
 
+#include <memory>
+#include <utility>
+
 #include <sys/types.h>
 
 #include <torrent/utils/priority_queue_default.h>
 #include <torrent/utils/thread_base.h>
 
 #include "core/poll_manager.h"
+#include "utils/mpsc_queue.h"
 
 // Move this class to libtorrent.
 
-class thread_queue_hack;
-
 class ThreadBase : public torrent::thread_base {
 public:
   using priority_queue   = torrent::utils::priority_queue_default;
   using thread_base_func = void (*)(ThreadBase*);
 
+  // An item queued for the thread, holding the callable and whatever
+  // it captured.
+  class queue_item_base : public utils::MpscQueueNode {
+  public:
+    virtual ~queue_item_base() = default;
+    virtual void call(ThreadBase* thread) = 0;
+  };
+
   ThreadBase();
   ~ThreadBase() override;
 
@@ -32,8 +42,16 @@ public:
 
   // ATM, only interaction with a thread's allowed by other threads is
   // through the queue_item call.
+  //
+  // Any thread may queue a callable taking the ThreadBase pointer,
+  // including move-only ones. Items are called in the order they were
+  // queued by each thread, and never block or fail the caller.
+  template<typename Func>
+  void queue_item(Func func) {
+    queue_item_ptr(std::make_unique<queue_item_func<Func>>(std::move(func)));
+  }
 
-  void queue_item(thread_base_func newFunc);
+  void queue_item_ptr(std::unique_ptr<queue_item_base> item);
 
 protected:
   int64_t next_timeout_usec() override;
@@ -49,9 +67,22 @@ protected:
 
   torrent::utils::priority_item m_taskShutdown;
 
-  // Temporary hack to pass messages to a thread. This really needs to
-  // be cleaned up and/or integrated into the priority queue itself.
-  thread_queue_hack* m_threadQueue;
+  utils::MpscQueue<queue_item_base> m_threadQueue;
+
+private:
+  template<typename Func>
+  class queue_item_func : public queue_item_base {
+  public:
+    explicit queue_item_func(Func func)
+      : m_func(std::move(func)) {}
+
+    void call(ThreadBase* thread) override {
+      m_func(thread);
+    }
+
+  private:
+    Func m_func;
+  };
 };
 
 #endif
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Number of calls to the global operator new made by the calling
+// thread, which is replaced to keep a per-thread count. Compare the
+// value before and after some work to count its allocations.
+//
+// The replacement adds to every allocation of the process, so it is
+// only built with USE_ALLOCATION_COUNT. Otherwise the count is always
+// zero.
+
+#ifndef RTORRENT_UTILS_ALLOCATION_COUNT_H
+#define RTORRENT_UTILS_ALLOCATION_COUNT_H
+
+#include <cstdint>
+
+namespace utils {
+
+uint64_t
+allocation_count();
+
+}
+
+#endif
@@ -5,6 +5,7 @@
 #define RTORRENT_UTILS_DIRECTORY_H
 
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -68,6 +69,60 @@ private:
   std::string m_path;
 };
 
+// Lists the names in a directory for scans of large directories, such
+// as the session directory. Names are stored back to back in a single
+// buffer, and on Linux read with getdents64 through a large buffer.
+// The filter sees each name before it is stored, so rejected names
+// cost no allocation.
+class DirectoryNames {
+public:
+  using filter_type = std::function<bool(const char* name, size_t length)>;
+
+  static constexpr size_t buffer_size = 256 * 1024;
+
+  static constexpr int update_sort     = Directory::update_sort;
+  static constexpr int update_hide_dot = Directory::update_hide_dot;
+
+  size_t size() const {
+    return m_entries.size();
+  }
+  bool empty() const {
+    return m_entries.empty();
+  }
+
+  // Names are null-terminated.
+  const char* name(size_t index) const {
+    return m_names.data() + m_entries[index].offset;
+  }
+  size_t length(size_t index) const {
+    return m_entries[index].length;
+  }
+  // DT_* or DT_UNKNOWN, as reported by the file system.
+  uint8_t type(size_t index) const {
+    return m_entries[index].type;
+  }
+
+  void clear();
+
+  // Appends the names in 'path' accepted by 'filter', or all names if
+  // it is empty.
+  bool update(const std::string& path,
+              int                flags,
+              const filter_type& filter = filter_type());
+
+private:
+  struct entry_type {
+    uint32_t offset;
+    uint16_t length;
+    uint8_t  type;
+  };
+
+  void insert(const char* name, size_t length, uint8_t type);
+
+  std::vector<entry_type> m_entries;
+  std::vector<char>       m_names;
+};
+
 inline bool
 operator==(const directory_entry& left, const directory_entry& right) {
   return left.d_name == right.d_name;
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Wait and hold times of libtorrent's global lock, by acquirer.
+//
+// The acquirer is a name such as "main", "exec" or the RPC method
+// being called. Times are recorded in microseconds, with histograms of
+// power of two buckets: bucket 0 counts times under 1 us, and bucket i
+// times in [2^(i-1), 2^i) us.
+//
+// The statistics are only updated and read while holding the global
+// lock, which is what protects them.
+
+#ifndef RTORRENT_UTILS_LOCK_STATS_H
+#define RTORRENT_UTILS_LOCK_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace utils {
+
+class LockStats {
+public:
+  static constexpr unsigned int histogram_size = 25;
+
+  using histogram_type = std::array<uint64_t, histogram_size>;
+
+  struct entry_type {
+    uint64_t wait_count{ 0 };
+    uint64_t wait_total{ 0 };
+    uint64_t wait_max{ 0 };
+
+    uint64_t hold_count{ 0 };
+    uint64_t hold_total{ 0 };
+    uint64_t hold_max{ 0 };
+
+    histogram_type wait_histogram{};
+    histogram_type hold_histogram{};
+  };
+
+  using container_type = std::map<std::string, entry_type, std::less<>>;
+
+  static bool is_enabled() {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+  static void set_enabled(bool state) {
+    m_enabled.store(state, std::memory_order_relaxed);
+  }
+
+  static const container_type& entries() {
+    return m_entries;
+  }
+  static void reset() {
+    m_entries.clear();
+  }
+
+  // Acquires and releases the global lock, recording how long this
+  // thread waited for it and then held it. The wait in microseconds
+  // is returned even while disabled.
+  static uint64_t acquire(const char* acquirer);
+  static void release();
+
+  // Names the acquirer of a lock taken as "rpc", once the method is
+  // known. Holds that run several RPC methods are counted under
+  // 'system.multicall'.
+  static void set_acquirer(const char* acquirer);
+
+  // Lets other threads take the lock while this thread waits on
+  // something else. The hold so far is recorded, the wait to get the
+  // lock back is recorded under 'waiter', and the hold then continues
+  // under the previous acquirer.
+  static void yield();
+  static void resume(const char* waiter);
+
+  // Records the hold of a lock this thread already has, as for the
+  // main thread, which libtorrent keeps locked outside of polling.
+  static void begin_hold(const char* acquirer);
+  static void end_hold();
+
+  static unsigned int bucket(uint64_t usec);
+
+private:
+  static entry_type& find_entry(const char* acquirer);
+
+  static void record(histogram_type* histogram,
+                     uint64_t*       count,
+                     uint64_t*       total,
+                     uint64_t*       max,
+                     uint64_t        usec);
+
+  static std::atomic<bool> m_enabled;
+  static container_type    m_entries;
+};
+
+}
+
+#endif
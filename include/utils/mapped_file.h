@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// A read-only private mapping of a whole file, so that it can be
+// parsed in place instead of being copied into a buffer.
+//
+// Only use it on files owned by rTorrent, such as the session files.
+// Truncating a file while it is mapped raises SIGBUS on access.
+
+#ifndef RTORRENT_UTILS_MAPPED_FILE_H
+#define RTORRENT_UTILS_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace utils {
+
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  MappedFile(const MappedFile&) = delete;
+  void operator=(const MappedFile&) = delete;
+
+  bool is_open() const {
+    return m_data != nullptr;
+  }
+
+  // Returns false if the file could not be mapped, or is empty.
+  bool open(const std::string& filename);
+  void close();
+
+  const char* data() const {
+    return m_data;
+  }
+  size_t size() const {
+    return m_size;
+  }
+
+private:
+  const char* m_data{ nullptr };
+  size_t      m_size{ 0 };
+};
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Unbounded lock-free multi-producer single-consumer queue of
+// intrusive nodes, after Dmitry Vyukov's design.
+//
+// push() may be called from any thread, and is a single atomic
+// exchange followed by a store. pop() must only be called from the
+// consumer thread. While a push() is halfway done, pop() returns
+// nullptr even if later nodes are complete; the consumer is expected
+// to be woken again by the producer once push() returns.
+//
+// The queue does not own its nodes.
+
+#ifndef RTORRENT_UTILS_MPSC_QUEUE_H
+#define RTORRENT_UTILS_MPSC_QUEUE_H
+
+#include <atomic>
+
+namespace utils {
+
+class MpscQueueNode {
+public:
+  MpscQueueNode() = default;
+  MpscQueueNode(const MpscQueueNode&) = delete;
+  MpscQueueNode& operator=(const MpscQueueNode&) = delete;
+
+private:
+  template<typename Node>
+  friend class MpscQueue;
+
+  std::atomic<MpscQueueNode*> m_next{ nullptr };
+};
+
+template<typename Node>
+class MpscQueue {
+public:
+  MpscQueue()
+    : m_head(&m_stub)
+    , m_tail(&m_stub) {}
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  // Consumer only, may miss a push() in progress.
+  bool empty() const {
+    return m_tail == &m_stub &&
+           m_stub.m_next.load(std::memory_order_acquire) == nullptr;
+  }
+
+  void push(Node* node) {
+    push_node(node);
+  }
+
+  Node* pop();
+
+private:
+  void push_node(MpscQueueNode* node) {
+    node->m_next.store(nullptr, std::memory_order_relaxed);
+
+    MpscQueueNode* prev = m_head.exchange(node, std::memory_order_acq_rel);
+    prev->m_next.store(node, std::memory_order_release);
+  }
+
+  // Producers.
+  alignas(64) std::atomic<MpscQueueNode*> m_head;
+
+  // Consumer.
+  alignas(64) MpscQueueNode* m_tail;
+  MpscQueueNode m_stub;
+};
+
+template<typename Node>
+Node*
+MpscQueue<Node>::pop() {
+  MpscQueueNode* tail = m_tail;
+  MpscQueueNode* next = tail->m_next.load(std::memory_order_acquire);
+
+  if (tail == &m_stub) {
+    if (next == nullptr)
+      return nullptr;
+
+    m_tail = next;
+    tail   = next;
+    next   = next->m_next.load(std::memory_order_acquire);
+  }
+
+  if (next != nullptr) {
+    m_tail = next;
+    return static_cast<Node*>(tail);
+  }
+
+  // The tail is the last node, unless a push() is in progress.
+  if (tail != m_head.load(std::memory_order_acquire))
+    return nullptr;
+
+  // Put the stub back behind the last node so that it can be taken.
+  push_node(&m_stub);
+
+  next = tail->m_next.load(std::memory_order_acquire);
+
+  if (next == nullptr)
+    return nullptr;
+
+  m_tail = next;
+  return static_cast<Node*>(tail);
+}
+
+}
+
+#endif
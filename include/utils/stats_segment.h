@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Global and per-download statistics published by the main thread
+// into a memory mapped file, so that local tools can read them without
+// going through RPC. Placing the file on a tmpfs such as /dev/shm keeps
+// it in memory.
+//
+// The layout is versioned and guarded by a sequence lock: the sequence
+// is odd while the writer copies a new snapshot in, and readers retry
+// until they have copied everything with the same even sequence before
+// and after. Readers never block the writer.
+//
+// This file and its source only depend on the C++ and POSIX libraries,
+// so that readers such as 'rtorrent-stats' can be built without
+// libtorrent.
+
+#ifndef RTORRENT_UTILS_STATS_SEGMENT_H
+#define RTORRENT_UTILS_STATS_SEGMENT_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+class StatsSegment {
+public:
+  static constexpr uint32_t magic   = 0x53535452; // "RTSS"
+  static constexpr uint32_t version = 1;
+
+  static constexpr unsigned int hash_size = 40;
+  static constexpr unsigned int name_size = 88;
+
+  struct global_type {
+    int64_t up_rate;
+    int64_t up_total;
+    int64_t up_max_rate;
+    int64_t down_rate;
+    int64_t down_total;
+    int64_t down_max_rate;
+
+    int64_t sockets_open;
+    int64_t sockets_max;
+    int64_t files_open;
+    int64_t files_max;
+    int64_t memory_usage;
+    int64_t memory_max;
+    int64_t hash_queue_size;
+  };
+
+  enum {
+    flag_open     = 1 << 0,
+    flag_active   = 1 << 1,
+    flag_complete = 1 << 2,
+    flag_hashing  = 1 << 3
+  };
+
+  // The hash is in hex without a terminator, the name is truncated and
+  // always terminated. The ratio is multiplied by 1000.
+  struct download_type {
+    char     hash[hash_size];
+    char     name[name_size];
+    uint32_t flags;
+    uint32_t peers;
+
+    int64_t priority;
+    int64_t up_rate;
+    int64_t up_total;
+    int64_t down_rate;
+    int64_t down_total;
+    int64_t bytes_done;
+    int64_t left_bytes;
+    int64_t size_bytes;
+    int64_t ratio;
+  };
+
+  struct header_type {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t download_size;
+
+    std::atomic<uint64_t> sequence;
+
+    // Guarded by the sequence. The file grows when the downloads no
+    // longer fit, readers remap it when 'size' exceeds their mapping.
+    uint64_t size;
+    uint64_t tick;
+    int64_t  time; // Microseconds since the epoch.
+    uint32_t pid;
+    uint32_t download_count;
+
+    global_type global;
+  };
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "The sequence must be lock-free to be shared.");
+
+  StatsSegment() = default;
+  ~StatsSegment() {
+    close();
+  }
+
+  StatsSegment(const StatsSegment&) = delete;
+  StatsSegment& operator=(const StatsSegment&) = delete;
+
+  bool is_open() const {
+    return m_header != nullptr;
+  }
+  const std::string& path() const {
+    return m_path;
+  }
+
+  // Returns false with errno set if the file cannot be created, or
+  // with EEXIST if 'path' names a file that is not a segment. A
+  // previous segment is replaced. The file is removed when closed.
+  bool open(const std::string& path);
+  void close();
+
+  // Returns false with errno set if the file could not grow to fit the
+  // downloads, in which case the previous snapshot is kept.
+  bool publish(uint64_t                          tick,
+               const global_type&                global,
+               const std::vector<download_type>& downloads);
+
+  // Copies the string into the download's name, truncating it.
+  static void set_name(download_type* download, const std::string& name);
+
+private:
+  bool resize(uint64_t size);
+
+  std::string  m_path;
+  int          m_fd{ -1 };
+  header_type* m_header{ nullptr };
+  uint64_t     m_size{ 0 };
+};
+
+class StatsSegmentReader {
+public:
+  struct snapshot_type {
+    uint64_t                                 sequence;
+    uint64_t                                 tick;
+    int64_t                                  time;
+    uint32_t                                 pid;
+    StatsSegment::global_type                global;
+    std::vector<StatsSegment::download_type> downloads;
+  };
+
+  StatsSegmentReader() = default;
+  ~StatsSegmentReader() {
+    close();
+  }
+
+  StatsSegmentReader(const StatsSegmentReader&) = delete;
+  StatsSegmentReader& operator=(const StatsSegmentReader&) = delete;
+
+  bool is_open() const {
+    return m_header != nullptr;
+  }
+
+  // Returns false with errno set if the file cannot be mapped, or with
+  // EPROTO if it is not a segment of this version.
+  bool open(const std::string& path);
+  void close();
+
+  // Returns false with EAGAIN if no consistent snapshot could be copied
+  // in 'attempts' tries, i.e. the writer kept publishing meanwhile.
+  bool read(snapshot_type* dest, unsigned int attempts = 1000);
+
+private:
+  bool remap(uint64_t size);
+
+  int                              m_fd{ -1 };
+  const StatsSegment::header_type* m_header{ nullptr };
+  uint64_t                         m_size{ 0 };
+};
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Run times of the tasks of the main loop's scheduler, and of the main
+// loop's ticks, while enabled.
+//
+// Tasks are named with set_name(), or else by the type of their slot,
+// e.g. "core::View::View()::{lambda()#1}". Times are recorded in
+// microseconds, and ticks in a histogram with the buckets of
+// LockStats. Ticks slower than slow_tick() are logged along with their
+// slowest task.
+//
+// Only used by the main thread, and read while holding the global lock.
+
+#ifndef RTORRENT_UTILS_TASK_STATS_H
+#define RTORRENT_UTILS_TASK_STATS_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+#include <torrent/utils/priority_queue_default.h>
+
+#include "utils/lock_stats.h"
+
+namespace utils {
+
+class TaskStats {
+public:
+  using histogram_type = LockStats::histogram_type;
+
+  struct entry_type {
+    uint64_t count{ 0 };
+    uint64_t total{ 0 };
+    uint64_t max{ 0 };
+  };
+
+  using container_type = std::map<std::string, entry_type, std::less<>>;
+
+  static bool is_enabled() {
+    return m_enabled;
+  }
+  static void set_enabled(bool state) {
+    m_enabled = state;
+  }
+
+  static uint64_t slow_tick() {
+    return m_slowTick;
+  }
+  static void set_slow_tick(uint64_t usec) {
+    m_slowTick = usec;
+  }
+
+  static const container_type& entries() {
+    return m_entries;
+  }
+  static const histogram_type& tick_histogram() {
+    return m_tickHistogram;
+  }
+  static uint64_t tick_count() {
+    return m_tickCount;
+  }
+  static uint64_t slow_tick_count() {
+    return m_slowTickCount;
+  }
+
+  static void reset();
+
+  static void set_name(const torrent::utils::priority_item* item,
+                       const std::string&                   name);
+  static void erase_name(const torrent::utils::priority_item* item);
+
+  // Runs the tasks due at 't', as priority_queue_perform() does.
+  static void perform(torrent::utils::priority_queue_default* queue,
+                      torrent::utils::timer                   t);
+
+  static void begin_tick();
+  static void end_tick();
+
+  // Human readable summary, the most time consuming tasks first.
+  static std::string report();
+
+private:
+  static const std::string& task_name(torrent::utils::priority_item* item);
+
+  static bool     m_enabled;
+  static uint64_t m_slowTick;
+
+  static container_type m_entries;
+  static histogram_type m_tickHistogram;
+  static uint64_t       m_tickCount;
+  static uint64_t       m_slowTickCount;
+  static unsigned int   m_resets;
+
+  static std::map<const torrent::utils::priority_item*, std::string> m_names;
+};
+
+}
+
+#endif
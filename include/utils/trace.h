@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Spans of time recorded into a ring buffer per thread, written out as
+// Chrome trace-event JSON, which chrome://tracing and Perfetto open.
+//
+// Code is instrumented with RT_TRACE_SPAN(name), which records the
+// time until the end of the enclosing scope. RT_TRACE_REQUEST(name)
+// also writes the calling thread's events since the start of the span
+// to a file in directory(), if it took longer than slow_request().
+//
+// The macros compile to nothing unless built with USE_TRACING, and
+// record nothing unless enabled at runtime. Names are copied when a
+// span ends, so they only need to outlive it.
+
+#ifndef RTORRENT_UTILS_TRACE_H
+#define RTORRENT_UTILS_TRACE_H
+
+#include "buildinfo.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace utils {
+
+class Trace {
+public:
+  static constexpr unsigned int ring_size = 16384;
+  static constexpr unsigned int name_size = 48;
+
+  static bool is_enabled() {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+  static void set_enabled(bool state) {
+    m_enabled.store(state, std::memory_order_relaxed);
+  }
+
+  // Threshold in microseconds, 0 to disable.
+  static uint64_t slow_request() {
+    return m_slowRequest.load(std::memory_order_relaxed);
+  }
+  static void set_slow_request(uint64_t usec) {
+    m_slowRequest.store(usec, std::memory_order_relaxed);
+  }
+
+  static std::string directory();
+  static void        set_directory(const std::string& path);
+
+  // Nanoseconds on a monotonic clock.
+  static uint64_t now();
+
+  static void record(const char* name, uint64_t start, uint64_t end);
+  static void record_request(const char* name, uint64_t start, uint64_t end);
+
+  static void clear();
+
+  // The events of all threads, or of the calling thread only, that
+  // started at or after 'since'.
+  static std::string json(uint64_t since = 0, bool this_thread = false);
+
+  // Throws input_error if the file cannot be written.
+  static void write(const std::string& path,
+                    uint64_t           since       = 0,
+                    bool               this_thread = false);
+
+private:
+  static std::atomic<bool>     m_enabled;
+  static std::atomic<uint64_t> m_slowRequest;
+};
+
+class TraceSpan {
+public:
+  explicit TraceSpan(const char* name, bool request = false)
+    : m_name(name)
+    , m_request(request)
+    , m_start(Trace::is_enabled() ? Trace::now() : 0) {}
+
+  ~TraceSpan() {
+    if (m_start == 0)
+      return;
+
+    if (m_request)
+      Trace::record_request(m_name, m_start, Trace::now());
+    else
+      Trace::record(m_name, m_start, Trace::now());
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+  const char* m_name;
+  bool        m_request;
+  uint64_t    m_start;
+};
+
+}
+
+#define RT_TRACE_CONCAT_IMPL(a, b) a##b
+#define RT_TRACE_CONCAT(a, b) RT_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef RT_USE_TRACING
+#define RT_TRACE_SPAN(name)                                                    \
+  utils::TraceSpan RT_TRACE_CONCAT(rt_trace_span_, __LINE__)(name)
+#define RT_TRACE_REQUEST(name)                                                 \
+  utils::TraceSpan RT_TRACE_CONCAT(rt_trace_span_, __LINE__)(name, true)
+#else
+#define RT_TRACE_SPAN(name) static_cast<void>(name)
+#define RT_TRACE_REQUEST(name) static_cast<void>(name)
+#endif
+
+#endif
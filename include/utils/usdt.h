@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Statically defined tracing probes under the 'rtorrent' provider, for
+// bpftrace, perf and SystemTap, e.g.:
+//
+//   bpftrace -e 'usdt:/usr/bin/rtorrent:rtorrent:command_start
+//                { @[str(arg0)] = count(); }'
+//
+// The probes compile to nothing unless built with USE_USDT, and to a
+// single nop otherwise. Their arguments are evaluated whether or not a
+// tracer is attached, so only pass values that are already at hand;
+// hashes are the raw 20 bytes, strings are C strings.
+//
+// RT_PROBE_ON_EXIT(probe) fires the probe when the enclosing scope is
+// left, including by an exception.
+
+#ifndef RTORRENT_UTILS_USDT_H
+#define RTORRENT_UTILS_USDT_H
+
+#include "buildinfo.h"
+
+#ifdef RT_USE_USDT
+#include <sys/sdt.h>
+
+#define RT_PROBE0(name)             DTRACE_PROBE(rtorrent, name)
+#define RT_PROBE1(name, a)          DTRACE_PROBE1(rtorrent, name, a)
+#define RT_PROBE2(name, a, b)       DTRACE_PROBE2(rtorrent, name, a, b)
+#define RT_PROBE3(name, a, b, c)    DTRACE_PROBE3(rtorrent, name, a, b, c)
+#define RT_PROBE4(name, a, b, c, d) DTRACE_PROBE4(rtorrent, name, a, b, c, d)
+
+namespace utils {
+
+template<typename Slot>
+class probe_exit {
+public:
+  explicit probe_exit(Slot slot)
+    : m_slot(slot) {}
+  ~probe_exit() {
+    m_slot();
+  }
+
+  probe_exit(const probe_exit&) = delete;
+  probe_exit& operator=(const probe_exit&) = delete;
+
+private:
+  Slot m_slot;
+};
+
+}
+
+#define RT_PROBE_CONCAT_IMPL(a, b) a##b
+#define RT_PROBE_CONCAT(a, b)      RT_PROBE_CONCAT_IMPL(a, b)
+
+#define RT_PROBE_ON_EXIT(probe)                                                \
+  utils::probe_exit RT_PROBE_CONCAT(rt_probe_exit_, __LINE__)([&] { probe; })
+#else
+#define RT_PROBE0(name)
+#define RT_PROBE1(name, a)
+#define RT_PROBE2(name, a, b)
+#define RT_PROBE3(name, a, b, c)
+#define RT_PROBE4(name, a, b, c, d)
+
+#define RT_PROBE_ON_EXIT(probe) static_cast<void>(0)
+#endif
+
+#endif
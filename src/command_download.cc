@@ -27,6 +27,7 @@
 #include <unistd.h>
 
 #include "core/download.h"
+#include "core/download_list.h"
 #include "core/download_store.h"
 #include "core/manager.h"
 #include "rpc/parse.h"
@@ -623,6 +624,8 @@ download_set_variable_value(core::Download*                    download,
                             const torrent::Object::value_type& args,
                             const char*                        first_key,
                             const char* second_key = nullptr) {
+  control->core()->download_list()->invalidate_columns();
+
   if (second_key == nullptr)
     return download->bencode()->get_key(first_key) = args;
 
@@ -639,8 +642,10 @@ download_set_variable_value_ifz(core::Download*                    download,
       ? download->bencode()->get_key(first_key)
       : download->bencode()->get_key(first_key).get_key(second_key);
 
-  if (object.as_value() == 0)
+  if (object.as_value() == 0) {
     object = args;
+    control->core()->download_list()->invalidate_columns();
+  }
 
   return object;
 }
@@ -749,7 +754,8 @@ d_list_remove(core::Download*        download,
   });                                                                          \
   CMD2_DL_VALUE_P(key ".set", [](const auto& download, const auto& args) {     \
     return download_set_variable_value(download, args, first_key, second_key); \
-  });
+  });                                                                          \
+  rpc::commands.set_modifier(key ".set");
 
 #define CMD2_DL_VAR_VALUE_PUBLIC(key, first_key, second_key)                   \
   CMD2_DL(key, [](const auto& download, const auto&) {                         \
@@ -757,7 +763,8 @@ d_list_remove(core::Download*        download,
   });                                                                          \
   CMD2_DL_VALUE(key ".set", [](const auto& download, const auto& args) {       \
     return download_set_variable_value(download, args, first_key, second_key); \
-  });
+  });                                                                          \
+  rpc::commands.set_modifier(key ".set");
 
 #define CMD2_DL_TIMESTAMP(key, first_key, second_key)                          \
   CMD2_DL(key, [](const auto& download, const auto&) {                         \
@@ -770,7 +777,9 @@ d_list_remove(core::Download*        download,
                   [](const auto& download, const auto& args) {                 \
                     return download_set_variable_value_ifz(                    \
                       download, args, first_key, second_key);                  \
-                  });
+                  });                                                          \
+  rpc::commands.set_modifier(key ".set");                                      \
+  rpc::commands.set_modifier(key ".set_if_z");
 
 #define CMD2_DL_VAR_STRING(key, first_key, second_key)                         \
   CMD2_DL(key, [](const auto& download, const auto&) {                         \
@@ -779,7 +788,8 @@ d_list_remove(core::Download*        download,
   CMD2_DL_STRING_P(key ".set", [](const auto& download, const auto& args) {    \
     return download_set_variable_string(                                       \
       download, args, first_key, second_key);                                  \
-  });
+  });                                                                          \
+  rpc::commands.set_modifier(key ".set");
 
 #define CMD2_DL_VAR_STRING_PUBLIC(key, first_key, second_key)                  \
   CMD2_DL(key, [](const auto& download, const auto&) {                         \
@@ -788,7 +798,8 @@ d_list_remove(core::Download*        download,
   CMD2_DL_STRING(key ".set", [](const auto& download, const auto& args) {      \
     return download_set_variable_string(                                       \
       download, args, first_key, second_key);                                  \
-  });
+  });                                                                          \
+  rpc::commands.set_modifier(key ".set");
 
 int64_t
 cg_d_group(core::Download* download);
@@ -1254,4 +1265,34 @@ initialize_command_download() {
   CMD2_ANY_LIST("p.call_target", [](const auto&, const auto& args) {
     return p_call_target(args);
   });
+
+  // Besides the variable setters above, these change what is saved in
+  // the session, so session.save has to write out their download again.
+  for (const char* key : { "d.connection_current.set",
+                           "d.custom.set",
+                           "d.delete_tied",
+                           "d.directory.set",
+                           "d.directory_base.set",
+                           "d.down.choke_heuristics.set",
+                           "d.down.sequential.set",
+                           "d.downloads_max.set",
+                           "d.downloads_min.set",
+                           "d.group.set",
+                           "d.hashing_failed.set",
+                           "d.max_file_size.set",
+                           "d.message.set",
+                           "d.peer_exchange.set",
+                           "d.peers_max.set",
+                           "d.peers_min.set",
+                           "d.priority.set",
+                           "d.throttle_name.set",
+                           "d.tracker.insert",
+                           "d.tracker_numwant.set",
+                           "d.up.choke_heuristics.set",
+                           "d.uploads_max.set",
+                           "d.uploads_min.set",
+                           "d.views.push_back",
+                           "d.views.push_back_unique",
+                           "d.views.remove" })
+    rpc::commands.set_modifier(key);
 }
@@ -12,9 +12,11 @@
 #include <torrent/utils/log.h>
 #include <torrent/utils/path.h>
 #include <torrent/utils/string_manip.h>
+#include <torrent/utils/timer.h>
 
 #include "core/download.h"
 #include "core/download_list.h"
+#include "core/download_snapshot.h"
 #include "core/manager.h"
 #include "core/view_manager.h"
 #include "rpc/command_scheduler.h"
@@ -356,6 +358,83 @@ d_multicall(const torrent::Object::list_type& args) {
   return resultRaw;
 }
 
+// The snapshot commands are called without the global lock, see
+// CommandMap::flag_no_lock. They must not touch anything but the
+// snapshot they hold.
+std::shared_ptr<const core::DownloadSnapshot>
+snapshot_current() {
+  auto snapshot = control->core()->snapshot();
+
+  if (snapshot == nullptr)
+    throw torrent::input_error(
+      "No snapshot published, see system.snapshot.interval.");
+
+  return snapshot;
+}
+
+int
+snapshot_field(const torrent::Object& arg) {
+  int field = core::DownloadSnapshot::field_index(arg.as_string());
+
+  if (field == -1)
+    throw torrent::input_error("Command \"" + arg.as_string() +
+                               "\" is not available in snapshots.");
+
+  return field;
+}
+
+torrent::Object
+snapshot_d_get(const torrent::Object::list_type& args) {
+  if (args.size() != 2)
+    throw torrent::input_error("Wrong argument count.");
+
+  auto snapshot = snapshot_current();
+  auto entry    = snapshot->find(args.front().as_string());
+
+  if (entry == nullptr)
+    throw torrent::input_error("Could not find download in snapshot.");
+
+  return core::DownloadSnapshot::get(*entry, snapshot_field(args.back()));
+}
+
+torrent::Object
+snapshot_d_multicall(const torrent::Object::list_type& args) {
+  if (args.empty())
+    throw torrent::input_error("Too few arguments.");
+
+  auto        snapshot = snapshot_current();
+  const auto* view     = snapshot->find_view(
+    !args.front().as_string().empty() ? args.front().as_string() : "default");
+
+  if (view == nullptr)
+    throw torrent::input_error("Could not find view.");
+
+  std::vector<int> fields;
+  fields.reserve(args.size() - 1);
+
+  for (auto itr = std::next(args.begin()); itr != args.end(); ++itr) {
+    fields.push_back(snapshot_field(*itr));
+  }
+
+  auto  resultRaw = torrent::Object::create_list();
+  auto& result    = resultRaw.as_list();
+
+  result.resize(view->size(), torrent::Object::create_list());
+
+  for (size_t i = 0; i < view->size(); ++i) {
+    const auto&                 entry = snapshot->entry((*view)[i]);
+    torrent::Object::list_type& row   = result[i].as_list();
+
+    row.reserve(fields.size());
+
+    for (const auto& field : fields) {
+      row.push_back(core::DownloadSnapshot::get(entry, field));
+    }
+  }
+
+  return resultRaw;
+}
+
 torrent::Object
 d_multicall_filtered(const torrent::Object::list_type& args) {
   if (args.size() < 2)
@@ -499,6 +578,23 @@ initialize_command_events() {
       args, core::Manager::create_start | core::Manager::create_raw_data);
   });
 
+  CMD2_ANY_LIST("load.raw_batch", [](const auto&, const auto& args) {
+    return control->core()->try_create_download_batch(
+      args, core::Manager::create_quiet);
+  });
+  CMD2_ANY_LIST("load.raw_batch_verbose", [](const auto&, const auto& args) {
+    return control->core()->try_create_download_batch(args, 0);
+  });
+  CMD2_ANY_LIST("load.raw_start_batch", [](const auto&, const auto& args) {
+    return control->core()->try_create_download_batch(
+      args, core::Manager::create_quiet | core::Manager::create_start);
+  });
+  CMD2_ANY_LIST("load.raw_start_batch_verbose",
+                [](const auto&, const auto& args) {
+                  return control->core()->try_create_download_batch(
+                    args, core::Manager::create_start);
+                });
+
   CMD2_ANY_VALUE("close_low_diskspace", [](const auto&, const auto& arg) {
     return apply_close_low_diskspace(arg);
   });
@@ -513,6 +609,24 @@ initialize_command_events() {
     return d_multicall_filtered(args);
   });
 
+  CMD2_VAR_VALUE("system.snapshot.interval", 0);
+
+  CMD2_ANY_NO_LOCK("snapshot.age", [](const auto&, const auto&) {
+    int64_t now = torrent::utils::timer::current().usec();
+
+    return (now - snapshot_current()->time()) / 1000;
+  });
+  CMD2_ANY_NO_LOCK("snapshot.tick", [](const auto&, const auto&) {
+    return (int64_t)snapshot_current()->tick();
+  });
+  CMD2_ANY_LIST_NO_LOCK("snapshot.d.get", [](const auto&, const auto& args) {
+    return snapshot_d_get(args);
+  });
+  CMD2_ANY_LIST_NO_LOCK("snapshot.d.multicall",
+                        [](const auto&, const auto& args) {
+                          return snapshot_d_multicall(args);
+                        });
+
   CMD2_ANY_LIST("directory.watch.added", [](const auto&, const auto& args) {
     return directory_watch_added(args);
   });
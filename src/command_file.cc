@@ -162,4 +162,16 @@ initialize_command_file() {
   });
   CMD2_FILEITR("fi.is_file",
                [](const auto& file, const auto&) { return file->is_file(); });
+
+  // File priorities and flags are part of the saved resume data.
+  for (const char* key : { "f.priority.set",
+                           "f.prioritize_first.disable",
+                           "f.prioritize_first.enable",
+                           "f.prioritize_last.disable",
+                           "f.prioritize_last.enable",
+                           "f.set_create_queued",
+                           "f.set_resize_queued",
+                           "f.unset_create_queued",
+                           "f.unset_resize_queued" })
+    rpc::commands.set_modifier(key);
 }
@@ -3,6 +3,8 @@
 
 #include "buildinfo.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fcntl.h>
 #include <functional>
 #include <stdio.h>
@@ -17,7 +19,9 @@
 #include <torrent/utils/path.h>
 #include <torrent/utils/string_manip.h>
 #include <unistd.h>
+#include <vector>
 
+#include "core/dormant_list.h"
 #include "core/download.h"
 #include "core/download_list.h"
 #include "core/download_store.h"
@@ -25,6 +29,10 @@
 #include "rpc/parse_commands.h"
 #include "rpc/scgi.h"
 #include "utils/file_status_cache.h"
+#include "utils/lock_stats.h"
+#include "utils/stats_segment.h"
+#include "utils/task_stats.h"
+#include "utils/trace.h"
 
 #include "command_helpers.h"
 #include "control.h"
@@ -90,6 +98,167 @@ system_set_cwd(const torrent::Object::string_type& rawArgs) {
   return torrent::Object();
 }
 
+torrent::Object
+system_set_stats_segment(const std::string& path) {
+  utils::StatsSegment* segment = control->core()->stats_segment();
+
+  if (path.empty()) {
+    segment->close();
+    return torrent::Object();
+  }
+
+  if (!segment->open(path))
+    throw torrent::input_error("Could not open stats segment '" + path +
+                               "': " + std::strerror(errno));
+
+  return torrent::Object();
+}
+
+torrent::Object
+histogram_list(const utils::LockStats::histogram_type& histogram) {
+  torrent::Object             result = torrent::Object::create_list();
+  torrent::Object::list_type& list   = result.as_list();
+
+  for (auto count : histogram)
+    list.emplace_back((int64_t)count);
+
+  return result;
+}
+
+torrent::Object
+system_lock_stats() {
+  torrent::Object             result = torrent::Object::create_list();
+  torrent::Object::list_type& list   = result.as_list();
+
+  for (const auto& [acquirer, entry] : utils::LockStats::entries()) {
+    torrent::Object stats = torrent::Object::create_map();
+
+    stats.insert_key("acquirer", acquirer);
+    stats.insert_key("wait_count", (int64_t)entry.wait_count);
+    stats.insert_key("wait_total", (int64_t)entry.wait_total);
+    stats.insert_key("wait_max", (int64_t)entry.wait_max);
+    stats.insert_key("wait_histogram",
+                     histogram_list(entry.wait_histogram));
+    stats.insert_key("hold_count", (int64_t)entry.hold_count);
+    stats.insert_key("hold_total", (int64_t)entry.hold_total);
+    stats.insert_key("hold_max", (int64_t)entry.hold_max);
+    stats.insert_key("hold_histogram",
+                     histogram_list(entry.hold_histogram));
+
+    list.push_back(std::move(stats));
+  }
+
+  return result;
+}
+
+torrent::Object
+system_profile_tasks() {
+  std::vector<utils::TaskStats::container_type::const_iterator> sorted;
+
+  for (auto itr = utils::TaskStats::entries().begin();
+       itr != utils::TaskStats::entries().end();
+       itr++)
+    sorted.push_back(itr);
+
+  std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+    return a->second.total > b->second.total;
+  });
+
+  torrent::Object result = torrent::Object::create_map();
+  torrent::Object tasks  = torrent::Object::create_list();
+
+  for (const auto& itr : sorted) {
+    torrent::Object stats = torrent::Object::create_map();
+
+    stats.insert_key("task", itr->first);
+    stats.insert_key("calls", (int64_t)itr->second.count);
+    stats.insert_key("time_total", (int64_t)itr->second.total);
+    stats.insert_key("time_max", (int64_t)itr->second.max);
+
+    tasks.as_list().push_back(std::move(stats));
+  }
+
+  result.insert_key("ticks", (int64_t)utils::TaskStats::tick_count());
+  result.insert_key("slow_ticks", (int64_t)utils::TaskStats::slow_tick_count());
+  result.insert_key("tick_histogram",
+                    histogram_list(utils::TaskStats::tick_histogram()));
+  result.insert_key("tasks", tasks);
+
+  return result;
+}
+
+torrent::Object
+system_profile_tasks_dump(const std::string& path) {
+  std::string report = utils::TaskStats::report();
+
+  if (path.empty())
+    return report;
+
+  std::FILE* file = std::fopen(path.c_str(), "w");
+
+  if (file == nullptr)
+    throw torrent::input_error("Could not open file: " + path);
+
+  std::fwrite(report.data(), 1, report.size(), file);
+  std::fclose(file);
+
+  return torrent::Object();
+}
+
+// Commands that have been called since profiling was last reset, the
+// most time consuming first.
+torrent::Object
+system_profile_commands() {
+  struct command_stats {
+    const char* key;
+    uint64_t    calls;
+    uint64_t    time;
+    uint64_t    time_max;
+    uint64_t    allocations;
+  };
+
+  // Commands flagged flag_no_lock update their counters while this
+  // runs, so sort a copy taken once.
+  std::vector<command_stats> called;
+
+  for (const auto& entry : rpc::commands) {
+    const rpc::command_map_profile& profile = entry.second.m_profile;
+
+    uint64_t calls = profile.m_calls.load(std::memory_order_relaxed);
+
+    if (calls == 0)
+      continue;
+
+    called.push_back(
+      { entry.first,
+        calls,
+        profile.m_time.load(std::memory_order_relaxed),
+        profile.m_timeMax.load(std::memory_order_relaxed),
+        profile.m_allocations.load(std::memory_order_relaxed) });
+  }
+
+  std::sort(called.begin(), called.end(), [](const auto& a, const auto& b) {
+    return a.time > b.time;
+  });
+
+  torrent::Object             result = torrent::Object::create_list();
+  torrent::Object::list_type& list   = result.as_list();
+
+  for (const auto& command : called) {
+    torrent::Object stats = torrent::Object::create_map();
+
+    stats.insert_key("command", std::string(command.key));
+    stats.insert_key("calls", (int64_t)command.calls);
+    stats.insert_key("time_total", (int64_t)command.time);
+    stats.insert_key("time_max", (int64_t)command.time_max);
+    stats.insert_key("allocations", (int64_t)command.allocations);
+
+    list.push_back(std::move(stats));
+  }
+
+  return result;
+}
+
 inline torrent::Object::list_const_iterator
 post_increment(torrent::Object::list_const_iterator&       itr,
                const torrent::Object::list_const_iterator& last) {
@@ -201,10 +370,34 @@ cmd_file_append(const torrent::Object::list_type& args) {
   return torrent::Object();
 }
 
+static const core::DormantList::entry_type&
+dormant_find(const std::string& hash) {
+  return control->core()->dormant_list()->find_throw(
+    core::DormantList::hash_from_hex(hash));
+}
+
+torrent::Object
+cmd_session_dormant_custom(const torrent::Object::list_type& args) {
+  if (args.size() != 2)
+    throw torrent::input_error("Invalid number of arguments.");
+
+  const core::DormantList::entry_type& entry =
+    dormant_find(args.front().as_string());
+  const std::string& key = args.back().as_string();
+
+  if (key.size() == 1 && key[0] >= '1' && key[0] <= '5')
+    return entry.custom_n[key[0] - '1'];
+
+  auto itr = entry.custom.find(key);
+
+  return itr != entry.custom.end() ? itr->second : std::string();
+}
+
 void
 initialize_command_local() {
   core::DownloadList*    dList        = control->core()->download_list();
   core::DownloadStore*   dStore       = control->core()->download_store();
+  core::DormantList*     dDormant     = control->core()->dormant_list();
   torrent::ChunkManager* chunkManager = torrent::chunk_manager();
   torrent::FileManager*  fileManager  = torrent::file_manager();
 
@@ -256,6 +449,21 @@ initialize_command_local() {
     return torrent::utils::timer::current_usec();
   });
 
+  CMD2_ANY("system.event.defer", [](const auto&, const auto&) {
+    return (int64_t)control->core()->download_list()->is_deferring_events();
+  });
+  CMD2_ANY_VALUE_V("system.event.defer.set",
+                   [](const auto&, const auto& state) {
+                     control->core()->download_list()->set_defer_events(state);
+                     return torrent::Object();
+                   });
+  CMD2_ANY("system.event.deferred", [](const auto&, const auto&) {
+    return (int64_t)control->core()->download_list()->events_deferred();
+  });
+  CMD2_ANY("system.event.coalesced", [](const auto&, const auto&) {
+    return (int64_t)control->core()->download_list()->events_coalesced();
+  });
+
   CMD2_ANY_VALUE_V("system.umask.set",
                    [](const auto&, const auto& mode) { return umask(mode); });
 
@@ -267,7 +475,117 @@ initialize_command_local() {
   CMD2_ANY_V("system.shutdown.quick", [](const auto&, const auto&) {
     return control->receive_quick_shutdown();
   });
+  CMD2_ANY_V("system.restart", [](const auto&, const auto&) {
+    return control->receive_restart();
+  });
   CMD2_REDIRECT_GENERIC_NO_EXPORT("system.shutdown", "system.shutdown.normal");
+  CMD2_ANY("system.shutdown.deadline", [](const auto&, const auto&) {
+    return (int64_t)control->shutdown_deadline();
+  });
+  CMD2_ANY_VALUE_V("system.shutdown.deadline.set",
+                   [](const auto&, const auto& seconds) {
+                     if (seconds < 0 || seconds > 3600)
+                       throw torrent::input_error("Invalid shutdown deadline.");
+
+                     control->set_shutdown_deadline(seconds);
+                     return torrent::Object();
+                   });
+
+  CMD2_ANY("system.lock_stats",
+           [](const auto&, const auto&) { return system_lock_stats(); });
+  CMD2_ANY_V("system.lock_stats.reset", [](const auto&, const auto&) {
+    return utils::LockStats::reset();
+  });
+  CMD2_ANY("system.lock_stats.enabled", [](const auto&, const auto&) {
+    return utils::LockStats::is_enabled();
+  });
+  CMD2_ANY_VALUE_V("system.lock_stats.enabled.set",
+                   [](const auto&, const auto& state) {
+                     return utils::LockStats::set_enabled(state);
+                   });
+
+  CMD2_ANY("system.profile.commands", [](const auto&, const auto&) {
+    return system_profile_commands();
+  });
+  CMD2_ANY_V("system.profile.commands.reset", [](const auto&, const auto&) {
+    return rpc::commands.profile_reset();
+  });
+  CMD2_ANY("system.profile.commands.enabled", [](const auto&, const auto&) {
+    return rpc::commands.is_profiling();
+  });
+  CMD2_ANY_VALUE_V("system.profile.commands.enabled.set",
+                   [](const auto&, const auto& state) {
+                     return rpc::commands.set_profiling(state);
+                   });
+
+  CMD2_ANY("system.profile.tasks", [](const auto&, const auto&) {
+    return system_profile_tasks();
+  });
+  CMD2_ANY_STRING("system.profile.tasks.dump",
+                  [](const auto&, const auto& path) {
+                    return system_profile_tasks_dump(path);
+                  });
+  CMD2_ANY_V("system.profile.tasks.reset", [](const auto&, const auto&) {
+    return utils::TaskStats::reset();
+  });
+  CMD2_ANY("system.profile.tasks.enabled", [](const auto&, const auto&) {
+    return utils::TaskStats::is_enabled();
+  });
+  CMD2_ANY_VALUE_V("system.profile.tasks.enabled.set",
+                   [](const auto&, const auto& state) {
+                     return utils::TaskStats::set_enabled(state);
+                   });
+  CMD2_ANY("system.profile.tasks.slow_tick", [](const auto&, const auto&) {
+    return (int64_t)utils::TaskStats::slow_tick() / 1000;
+  });
+  CMD2_ANY_VALUE_V("system.profile.tasks.slow_tick.set",
+                   [](const auto&, const auto& msec) {
+                     if (msec < 0)
+                       throw torrent::input_error("Invalid slow tick time.");
+
+                     return utils::TaskStats::set_slow_tick(msec * 1000);
+                   });
+
+#ifdef RT_USE_TRACING
+  CMD2_ANY("system.trace.enabled", [](const auto&, const auto&) {
+    return utils::Trace::is_enabled();
+  });
+  CMD2_ANY_VALUE_V("system.trace.enabled.set",
+                   [](const auto&, const auto& state) {
+                     return utils::Trace::set_enabled(state);
+                   });
+  CMD2_ANY_STRING_V("system.trace.dump", [](const auto&, const auto& path) {
+    return utils::Trace::write(path);
+  });
+  CMD2_ANY_V("system.trace.clear",
+             [](const auto&, const auto&) { return utils::Trace::clear(); });
+  CMD2_ANY("system.trace.slow_request", [](const auto&, const auto&) {
+    return (int64_t)utils::Trace::slow_request() / 1000;
+  });
+  CMD2_ANY_VALUE_V("system.trace.slow_request.set",
+                   [](const auto&, const auto& msec) {
+                     if (msec < 0)
+                       throw torrent::input_error("Invalid slow request time.");
+
+                     return utils::Trace::set_slow_request(msec * 1000);
+                   });
+  CMD2_ANY("system.trace.directory", [](const auto&, const auto&) {
+    return utils::Trace::directory();
+  });
+  CMD2_ANY_STRING_V("system.trace.directory.set",
+                    [](const auto&, const auto& path) {
+                      return utils::Trace::set_directory(path);
+                    });
+#endif
+
+  CMD2_ANY("system.stats_segment", [](const auto&, const auto&) {
+    return control->core()->stats_segment()->path();
+  });
+  CMD2_ANY_STRING("system.stats_segment.set",
+                  [](const auto&, const auto& path) {
+                    return system_set_stats_segment(path);
+                  });
+  CMD2_VAR_VALUE("system.stats_segment.interval", 1000);
 
   CMD2_ANY("system.cwd",
            [](const auto&, const auto&) { return system_get_cwd(); });
@@ -377,6 +695,117 @@ initialize_command_local() {
     return dList->session_save();
   });
 
+  CMD2_ANY("session.save.async", [dStore](const auto&, const auto&) {
+    return (int64_t)dStore->is_async();
+  });
+  CMD2_ANY_VALUE_V("session.save.async.set",
+                   [dStore](const auto&, const auto& state) {
+                     dStore->set_async(state);
+                     return torrent::Object();
+                   });
+  CMD2_ANY("session.save.pending", [dStore](const auto&, const auto&) {
+    return (int64_t)dStore->pending_writes();
+  });
+
+  CMD2_ANY("session.dormant", [dDormant](const auto&, const auto&) {
+    return (int64_t)dDormant->is_enabled();
+  });
+  CMD2_ANY_VALUE_V("session.dormant.set",
+                   [dDormant](const auto&, const auto& state) {
+                     dDormant->set_enabled(state);
+                     return torrent::Object();
+                   });
+  CMD2_ANY("session.dormant.size", [dDormant](const auto&, const auto&) {
+    return (int64_t)dDormant->size();
+  });
+  CMD2_ANY("session.dormant.list", [dDormant](const auto&, const auto&) {
+    torrent::Object             result = torrent::Object::create_list();
+    torrent::Object::list_type& list   = result.as_list();
+
+    for (const auto& hash : dDormant->hashes()) {
+      list.push_back(torrent::utils::transform_hex_str(hash));
+    }
+
+    return result;
+  });
+  CMD2_ANY_STRING("session.dormant.name",
+                  [](const auto&, const auto& hash) {
+                    return dormant_find(hash).name;
+                  });
+  CMD2_ANY_STRING("session.dormant.directory",
+                  [](const auto&, const auto& hash) {
+                    return dormant_find(hash).directory;
+                  });
+  CMD2_ANY_STRING("session.dormant.size_bytes",
+                  [](const auto&, const auto& hash) {
+                    return dormant_find(hash).size_bytes;
+                  });
+  CMD2_ANY_STRING("session.dormant.chunks_done",
+                  [](const auto&, const auto& hash) {
+                    return dormant_find(hash).chunks_done;
+                  });
+  CMD2_ANY_LIST("session.dormant.custom", [](const auto&, const auto& args) {
+    return cmd_session_dormant_custom(args);
+  });
+  CMD2_ANY_STRING_V(
+    "session.dormant.wake", [dDormant](const auto&, const auto& hash) {
+      dormant_find(hash);
+
+      if (dDormant->wake(core::DormantList::hash_from_hex(hash)) == nullptr)
+        throw torrent::input_error("Could not wake dormant torrent.");
+    });
+
+  CMD2_ANY("session.load.threads", [dStore](const auto&, const auto&) {
+    return (int64_t)dStore->load_threads();
+  });
+  CMD2_ANY_VALUE_V("session.load.threads.set",
+                   [dStore](const auto&, const auto& threads) {
+                     if (threads < 0 || threads > 256)
+                       throw torrent::input_error("Invalid thread count.");
+
+                     dStore->set_load_threads(threads);
+                     return torrent::Object();
+                   });
+
+  // Setters called on files and trackers can't be traced back to their
+  // download, so they make every download dirty.
+  rpc::commands.slot_modified() = [dList](const rpc::target_type& target) {
+    switch (std::get<0>(target)) {
+      case rpc::command_base::target_download:
+        if (std::get<1>(target) != nullptr)
+          static_cast<core::Download*>(std::get<1>(target))
+            ->set_session_dirty();
+        break;
+      case rpc::command_base::target_file:
+      case rpc::command_base::target_file_itr:
+      case rpc::command_base::target_tracker:
+        dList->set_session_dirty();
+        break;
+      default:
+        break;
+    }
+  };
+
+  CMD2_ANY("session.format", [dStore](const auto&, const auto&) {
+    return std::string(dStore->format_name());
+  });
+  CMD2_ANY_STRING_V("session.format.set",
+                    [dStore](const auto&, const auto& name) {
+                      return dStore->set_format(name);
+                    });
+  CMD2_ANY("session.pack.size", [dStore](const auto&, const auto&) {
+    return (int64_t)dStore->pack()->file_size();
+  });
+  CMD2_ANY("session.pack.live_size", [dStore](const auto&, const auto&) {
+    return (int64_t)dStore->pack()->live_size();
+  });
+  CMD2_ANY("session.pack.compact", [dStore](const auto&, const auto&) {
+    if (!dStore->pack()->is_open())
+      throw torrent::input_error("Session pack is not enabled.");
+
+    return (int64_t)dStore->pack()->compact();
+  });
+
 #define CMD2_EXECUTE(key, flags)                                               \
   CMD2_ANY(key, [](const auto&, const auto& rawArgs) {                         \
     return rpc::execFile.execute_object(rawArgs, flags);                       \
@@ -404,6 +833,16 @@ initialize_command_local() {
   CMD2_EXECUTE("execute.capture_nothrow",
                rpc::ExecFile::flag_expand_tilde | rpc::ExecFile::flag_capture);
 
+#define CMD2_EXECUTE_ASYNC(key, flags)                                         \
+  CMD2_ANY(key, [](const auto&, const auto& rawArgs) {                         \
+    return rpc::execFile.execute_async(rawArgs, flags);                        \
+  });
+
+  CMD2_EXECUTE_ASYNC("execute.async", rpc::ExecFile::flag_expand_tilde);
+  CMD2_EXECUTE_ASYNC("execute.capture.async",
+                     rpc::ExecFile::flag_expand_tilde |
+                       rpc::ExecFile::flag_capture);
+
   CMD2_ANY_LIST("file.append", [](const auto&, const auto& args) {
     return cmd_file_append(args);
   });
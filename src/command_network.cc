@@ -6,7 +6,10 @@
 #include <fstream>
 #include <functional>
 #include <limits>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include <torrent/common.h>
+#include <tuple>
 #include <unistd.h>
 
 #include <torrent/connection_manager.h>
@@ -21,11 +24,14 @@
 #include <torrent/utils/option_strings.h>
 #include <torrent/utils/path.h>
 
+#include "core/dormant_list.h"
 #include "core/download.h"
 #include "core/manager.h"
+#include "rpc/metrics.h"
 #include "rpc/parse.h"
 #include "rpc/parse_commands.h"
 #include "rpc/scgi.h"
+#include "rpc/slow_log.h"
 #include "ui/root.h"
 
 #include "command_helpers.h"
@@ -104,7 +110,14 @@ void
 initialize_rpc() {
   rpc::rpc.initialize(
     [](const char* hash) {
-      return control->core()->download_list()->find_hex_ptr(hash);
+      core::Download* download =
+        control->core()->download_list()->find_hex_ptr(hash);
+
+      if (download != nullptr || control->core()->dormant_list()->size() == 0)
+        return download;
+
+      return control->core()->dormant_list()->wake(
+        core::DormantList::hash_from_hex(hash));
     },
     [](core::Download* d, uint32_t index) { return rpc_find_file(d, index); },
     [](core::Download* d, uint32_t index) {
@@ -130,6 +143,69 @@ initialize_rpc() {
     torrent::LOG_RPC_EVENTS, "XMLRPC initialized with %u functions.", count);
 }
 
+// The family, address and port of 'sa', with IPv4-mapped IPv6
+// addresses as IPv4 since IPv4 addresses may be bound through an IPv6
+// socket.
+static std::tuple<int, std::string, uint16_t>
+scgi_address_key(const sockaddr* sa) {
+  if (sa->sa_family == AF_INET) {
+    auto sin = reinterpret_cast<const sockaddr_in*>(sa);
+
+    return { AF_INET,
+             std::string(reinterpret_cast<const char*>(&sin->sin_addr), 4),
+             ntohs(sin->sin_port) };
+  }
+
+  if (sa->sa_family == AF_INET6) {
+    auto        sin6 = reinterpret_cast<const sockaddr_in6*>(sa);
+    const char* addr = reinterpret_cast<const char*>(&sin6->sin6_addr);
+
+    if (IN6_IS_ADDR_V4MAPPED(&sin6->sin6_addr))
+      return { AF_INET, std::string(addr + 12, 4), ntohs(sin6->sin6_port) };
+
+    return { AF_INET6, std::string(addr, 16), ntohs(sin6->sin6_port) };
+  }
+
+  return { sa->sa_family, std::string(), 0 };
+}
+
+// A listening socket passed on by 'system.restart' is taken over if
+// it is of the same kind and, for local sockets, at the same path or,
+// for TCP sockets, bound to 'address'. A TCP socket bound elsewhere is
+// closed, so that the configured address can be bound.
+int
+take_inherited_scgi(const std::string& path,
+                    const sockaddr*    address = nullptr) {
+  torrent::Object& handoff = control->handoff();
+
+  if (!handoff.is_map() || !handoff.has_key_value("scgi_fd") ||
+      !handoff.has_key_string("scgi_path") ||
+      handoff.get_key_string("scgi_path") != path)
+    return -1;
+
+  int fd = handoff.get_key_value("scgi_fd");
+
+  handoff.erase_key("scgi_fd");
+
+  if (address == nullptr)
+    return fd;
+
+  sockaddr_storage bound;
+  socklen_t        length = sizeof(bound);
+
+  if (::getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &length) == 0 &&
+      scgi_address_key(reinterpret_cast<sockaddr*>(&bound)) ==
+        scgi_address_key(address))
+    return fd;
+
+  lt_log_print(torrent::LOG_RPC_EVENTS,
+               "Closing inherited SCGI socket, it is not bound to the "
+               "configured address.");
+
+  ::close(fd);
+  return -1;
+}
+
 torrent::Object
 apply_scgi(const std::string& arg, int type) {
   if (worker_thread->scgi() != nullptr)
@@ -145,7 +221,7 @@ apply_scgi(const std::string& arg, int type) {
   torrent::utils::socket_address* saPtr;
 
   try {
-    int         port, err;
+    int         port, err, fd;
     char        dummy;
     char        address[1024];
     std::string path;
@@ -186,9 +262,14 @@ apply_scgi(const std::string& arg, int type) {
           throw torrent::input_error("Invalid port number.");
 
         saPtr->set_port(port);
-        scgi->open_port(saPtr,
-                        saPtr->length(),
-                        rpc::call_command_value("network.scgi.dont_route"));
+
+        if ((fd = take_inherited_scgi(std::string(), saPtr->c_sockaddr())) !=
+            -1)
+          scgi->open_inherited(fd, std::string());
+        else
+          scgi->open_port(saPtr,
+                          saPtr->length(),
+                          rpc::call_command_value("network.scgi.dont_route"));
 
         break;
 
@@ -196,6 +277,11 @@ apply_scgi(const std::string& arg, int type) {
       default:
         path = torrent::utils::path_expand(arg);
 
+        if ((fd = take_inherited_scgi(path)) != -1) {
+          scgi->open_inherited(fd, path);
+          break;
+        }
+
         // Try to avoid removing socket opened by another instance
         if (std::filesystem::is_socket(path) &&
             std::filesystem::exists("/proc/net/unix")) {
@@ -233,6 +319,31 @@ apply_scgi(const std::string& arg, int type) {
   return torrent::Object();
 }
 
+torrent::Object
+network_rpc_slow_log() {
+  torrent::Object             result = torrent::Object::create_list();
+  torrent::Object::list_type& list   = result.as_list();
+
+  for (const auto& entry : rpc::SlowLog::entries()) {
+    torrent::Object request = torrent::Object::create_map();
+
+    request.insert_key("time", entry.time);
+    request.insert_key("method", entry.method);
+    request.insert_key("calls", (int64_t)entry.calls);
+    request.insert_key("targets", (int64_t)entry.targets);
+    request.insert_key("request_size", (int64_t)entry.request_size);
+    request.insert_key("response_size", (int64_t)entry.response_size);
+    request.insert_key("lock_wait", (int64_t)entry.lock_wait);
+    request.insert_key("execution", (int64_t)entry.execution);
+    request.insert_key("serialization", (int64_t)entry.serialization);
+    request.insert_key("total", (int64_t)entry.total);
+
+    list.push_back(std::move(request));
+  }
+
+  return result;
+}
+
 void
 initialize_command_network() {
   torrent::ConnectionManager* cm          = torrent::connection_manager();
@@ -396,4 +507,41 @@ initialize_command_network() {
 
   CMD2_REDIRECT_GENERIC("network.xmlrpc.dialect.set", "true");
   CMD2_REDIRECT_GENERIC("network.xmlrpc.size_limit.set", "true");
+
+  CMD2_ANY("network.rpc.slow_log", [](const auto&, const auto&) {
+    return network_rpc_slow_log();
+  });
+  CMD2_ANY_V("network.rpc.slow_log.clear",
+             [](const auto&, const auto&) { return rpc::SlowLog::clear(); });
+  CMD2_ANY("network.rpc.slow_log.threshold", [](const auto&, const auto&) {
+    return (int64_t)rpc::SlowLog::threshold() / 1000;
+  });
+  CMD2_ANY_VALUE_V("network.rpc.slow_log.threshold.set",
+                   [](const auto&, const auto& msec) {
+                     if (msec < 0)
+                       throw torrent::input_error("Invalid threshold.");
+
+                     return rpc::SlowLog::set_threshold(msec * 1000);
+                   });
+  CMD2_ANY("network.rpc.slow_log.size", [](const auto&, const auto&) {
+    return (int64_t)rpc::SlowLog::max_size();
+  });
+  CMD2_ANY_VALUE_V("network.rpc.slow_log.size.set",
+                   [](const auto&, const auto& size) {
+                     if (size < 1 || size > 65536)
+                       throw torrent::input_error("Invalid slow log size.");
+
+                     return rpc::SlowLog::set_max_size(size);
+                   });
+  CMD2_ANY("network.rpc.slow_log.file", [](const auto&, const auto&) {
+    return rpc::SlowLog::file();
+  });
+  CMD2_ANY_STRING_V("network.rpc.slow_log.file.set",
+                    [](const auto&, const auto& path) {
+                      return rpc::SlowLog::set_file(path);
+                    });
+
+  CMD2_ANY("network.metrics",
+           [](const auto&, const auto&) { return rpc::Metrics::render(); });
+  CMD2_VAR_LIST("network.metrics.views");
 }
@@ -245,4 +245,8 @@ initialize_command_tracker() {
     "dht.throttle.name.set", [](const auto&, const auto& throttleName) {
       return control->dht_manager()->set_throttle_name(throttleName);
     });
+
+  // Whether a tracker is enabled is part of the saved resume data.
+  for (const char* key : { "t.disable", "t.enable", "t.is_enabled.set" })
+    rpc::commands.set_modifier(key);
 }
@@ -81,6 +81,37 @@ apply_view_list() {
   return rawResult;
 }
 
+torrent::Object
+apply_view_stats(const torrent::Object::list_type& args) {
+  torrent::Object            rawResult   = torrent::Object::create_map();
+  torrent::Object::map_type& result      = rawResult.as_map();
+  core::ViewManager*         viewManager = control->view_manager();
+  std::vector<core::View*>   views;
+
+  if (args.empty())
+    views.assign(viewManager->begin(), viewManager->end());
+
+  for (const auto& arg : args)
+    views.push_back(viewManager->find_ptr_throw(arg.as_string()));
+
+  for (const auto& view : views) {
+    const core::View::stats_type& stats = view->stats();
+    torrent::Object&              entry = result[view->name()];
+
+    entry = torrent::Object::create_map();
+    entry.insert_key("size", (int64_t)view->size_visible());
+    entry.insert_key("size_not_visible", (int64_t)view->size_not_visible());
+    entry.insert_key("filter_count", (int64_t)stats.filter_count);
+    entry.insert_key("filter_time", stats.filter_time);
+    entry.insert_key("filter_last", stats.filter_last);
+    entry.insert_key("sort_count", (int64_t)stats.sort_count);
+    entry.insert_key("sort_time", stats.sort_time);
+    entry.insert_key("sort_last", stats.sort_last);
+  }
+
+  return rawResult;
+}
+
 torrent::Object
 apply_view_set(const torrent::Object::list_type& args) {
   if (args.size() != 2)
@@ -155,7 +186,12 @@ cmd_ui_unfocus_download(core::Download* download) {
 torrent::Object
 cmd_view_filter_download(core::Download*                     download,
                          const torrent::Object::string_type& args) {
-  (*control->view_manager()->find_throw(args))->filter_download(download);
+  core::View* view = control->view_manager()->find_ptr_throw(args);
+
+  if (control->view_manager()->is_deferring_filter())
+    view->defer_filter_download(download);
+  else
+    view->filter_download(download);
 
   return torrent::Object();
 }
@@ -213,6 +249,9 @@ initialize_command_ui() {
   CMD2_ANY_LIST("view.set", [](const auto&, const auto& args) {
     return apply_view_set(args);
   });
+  CMD2_ANY_LIST("view.stats", [](const auto&, const auto& args) {
+    return apply_view_stats(args);
+  });
 
   CMD2_ANY_LIST("view.filter", [](const auto&, const auto& args) {
     return apply_view_event(&core::ViewManager::set_filter, args);
@@ -225,6 +264,14 @@ initialize_command_ui() {
   });
   CMD2_VAR_STRING("view.filter.temp.excluded", "default,started,stopped");
   CMD2_VAR_BOOL("view.filter.temp.log", 0);
+  CMD2_ANY("view.filter.temp.index", [](const auto&, const auto&) {
+    return (int64_t)control->core()->download_list()->is_indexing_names();
+  });
+  CMD2_ANY_VALUE_V("view.filter.temp.index.set",
+                   [](const auto&, const auto& state) {
+                     control->core()->download_list()->set_index_names(state);
+                     return torrent::Object();
+                   });
 
   CMD2_ANY_LIST("view.sort", [](const auto&, const auto& args) {
     return apply_view_sort(args);
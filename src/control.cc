@@ -3,16 +3,25 @@
 
 #include "buildinfo.h"
 
+#include <algorithm>
 #include <csignal>
+#include <cstdio>
 #include <iostream>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include <torrent/connection_manager.h>
+#include <torrent/exceptions.h>
 #include <torrent/utils/directory_events.h>
+#include <torrent/utils/log.h>
 
+#include "core/curl_stack.h"
 #include "core/dht_manager.h"
+#include "core/dormant_list.h"
+#include "core/download.h"
+#include "core/download_list.h"
 #include "core/download_store.h"
+#include "core/handoff.h"
 #include "core/http_queue.h"
 #include "core/manager.h"
 #include "core/view_manager.h"
@@ -26,7 +35,9 @@
 #include "rpc/object_storage.h"
 #include "rpc/parse_commands.h"
 #include "rpc/scgi.h"
+#include "rpc/slow_log.h"
 #include "ui/root.h"
+#include "utils/socket_fd.h"
 
 #include "control.h"
 
@@ -49,6 +60,7 @@ Control::Control()
     [this](const auto& key) { m_input->pressed(key); });
 
   m_taskShutdown.slot() = [this] { handle_shutdown(); };
+  m_taskRestart.slot()  = [this] { handle_restart(); };
 
   m_commandScheduler->set_slot_error_message(
     [this](const std::string& msg) { m_core->push_log_std(msg); });
@@ -98,8 +110,11 @@ void
 Control::cleanup() {
   //  delete m_scgi; m_scgi = NULL;
   rpc::rpc.cleanup();
+  rpc::SlowLog::set_file("");
+  rpc::execFile.cleanup();
 
   priority_queue_erase(&taskScheduler, &m_taskShutdown);
+  priority_queue_erase(&taskScheduler, &m_taskRestart);
 
   if (display::Canvas::isInitialized()) {
     m_inputStdin->remove(torrent::main_thread()->poll());
@@ -128,25 +143,37 @@ Control::is_shutdown_completed() {
   if (!m_shutdownQuick)
     return false;
 
+  torrent::utils::timer now = torrent::utils::timer::current();
+  bool                  completed;
+
   // Urgent shutdown: disregard unfinished requests and save session
   if (m_shutdownQuick > 18) {
     if (!display::Canvas::isInitialized()) {
       std::cout << "rTorrent: urgently shutting down..." << std::endl;
     }
-    return true;
-  }
+    completed = true;
 
-  if (worker_thread->is_active()) {
-    return false;
+  } else if (m_shutdownDeadline != 0 && m_shutdownStart.usec() != 0 &&
+             now >= m_shutdownStart +
+                      torrent::utils::timer::from_seconds(m_shutdownDeadline)) {
+    if (!display::Canvas::isInitialized()) {
+      std::cout << "rTorrent: shutdown deadline reached..." << std::endl;
+    }
+    completed = true;
+
+  } else {
+    // Tracker requests can be disowned, so wait for these to
+    // finish. The edge case of torrent http downloads may delay
+    // shutdown.
+    completed = !worker_thread->is_active() &&
+                core()->http_stack()->empty() &&
+                core()->http_queue()->empty() && torrent::is_inactive();
   }
 
-  // Tracker requests can be disowned, so wait for these to
-  // finish. The edge case of torrent http downloads may delay
-  // shutdown.
-  if (!core()->http_stack()->empty() || !core()->http_queue()->empty())
-    return false;
+  if (completed)
+    m_shutdownCompleted = now;
 
-  return torrent::is_inactive();
+  return completed;
 }
 
 void
@@ -167,6 +194,22 @@ Control::handle_shutdown() {
     worker_thread->queue_item(&ThreadBase::stop_thread);
   }
 
+  bool first = m_shutdownStart.usec() == 0;
+
+  if (first) {
+    m_shutdownStart = torrent::utils::timer::current();
+
+    // Let all stop announces go out at once, using the sockets freed
+    // by closing the peer connections.
+    if (m_shutdownDeadline != 0)
+      m_core->http_stack()->set_max_active(
+        std::max(m_core->http_stack()->max_active(),
+                 torrent::connection_manager()->max_size()));
+  }
+
+  core::DownloadStore* store = m_core->download_store();
+  store->begin_batch();
+
   if (!m_shutdownQuick) {
     torrent::connection_manager()->listen_close();
     m_directory_events->close();
@@ -175,6 +218,11 @@ Control::handle_shutdown() {
     m_core->shutdown(true);
   }
 
+  store->end_batch();
+
+  if (first)
+    m_shutdownStopped = torrent::utils::timer::current();
+
   if (!m_taskShutdown.is_queued()) {
     priority_queue_insert(&taskScheduler,
                           &m_taskShutdown,
@@ -193,3 +241,162 @@ Control::handle_shutdown() {
 
   m_shutdownReceived = false;
 }
+
+void
+Control::shutdown_save() {
+  torrent::utils::timer flush_start = torrent::utils::timer::current();
+
+  m_core->download_store()->set_sync_once(m_shutdownDeadline != 0);
+  m_core->download_list()->session_save();
+
+  torrent::utils::timer flush_end = torrent::utils::timer::current();
+
+  if (m_shutdownStart.usec() == 0)
+    return;
+
+  if (m_shutdownCompleted.usec() == 0)
+    m_shutdownCompleted = flush_start;
+
+  auto seconds = [](torrent::utils::timer first, torrent::utils::timer last) {
+    return (last - first).usec() / 1e6;
+  };
+
+  char timing[256];
+
+  std::snprintf(timing,
+                sizeof(timing),
+                "%.2fs: stop %.2fs, announces %.2fs, session flush %.2fs",
+                seconds(m_shutdownStart, flush_end),
+                seconds(m_shutdownStart, m_shutdownStopped),
+                seconds(m_shutdownStopped, m_shutdownCompleted),
+                seconds(flush_start, flush_end));
+
+  lt_log_print(torrent::LOG_NOTICE, "Shutdown took %s.", timing);
+
+  if (!display::Canvas::isInitialized())
+    std::cout << "rTorrent: shutdown took " << timing << std::endl;
+}
+
+void
+Control::receive_restart() {
+  if (m_shutdownReceived || m_shutdownQuick)
+    throw torrent::input_error("Shutdown in progress.");
+
+  if (m_arguments.empty())
+    throw torrent::input_error("Restart is not available.");
+
+  if (rpc::execFile.pending() != 0)
+    throw torrent::input_error("Commands started by execute.async are "
+                               "still running.");
+
+  if (m_taskRestart.is_queued())
+    return;
+
+  priority_queue_insert(&taskScheduler,
+                        &m_taskRestart,
+                        cachedTime + torrent::utils::timer::from_seconds(1));
+}
+
+void
+Control::set_arguments(int argc, char** argv) {
+  m_arguments = core::handoff_arguments(argc, argv);
+}
+
+void
+Control::release_handoff() {
+  if (m_handoff.is_map() && m_handoff.has_key_value("scgi_fd"))
+    ::close(m_handoff.get_key_value("scgi_fd"));
+
+  m_handoff = torrent::Object();
+}
+
+void
+Control::handle_restart() {
+  core::DownloadList*  list  = m_core->download_list();
+  core::DownloadStore* store = m_core->download_store();
+
+  // The new process could neither reap the commands started since the
+  // restart was requested nor call back for them.
+  if (rpc::execFile.pending() != 0) {
+    lt_log_print(torrent::LOG_NOTICE,
+                 "Restart waiting for %zu commands to exit.",
+                 rpc::execFile.pending());
+
+    priority_queue_insert(&taskScheduler,
+                          &m_taskRestart,
+                          cachedTime + torrent::utils::timer::from_seconds(1));
+    return;
+  }
+
+  lt_log_print(torrent::LOG_NOTICE,
+               "Restarting with %zu downloads and %zu dormant torrents.",
+               list->size(),
+               m_core->dormant_list()->size());
+
+  // Downloads are closed without a stopped announce, and their
+  // progress saved. The new process starts them again from that.
+  std::vector<core::Download*> active;
+
+  for (const auto& download : *list) {
+    if (download->download()->info()->is_active())
+      active.push_back(download);
+
+    list->close_directly(download);
+    download->set_session_dirty();
+  }
+
+  // The session on disk stays current, in case the new process cannot
+  // use the state passed to it.
+  list->session_save();
+
+  torrent::Object  state = torrent::Object::create_map();
+  torrent::Object& downloads =
+    state.insert_key("downloads", torrent::Object::create_list());
+
+  for (const auto& download : *list) {
+    downloads.insert_back(*download->bencode());
+  }
+
+  state.insert_key("dormant", m_core->dormant_list()->save_list());
+  state.insert_key("listen_port",
+                   (int64_t)torrent::connection_manager()->listen_port());
+
+  core::handoff_fds keep;
+  rpc::SCgi*        scgi = worker_thread->scgi();
+
+  if (scgi != nullptr && scgi->get_fd().is_valid()) {
+    state.insert_key("scgi_fd", (int64_t)scgi->get_fd().get_fd());
+    state.insert_key("scgi_path", scgi->path());
+    keep.push_back(scgi->get_fd().get_fd());
+  }
+
+  torrent::connection_manager()->listen_close();
+  store->disable();
+
+  // Write out pending slow requests, the writer does not survive exec.
+  std::string slow_log = rpc::SlowLog::file();
+  rpc::SlowLog::set_file("");
+
+  bool canvas = display::Canvas::isInitialized();
+  display::Canvas::cleanup();
+
+  core::handoff_exec(m_arguments, state, keep);
+
+  // Only reached if the new process could not be started.
+  if (canvas) {
+    display::Canvas::initialize();
+    m_display->force_redraw();
+  }
+
+  try {
+    store->enable(rpc::call_command_value("session.use_lock"));
+    m_core->listen_open();
+    rpc::SlowLog::set_file(slow_log);
+  } catch (torrent::input_error& e) {
+    lt_log_print(torrent::LOG_ERROR, "Could not resume: %s", e.what());
+  }
+
+  for (const auto& download : active) {
+    list->resume(download, torrent::Download::start_skip_tracker);
+  }
+}
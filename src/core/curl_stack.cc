@@ -9,6 +9,7 @@
 #include "core/curl_get.h"
 #include "core/curl_socket.h"
 #include "core/curl_stack.h"
+#include "utils/usdt.h"
 
 namespace core {
 
@@ -122,6 +123,8 @@ CurlStack::transfer_done(void* handle, const char* msg) {
     throw torrent::internal_error(
       "Could not find CurlGet with the right easy_handle.");
 
+  RT_PROBE3(http_done, (*itr)->url().c_str(), (int)(msg == nullptr), msg);
+
   if (msg == nullptr)
     (*itr)->trigger_done();
   else
@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <cctype>
+#include <memory>
+
+#include <torrent/exceptions.h>
+#include <torrent/hash_string.h>
+#include <torrent/utils/log.h>
+#include <torrent/utils/string_manip.h>
+
+#include "control.h"
+#include "core/download.h"
+#include "core/download_factory.h"
+#include "core/download_list.h"
+#include "core/download_store.h"
+#include "core/dormant_list.h"
+#include "core/manager.h"
+#include "core/session_loader.h"
+
+namespace core {
+
+namespace {
+
+std::string
+string_key(const torrent::Object& object, const char* key) {
+  return object.has_key_string(key) ? object.get_key_string(key)
+                                    : std::string();
+}
+
+int64_t
+value_key(const torrent::Object& object, const char* key) {
+  return object.has_key_value(key) ? object.get_key_value(key) : 0;
+}
+
+int64_t
+info_size(const torrent::Object& info) {
+  if (!info.has_key_list("files"))
+    return value_key(info, "length");
+
+  int64_t size = 0;
+
+  for (const auto& file : info.get_key_list("files")) {
+    if (file.is_map())
+      size += value_key(file, "length");
+  }
+
+  return size;
+}
+
+}
+
+const DormantList::entry_type&
+DormantList::find_throw(const std::string& hash) const {
+  auto itr = m_entries.find(hash);
+
+  if (itr == m_entries.end())
+    throw torrent::input_error("Could not find dormant torrent.");
+
+  return itr->second;
+}
+
+DormantList::hash_list
+DormantList::hashes() const {
+  hash_list result;
+  result.reserve(m_entries.size());
+
+  for (const auto& entry : m_entries) {
+    result.push_back(entry.first);
+  }
+
+  return result;
+}
+
+bool
+DormantList::is_dormant(const torrent::Object& object) {
+  if (!object.is_map() || !object.has_key_map("info") ||
+      !object.has_key_map("rtorrent") || object.has_key("magnet-uri"))
+    return false;
+
+  const torrent::Object& rtorrent = object.get_key("rtorrent");
+
+  return rtorrent.has_key_value("state") &&
+         rtorrent.get_key_value("state") == 0 &&
+         value_key(rtorrent, "hashing") == 0;
+}
+
+void
+DormantList::insert(const std::string&     hash,
+                    const std::string&     filename,
+                    const torrent::Object& object) {
+  const torrent::Object& info     = object.get_key("info");
+  const torrent::Object& rtorrent = object.get_key("rtorrent");
+
+  entry_type entry;
+
+  entry.hash        = hash;
+  entry.filename    = filename;
+  entry.name        = string_key(info, "name");
+  entry.directory   = string_key(rtorrent, "directory");
+  entry.size_bytes  = info_size(info);
+  entry.chunks_done = value_key(rtorrent, "chunks_done");
+
+  for (size_t i = 0; i < entry.custom_n.size(); i++) {
+    entry.custom_n[i] =
+      string_key(rtorrent, ("custom" + std::to_string(i + 1)).c_str());
+  }
+
+  if (rtorrent.has_key_map("custom")) {
+    for (const auto& custom : rtorrent.get_key_map("custom")) {
+      if (custom.second.is_string())
+        entry.custom[custom.first] = custom.second.as_string();
+    }
+  }
+
+  m_entries[hash] = std::move(entry);
+}
+
+torrent::Object
+DormantList::save_list() const {
+  torrent::Object result = torrent::Object::create_list();
+
+  for (const auto& itr : m_entries) {
+    const entry_type& entry = itr.second;
+    torrent::Object&  object =
+      result.insert_back(torrent::Object::create_map());
+
+    object.insert_key("hash", entry.hash);
+    object.insert_key("filename", entry.filename);
+    object.insert_key("name", entry.name);
+    object.insert_key("directory", entry.directory);
+    object.insert_key("size_bytes", entry.size_bytes);
+    object.insert_key("chunks_done", entry.chunks_done);
+
+    torrent::Object& custom_n =
+      object.insert_key("custom_n", torrent::Object::create_list());
+
+    for (const auto& value : entry.custom_n) {
+      custom_n.insert_back(value);
+    }
+
+    torrent::Object& custom =
+      object.insert_key("custom", torrent::Object::create_map());
+
+    for (const auto& value : entry.custom) {
+      custom.insert_key(value.first, value.second);
+    }
+  }
+
+  return result;
+}
+
+void
+DormantList::load_list(const torrent::Object& list) {
+  if (!list.is_list())
+    return;
+
+  for (const auto& object : list.as_list()) {
+    if (!object.is_map() || !object.has_key_string("hash"))
+      continue;
+
+    entry_type entry;
+
+    entry.hash        = object.get_key_string("hash");
+    entry.filename    = string_key(object, "filename");
+    entry.name        = string_key(object, "name");
+    entry.directory   = string_key(object, "directory");
+    entry.size_bytes  = value_key(object, "size_bytes");
+    entry.chunks_done = value_key(object, "chunks_done");
+
+    if (object.has_key_list("custom_n")) {
+      const auto& custom_n = object.get_key_list("custom_n");
+
+      for (size_t i = 0; i < entry.custom_n.size() && i < custom_n.size();
+           i++) {
+        if (custom_n[i].is_string())
+          entry.custom_n[i] = custom_n[i].as_string();
+      }
+    }
+
+    if (object.has_key_map("custom")) {
+      for (const auto& custom : object.get_key_map("custom")) {
+        if (custom.second.is_string())
+          entry.custom[custom.first] = custom.second.as_string();
+      }
+    }
+
+    m_entries[entry.hash] = std::move(entry);
+  }
+}
+
+Download*
+DormantList::wake(const std::string& hash) {
+  auto itr = m_entries.find(hash);
+
+  if (itr == m_entries.end())
+    return nullptr;
+
+  std::string filename = itr->second.filename;
+
+  DownloadStore*           store = control->core()->download_store();
+  SessionLoader::part_list parts;
+
+  bool read = filename.empty() ? store->read_packed(hash, &parts)
+                               : DownloadStore::read_files(filename, &parts);
+
+  auto object = std::make_unique<torrent::Object>();
+
+  if (!read || !SessionLoader::decode(parts, object.get())) {
+    lt_log_print(torrent::LOG_ERROR,
+                 "Could not read dormant session torrent %s.",
+                 torrent::utils::transform_hex_str(hash).c_str());
+    return nullptr;
+  }
+
+  // The factory is immediate, so it is done when commit() returns or
+  // throws, and is owned here rather than deleting itself.
+  auto f = std::make_unique<DownloadFactory>(control->core());
+
+  f->set_session(true);
+  f->set_immediate(true);
+  f->slot_finished([]() {});
+
+  f->load_object(object.release(), filename);
+
+  try {
+    f->commit();
+  } catch (const torrent::input_error& e) {
+    lt_log_print(torrent::LOG_ERROR,
+                 "Could not wake dormant session torrent %s: %s",
+                 torrent::utils::transform_hex_str(hash).c_str(),
+                 e.what());
+    return nullptr;
+  }
+
+  DownloadList* list = control->core()->download_list();
+  auto download_itr  = list->find(*torrent::HashString::cast_from(hash));
+
+  if (download_itr == list->end())
+    return nullptr;
+
+  m_entries.erase(hash);
+  return *download_itr;
+}
+
+std::string
+DormantList::hash_from_hex(const std::string& hex) {
+  if (hex.size() != 40)
+    return std::string();
+
+  std::string result(20, '\0');
+
+  for (size_t i = 0; i < 20; i++) {
+    unsigned char high = hex[i * 2];
+    unsigned char low  = hex[i * 2 + 1];
+
+    if (!std::isxdigit(high) || !std::isxdigit(low))
+      return std::string();
+
+    result[i] = (torrent::utils::hexchar_to_value(high) << 4) +
+                torrent::utils::hexchar_to_value(low);
+  }
+
+  return result;
+}
+
+}
@@ -15,6 +15,7 @@
 
 #include "control.h"
 #include "core/download.h"
+#include "core/download_list.h"
 #include "core/manager.h"
 
 namespace core {
@@ -70,6 +71,27 @@ Download::set_priority(uint32_t p) {
     torrent::download_set_priority(m_download, p * p);
 
   bencode()->get_key("rtorrent").insert_key("priority", (int64_t)p);
+  control->core()->download_list()->invalidate_columns();
+
+  m_sessionDirty = true;
+}
+
+bool
+Download::is_session_dirty() {
+  if (m_sessionDirty)
+    return true;
+
+  const torrent::Object& rtorrent = bencode()->get_key("rtorrent");
+
+  // Older session entries may lack some of these, which then need
+  // saving.
+  auto differs = [&rtorrent](const char* key, int64_t value) {
+    return !rtorrent.has_key_value(key) || rtorrent.get_key_value(key) != value;
+  };
+
+  return differs("chunks_done", m_download.file_list()->completed_chunks()) ||
+         differs("total_uploaded", info()->up_rate()->total()) ||
+         differs("total_downloaded", info()->down_rate()->total());
 }
 
 uint32_t
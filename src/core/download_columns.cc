@@ -0,0 +1,549 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <torrent/data/file_list.h>
+#include <torrent/download.h>
+#include <torrent/download_info.h>
+#include <torrent/rate.h>
+
+#include "core/download.h"
+#include "core/download_columns.h"
+
+namespace core {
+
+namespace {
+
+const char* column_names[DownloadColumns::COLUMN_MAX_SIZE] = {
+  "d.state",
+  "d.complete",
+  "d.hashing",
+  "d.is_open",
+  "d.is_active",
+  "d.priority",
+  "d.up.rate",
+  "d.up.total",
+  "d.down.rate",
+  "d.down.total",
+  "d.bytes_done",
+  "d.completed_bytes",
+  "d.left_bytes",
+  "d.size_bytes",
+  "d.ratio",
+  "d.state_changed",
+  "d.timestamp.started",
+  "d.timestamp.finished",
+};
+
+int64_t
+rtorrent_value(Download* download, const char* key) {
+  const torrent::Object& rtorrent = download->bencode()->get_key("rtorrent");
+
+  return rtorrent.has_key_value(key) ? rtorrent.get_key_value(key) : 0;
+}
+
+// Column commands are accepted as either '((d.foo))' or 'd.foo='.
+int
+compile_column(const torrent::Object& cmd) {
+  if (cmd.is_dict_key())
+    return cmd.as_dict_obj().is_empty()
+             ? DownloadColumns::column_index(cmd.as_dict_key())
+             : -1;
+
+  if (cmd.is_string())
+    return DownloadColumns::column_index(cmd.as_string());
+
+  return -1;
+}
+
+// Mirrors 'value' with a single decimal argument.
+bool
+compile_value(const torrent::Object& args, int64_t* dest) {
+  if (!args.is_list() || args.as_list().size() != 1)
+    return false;
+
+  const torrent::Object& arg = args.as_list().front();
+
+  if (arg.is_value()) {
+    *dest = arg.as_value();
+    return true;
+  }
+
+  if (!arg.is_string() || arg.as_string().empty())
+    return false;
+
+  char* endptr;
+  *dest = std::strtoll(arg.as_string().c_str(), &endptr, 10);
+
+  while (*endptr == ' ' || *endptr == '\n')
+    ++endptr;
+
+  return *endptr == '\0';
+}
+
+bool
+compile_operand(const torrent::Object& cmd, column_filter* dest) {
+  dest->column = compile_column(cmd);
+
+  if (dest->column != -1) {
+    dest->type = column_filter::NODE_COLUMN;
+    return true;
+  }
+
+  if (!cmd.is_dict_key())
+    return false;
+
+  dest->type = column_filter::NODE_CONSTANT;
+
+  if (cmd.as_dict_key() == "true" || cmd.as_dict_key() == "false") {
+    dest->value = cmd.as_dict_key() == "true";
+    return true;
+  }
+
+  return cmd.as_dict_key() == "value" &&
+         compile_value(cmd.as_dict_obj(), &dest->value);
+}
+
+bool compile_boolean(const torrent::Object& cmd, column_filter* dest);
+
+// Mirrors apply_not, which only looks at the first list element.
+bool
+compile_not(const torrent::Object& args, column_filter* dest) {
+  if (args.is_list() && !args.as_list().empty())
+    return compile_not(args.as_list().front(), dest);
+
+  if (args.is_value()) {
+    dest->type  = column_filter::NODE_CONSTANT;
+    dest->value = !args.as_value();
+    return true;
+  }
+
+  if (!args.is_dict_key())
+    return false;
+
+  dest->type = column_filter::NODE_NOT;
+  dest->children.resize(1);
+
+  return compile_boolean(args, &dest->children.front());
+}
+
+bool
+compile_list(const torrent::Object& args, column_filter* dest) {
+  if (!args.is_list())
+    return false;
+
+  dest->children.resize(args.as_list().size());
+
+  auto child = dest->children.begin();
+
+  for (const auto& arg : args.as_list()) {
+    if (arg.is_value()) {
+      child->type  = column_filter::NODE_CONSTANT;
+      child->value = arg.as_value();
+
+    } else if (arg.is_dict_key()) {
+      if (!compile_boolean(arg, &*child))
+        return false;
+
+    } else {
+      child->type   = column_filter::NODE_COLUMN;
+      child->column = compile_column(arg);
+
+      if (child->column == -1)
+        return false;
+    }
+
+    ++child;
+  }
+
+  return true;
+}
+
+bool
+compile_boolean(const torrent::Object& cmd, column_filter* dest) {
+  if (!cmd.is_dict_key()) {
+    dest->type   = column_filter::NODE_COLUMN;
+    dest->column = compile_column(cmd);
+    return dest->column != -1;
+  }
+
+  const std::string&     key  = cmd.as_dict_key();
+  const torrent::Object& args = cmd.as_dict_obj();
+
+  if (key == "not")
+    return compile_not(args, dest);
+
+  if (key == "and" || key == "or") {
+    dest->type =
+      key == "and" ? column_filter::NODE_AND : column_filter::NODE_OR;
+    return compile_list(args, dest);
+  }
+
+  if (key == "less" || key == "greater" || key == "equal") {
+    if (!args.is_list() || args.as_list().empty())
+      return false;
+
+    dest->type = key == "less"      ? column_filter::NODE_LESS
+                 : key == "greater" ? column_filter::NODE_GREATER
+                                    : column_filter::NODE_EQUAL;
+    dest->children.resize(2);
+
+    return compile_operand(args.as_list().front(), &dest->children[0]) &&
+           compile_operand(args.as_list().back(), &dest->children[1]);
+  }
+
+  return compile_operand(cmd, dest);
+}
+
+struct column_operand {
+  const int64_t* values;
+
+  int64_t operator[](size_t i) const {
+    return values[i];
+  }
+};
+
+struct constant_operand {
+  int64_t value;
+
+  int64_t operator[](size_t) const {
+    return value;
+  }
+};
+
+// Kept as plain loops over contiguous arrays so the compiler can
+// vectorize them.
+template<typename Lhs, typename Rhs, typename Compare>
+inline void
+compare_into(uint8_t* out, size_t size, Lhs lhs, Rhs rhs, Compare compare) {
+  for (size_t i = 0; i < size; i++)
+    out[i] = compare(lhs[i], rhs[i]);
+}
+
+template<typename Lhs, typename Compare>
+inline void
+compare_rhs(uint8_t*                            out,
+            size_t                              size,
+            Lhs                                 lhs,
+            const column_filter&                rhs,
+            const DownloadColumns::column_type* columns,
+            Compare                             compare) {
+  if (rhs.type == column_filter::NODE_COLUMN)
+    compare_into(
+      out, size, lhs, column_operand{ columns[rhs.column].data() }, compare);
+  else
+    compare_into(out, size, lhs, constant_operand{ rhs.value }, compare);
+}
+
+template<typename Compare>
+inline void
+compare_lhs(uint8_t*                            out,
+            size_t                              size,
+            const column_filter&                lhs,
+            const column_filter&                rhs,
+            const DownloadColumns::column_type* columns,
+            Compare                             compare) {
+  if (lhs.type == column_filter::NODE_COLUMN)
+    compare_rhs(out,
+                size,
+                column_operand{ columns[lhs.column].data() },
+                rhs,
+                columns,
+                compare);
+  else
+    compare_rhs(
+      out, size, constant_operand{ lhs.value }, rhs, columns, compare);
+}
+
+}
+
+int
+DownloadColumns::column_index(const std::string& command) {
+  size_t length = command.size();
+
+  if (length != 0 && command[length - 1] == '=')
+    length--;
+
+  for (int i = 0; i < COLUMN_MAX_SIZE; i++)
+    if (std::strlen(column_names[i]) == length &&
+        command.compare(0, length, column_names[i]) == 0)
+      return i;
+
+  return -1;
+}
+
+const char*
+DownloadColumns::column_name(int column) {
+  return column_names[column];
+}
+
+void
+DownloadColumns::clear() {
+  m_downloads.clear();
+  m_rows.clear();
+
+  for (auto& column : m_columns)
+    column.clear();
+}
+
+void
+DownloadColumns::reserve(size_t size) {
+  m_downloads.reserve(size);
+  m_rows.reserve(size);
+
+  for (auto& column : m_columns)
+    column.reserve(size);
+}
+
+// Keep in sync with the respective 'd.*' commands.
+void
+DownloadColumns::push_back(Download* download) {
+  value_type values[COLUMN_MAX_SIZE];
+
+  const torrent::DownloadInfo* info      = download->info();
+  torrent::FileList*           file_list = download->file_list();
+
+  values[COLUMN_STATE]            = rtorrent_value(download, "state");
+  values[COLUMN_COMPLETE]         = rtorrent_value(download, "complete");
+  values[COLUMN_HASHING]          = rtorrent_value(download, "hashing");
+  values[COLUMN_IS_OPEN]          = info->is_open();
+  values[COLUMN_IS_ACTIVE]        = info->is_active();
+  values[COLUMN_PRIORITY]         = download->priority();
+  values[COLUMN_UP_RATE]          = info->up_rate()->rate();
+  values[COLUMN_UP_TOTAL]         = info->up_rate()->total();
+  values[COLUMN_DOWN_RATE]        = info->down_rate()->rate();
+  values[COLUMN_DOWN_TOTAL]       = info->down_rate()->total();
+  values[COLUMN_BYTES_DONE]       = download->download()->bytes_done();
+  values[COLUMN_COMPLETED_BYTES]  = file_list->completed_bytes();
+  values[COLUMN_LEFT_BYTES]       = file_list->left_bytes();
+  values[COLUMN_SIZE_BYTES]       = file_list->size_bytes();
+  values[COLUMN_STATE_CHANGED]    = rtorrent_value(download, "state_changed");
+  values[COLUMN_TIMESTAMP_STARTED] =
+    rtorrent_value(download, "timestamp.started");
+  values[COLUMN_TIMESTAMP_FINISHED] =
+    rtorrent_value(download, "timestamp.finished");
+
+  if (download->is_hash_checking() || values[COLUMN_BYTES_DONE] <= 0)
+    values[COLUMN_RATIO] = 0;
+  else
+    values[COLUMN_RATIO] =
+      (1000 * values[COLUMN_UP_TOTAL]) / values[COLUMN_BYTES_DONE];
+
+  push_back(download, values);
+}
+
+void
+DownloadColumns::push_back(Download*        download,
+                           const value_type values[COLUMN_MAX_SIZE]) {
+  m_rows.emplace(download, m_downloads.size());
+  m_downloads.push_back(download);
+
+  for (int i = 0; i < COLUMN_MAX_SIZE; i++)
+    m_columns[i].push_back(values[i]);
+}
+
+size_t
+DownloadColumns::find(Download* download) const {
+  auto itr = m_rows.find(download);
+
+  return itr != m_rows.end() ? itr->second : size();
+}
+
+bool
+DownloadColumns::compile_filter(const torrent::Object& cmd,
+                                column_filter*         dest) {
+  *dest = column_filter();
+
+  if (cmd.is_empty())
+    return true;
+
+  return compile_boolean(cmd, dest);
+}
+
+bool
+DownloadColumns::compile_sort(const torrent::Object& cmd, column_sort* dest) {
+  *dest = column_sort();
+
+  if (!cmd.is_dict_key() || !cmd.as_dict_obj().is_list() ||
+      cmd.as_dict_obj().as_list().empty())
+    return false;
+
+  const std::string&                key  = cmd.as_dict_key();
+  const torrent::Object::list_type& args = cmd.as_dict_obj().as_list();
+
+  // Both sides of the pair must use the same column for this to be a
+  // sort key.
+  if (key == "less" || key == "greater") {
+    int column = compile_column(args.front());
+
+    if (column == -1 || compile_column(args.back()) != column)
+      return false;
+
+    dest->columns.push_back(column);
+    dest->descending.push_back(key == "greater");
+    return true;
+  }
+
+  if (key != "compare" || args.size() < 2 || !args.front().is_string())
+    return false;
+
+  const std::string& order   = args.front().as_string();
+  auto               current = order.begin();
+
+  for (auto itr = std::next(args.begin()); itr != args.end(); ++itr) {
+    int column = itr->is_string() ? compile_column(*itr) : -1;
+
+    if (column == -1)
+      return false;
+
+    bool descending = false;
+
+    if (current != order.end()) {
+      descending = *current == 'd' || *current == 'D' || *current == '-';
+
+      // Leave reporting bad orders to 'compare'.
+      if (!descending && *current != 'a' && *current != 'A' &&
+          *current != '+')
+        return false;
+
+      ++current;
+    }
+
+    dest->columns.push_back(column);
+    dest->descending.push_back(descending);
+  }
+
+  dest->tie_break = true;
+  return true;
+}
+
+void
+DownloadColumns::filter(const column_filter& plan, mask_type* mask) const {
+  mask->resize(size());
+  evaluate(plan, mask);
+}
+
+void
+DownloadColumns::evaluate(const column_filter& node, mask_type* mask) const {
+  uint8_t* out   = mask->data();
+  size_t   count = mask->size();
+
+  switch (node.type) {
+    case column_filter::NODE_CONSTANT:
+      std::fill(mask->begin(), mask->end(), node.value != 0);
+      break;
+
+    case column_filter::NODE_COLUMN: {
+      const value_type* values = m_columns[node.column].data();
+
+      for (size_t i = 0; i < count; i++)
+        out[i] = values[i] != 0;
+      break;
+    }
+
+    case column_filter::NODE_NOT:
+      evaluate(node.children.front(), mask);
+
+      for (size_t i = 0; i < count; i++)
+        out[i] ^= 1;
+      break;
+
+    case column_filter::NODE_AND:
+    case column_filter::NODE_OR: {
+      bool      is_and = node.type == column_filter::NODE_AND;
+      mask_type tmp(count);
+
+      std::fill(mask->begin(), mask->end(), is_and);
+
+      for (const auto& child : node.children) {
+        evaluate(child, &tmp);
+
+        if (is_and)
+          for (size_t i = 0; i < count; i++)
+            out[i] &= tmp[i];
+        else
+          for (size_t i = 0; i < count; i++)
+            out[i] |= tmp[i];
+      }
+      break;
+    }
+
+    default:
+      evaluate_compare(node, mask);
+      break;
+  }
+}
+
+void
+DownloadColumns::evaluate_compare(const column_filter& node,
+                                  mask_type*           mask) const {
+  const column_filter& lhs = node.children[0];
+  const column_filter& rhs = node.children[1];
+
+  switch (node.type) {
+    case column_filter::NODE_LESS:
+      compare_lhs(
+        mask->data(), mask->size(), lhs, rhs, m_columns, std::less<>());
+      break;
+    case column_filter::NODE_GREATER:
+      compare_lhs(
+        mask->data(), mask->size(), lhs, rhs, m_columns, std::greater<>());
+      break;
+    case column_filter::NODE_EQUAL:
+      compare_lhs(
+        mask->data(), mask->size(), lhs, rhs, m_columns, std::equal_to<>());
+      break;
+    default:
+      break;
+  }
+}
+
+bool
+DownloadColumns::sort(const column_sort&                plan,
+                      std::vector<Download*>::iterator first,
+                      std::vector<Download*>::iterator last) const {
+  size_t count = std::distance(first, last);
+  size_t width = plan.columns.size();
+
+  // Gather the keys in sort order so the comparisons only touch a
+  // contiguous array.
+  std::vector<value_type> keys(count * width);
+  std::vector<uint32_t>   order(count);
+
+  for (size_t i = 0; i < count; i++) {
+    size_t row = find(first[i]);
+
+    if (row == size())
+      return false;
+
+    for (size_t k = 0; k < width; k++)
+      keys[i * width + k] = m_columns[plan.columns[k]][row];
+
+    order[i] = i;
+  }
+
+  std::stable_sort(
+    order.begin(), order.end(), [&](uint32_t left, uint32_t right) {
+      const value_type* lhs = &keys[left * width];
+      const value_type* rhs = &keys[right * width];
+
+      for (size_t k = 0; k < width; k++)
+        if (lhs[k] != rhs[k])
+          return plan.descending[k] ? lhs[k] > rhs[k] : lhs[k] < rhs[k];
+
+      return plan.tie_break && std::less<>()(first[left], first[right]);
+    });
+
+  std::vector<Download*> sorted(count);
+
+  for (size_t i = 0; i < count; i++)
+    sorted[i] = first[order[i]];
+
+  std::copy(sorted.begin(), sorted.end(), first);
+  return true;
+}
+
+}
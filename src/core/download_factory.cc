@@ -2,7 +2,6 @@
 // Copyright (C) 2005-2011, Jari Sundell <jaris@ifi.uio.no>
 
 #include <cstdlib>
-#include <fstream>
 #include <functional>
 #include <sstream>
 #include <stdexcept>
@@ -28,6 +27,7 @@
 #include "core/download.h"
 #include "core/download_factory.h"
 #include "core/download_store.h"
+#include "core/session_file.h"
 
 namespace core {
 
@@ -53,15 +53,9 @@ static bool
 download_factory_add_stream(torrent::Object* root,
                             const char*      key,
                             const char*      filename) {
-  std::fstream stream(filename, std::ios::in | std::ios::binary);
-
-  if (!stream.is_open())
-    return false;
-
   torrent::Object obj;
-  stream >> obj;
 
-  if (!stream.good())
+  if (!session_file_read(filename, &obj))
     return false;
 
   root->insert_key_move(key, obj);
@@ -106,12 +100,33 @@ DownloadFactory::load(const std::string& uri) {
 // This function must be called before DownloadFactory::commit().
 void
 DownloadFactory::load_raw_data(const std::string& input) {
-  if (m_stream)
+  if (m_stream || m_object)
     throw torrent::internal_error(
       "DownloadFactory::load*() called on an object with m_stream != NULL");
 
-  m_stream = new std::stringstream(input);
+  // Decoded here from the caller's buffer, rather than copied into a
+  // stream for DownloadList::create().
+  m_object = new torrent::Object;
   m_loaded = true;
+
+  if (!bencode_parse(input.data(), input.size(), m_object)) {
+    delete m_object;
+    m_object = nullptr;
+  }
+}
+
+void
+DownloadFactory::load_object(torrent::Object*   object,
+                             const std::string& uri) {
+  if (m_stream || m_object)
+    throw torrent::internal_error(
+      "DownloadFactory::load*() called on an object with m_stream != NULL");
+
+  m_uri       = uri;
+  m_object    = object;
+  m_loaded    = true;
+  m_isFile    = !uri.empty();
+  m_isDecoded = true;
 }
 
 void
@@ -148,17 +163,27 @@ DownloadFactory::receive_load() {
     m_variables["tied_to_file"] = (int64_t) false;
     receive_loaded();
 
+  } else if (m_session) {
+    m_object = new torrent::Object;
+
+    if (!session_file_read(torrent::utils::path_expand(m_uri), m_object))
+      return receive_failed("Reading session torrent failed");
+
+    m_isFile = true;
+
+    receive_loaded();
+
   } else {
-    std::fstream stream(torrent::utils::path_expand(m_uri).c_str(),
-                        std::ios::in | std::ios::binary);
+    // Not mapped, as files outside the session directory may be
+    // truncated while being read.
+    std::string data;
 
-    if (!stream.is_open())
+    if (!session_file_read_data(torrent::utils::path_expand(m_uri), &data))
       return receive_failed("Could not open file");
 
     m_object = new torrent::Object;
-    stream >> *m_object;
 
-    if (!stream.good())
+    if (!bencode_parse(data.data(), data.size(), m_object))
       return receive_failed("Reading torrent file failed");
 
     m_isFile = true;
@@ -191,6 +216,10 @@ void
 DownloadFactory::receive_success() {
   Download* download;
 
+  if (m_stream == nullptr && m_object == nullptr)
+    return receive_failed(
+      "Could not create download, the input is not a valid torrent.");
+
   try {
     download = m_stream != nullptr
                  ? m_manager->download_list()->create(m_stream)
@@ -203,6 +232,8 @@ DownloadFactory::receive_success() {
 
   m_object = nullptr;
 
+  download->set_handed_over(m_handedOver);
+
   torrent::Object* root = download->bencode();
 
   if (download->download()->info()->is_meta_download()) {
@@ -220,7 +251,7 @@ DownloadFactory::receive_success() {
       commands.push_back(*itr);
   }
 
-  if (m_session) {
+  if (m_session && m_isFile && !m_isDecoded) {
     download_factory_add_stream(
       root,
       "rtorrent",
@@ -230,7 +261,7 @@ DownloadFactory::receive_success() {
       "libtorrent_resume",
       (torrent::utils::path_expand(m_uri) + ".libtorrent_resume").c_str());
 
-  } else {
+  } else if (!m_session) {
     // We only allow session torrents to keep their
     // 'rtorrent/libtorrent' sections. The "fast_resume" section
     // should be safe to keep.
@@ -361,6 +392,11 @@ DownloadFactory::receive_success() {
         "d.state.set", (int64_t)m_start, rpc::make_target(download));
     }
 
+    // Session downloads start out matching what was saved, until
+    // they or the event handlers below change them.
+    if (m_session)
+      download->set_session_dirty(false);
+
     rpc::commands.call_catch(m_session ? "event.download.inserted_session"
                                        : "event.download.inserted_new",
                              rpc::make_target(download),
@@ -4,6 +4,7 @@
 #include "buildinfo.h"
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <torrent/data/file.h>
@@ -26,16 +27,24 @@
 #include "globals.h"
 
 #include "core/dht_manager.h"
+#include "core/dormant_list.h"
 #include "core/download.h"
 #include "core/download_list.h"
 #include "core/download_store.h"
 #include "ui/root.h"
+#include "utils/usdt.h"
 
 #define DL_TRIGGER_EVENT(download, event_name)                                 \
-  rpc::commands.call_catch(event_name,                                         \
-                           rpc::make_target(download),                         \
-                           torrent::Object(),                                  \
-                           "Event '" event_name "' failed: ");
+  do {                                                                         \
+    invalidate_columns();                                                      \
+    (download)->set_session_dirty();                                           \
+                                                                               \
+    if (!defer_event(download, event_name))                                    \
+      rpc::commands.call_catch(event_name,                                     \
+                               rpc::make_target(download),                     \
+                               torrent::Object(),                              \
+                               "Event '" event_name "' failed: ");             \
+  } while (false)
 
 namespace core {
 
@@ -56,26 +65,47 @@ DownloadList::clear() {
     close(download);
   }
 
+  m_pendingEvents.clear();
+  m_flushingEvents.clear();
+
   for (const auto& download : *this) {
     delete download;
   }
 
   base_type::clear();
+  invalidate_columns();
+
+  m_names.clear();
 }
 
 void
 DownloadList::session_save() {
-  unsigned int c = std::count_if(begin(), end(), [](Download* download) {
-    return control->core()->download_store()->save_resume(download);
-  });
+  DownloadStore* store  = control->core()->download_store();
+  bool           failed = false;
+
+  store->begin_batch();
+
+  // Downloads that have not changed since they were last saved are
+  // skipped.
+  for (const auto& download : *this) {
+    if (download->is_session_dirty() && !store->save_resume(download))
+      failed = true;
+  }
 
-  if (c != size())
+  if (!store->end_batch() || failed)
     lt_log_print(torrent::LOG_ERROR, "Failed to save session torrents.");
 
   control->dht_manager()->save_dht_cache();
   control->ui()->save_input_history();
 }
 
+void
+DownloadList::set_session_dirty() {
+  for (const auto& download : *this) {
+    download->set_session_dirty();
+  }
+}
+
 DownloadList::iterator
 DownloadList::find(const torrent::HashString& hash) {
   return std::find_if(begin(), end(), [hash](Download* download) {
@@ -105,6 +135,22 @@ DownloadList::find_hex_ptr(const char* hash) {
   return itr != end() ? *itr : nullptr;
 }
 
+// Dormant torrents are not known to libtorrent, so catch duplicates of
+// them here as libtorrent does for other downloads.
+static void
+reject_dormant(torrent::Download download) {
+  const torrent::HashString& hash = download.info()->hash();
+
+  if (!control->core()->dormant_list()->has(
+        std::string(hash.begin(), hash.end())))
+    return;
+
+  torrent::download_remove(download);
+
+  throw torrent::input_error(
+    "Could not create download: Info hash already used by a dormant torrent.");
+}
+
 Download*
 DownloadList::create(torrent::Object* obj) {
   torrent::Download download;
@@ -121,6 +167,8 @@ DownloadList::create(torrent::Object* obj) {
     return nullptr;
   }
 
+  reject_dormant(download);
+
   // There's no non-critical exceptions that should be throwable by
   // the ctor, so don't catch.
   return new Download(download);
@@ -152,6 +200,8 @@ DownloadList::create(std::istream* str) {
     return nullptr;
   }
 
+  reject_dormant(download);
+
   // There's no non-critical exceptions that should be throwable by
   // the ctor, so don't catch.
   return new Download(download);
@@ -161,6 +211,11 @@ DownloadList::iterator
 DownloadList::insert(Download* download) {
   iterator itr = base_type::insert(end(), download);
 
+  invalidate_columns();
+
+  if (m_indexNames)
+    m_names[download] = lowercase_name(download);
+
   lt_log_print_info(torrent::LOG_TORRENT_INFO,
                     download->info(),
                     "download_list",
@@ -228,14 +283,23 @@ DownloadList::erase(iterator itr) {
 
   control->core()->download_store()->remove(*itr);
 
+  // Let the handlers of 'closed' and the like see the download first.
+  flush_events(*itr);
+
   DL_TRIGGER_EVENT(*itr, "event.download.erased");
   for (const auto& v : *control->view_manager()) {
     v->erase(*itr);
   }
 
+  drop_events(*itr);
+
+  m_names.erase(*itr);
+
   torrent::download_remove(*(*itr)->download());
   delete *itr;
 
+  invalidate_columns();
+
   return base_type::erase(itr);
 }
 
@@ -371,10 +435,25 @@ DownloadList::close_throw(Download* download) {
   DL_TRIGGER_EVENT(download, "event.download.closed");
 }
 
+int
+DownloadList::start_flags(int resume_flags, bool handed_over) {
+  if (!handed_over)
+    return resume_flags;
+
+  return resume_flags | torrent::Download::start_no_create |
+         torrent::Download::start_skip_tracker |
+         torrent::Download::start_keep_baseline;
+}
+
 void
 DownloadList::resume(Download* download, int flags) {
   check_contains(download);
 
+  RT_PROBE3(download_resume,
+            download->info()->hash().begin(),
+            download->info()->name().c_str(),
+            flags);
+
   lt_log_print_info(torrent::LOG_TORRENT_INFO,
                     download->info(),
                     "download_list",
@@ -507,9 +586,11 @@ DownloadList::resume(Download* download, int flags) {
     // Update the priority to ensure it has the correct
     // seeding/unfinished modifiers.
     download->set_priority(download->priority());
-    download->download()->start(download->resume_flags());
+    download->download()->start(
+      start_flags(download->resume_flags(), download->is_handed_over()));
 
     download->set_resume_flags(~uint32_t());
+    download->set_handed_over(false);
 
     DL_TRIGGER_EVENT(download, "event.download.resumed");
 
@@ -523,6 +604,11 @@ void
 DownloadList::pause(Download* download, int flags) {
   check_contains(download);
 
+  RT_PROBE3(download_pause,
+            download->info()->hash().begin(),
+            download->info()->name().c_str(),
+            flags);
+
   lt_log_print_info(torrent::LOG_TORRENT_INFO,
                     download->info(),
                     "download_list",
@@ -532,6 +618,7 @@ DownloadList::pause(Download* download, int flags) {
   try {
 
     download->set_resume_flags(~uint32_t());
+    download->set_handed_over(false);
 
     rpc::parse_command_single(rpc::make_target(download),
                               "view.set_not_visible=active");
@@ -619,6 +706,11 @@ void
 DownloadList::hash_done(Download* download) {
   check_contains(download);
 
+  RT_PROBE3(download_hash_done,
+            download->info()->hash().begin(),
+            download->info()->name().c_str(),
+            (int)download->is_hash_checked());
+
   lt_log_print_info(
     torrent::LOG_TORRENT_INFO, download->info(), "download_list", "Hash done.");
 
@@ -937,4 +1029,155 @@ DownloadList::process_meta_download(Download* download) {
   control->core()->try_create_download_from_meta_download(bencode, metafile);
 }
 
+DownloadColumns*
+DownloadList::columns() {
+  if (m_columnsValid && m_columnsTick == control->tick())
+    return &m_columns;
+
+  m_columns.clear();
+  m_columns.reserve(size());
+
+  for (const auto& download : *this) {
+    m_columns.push_back(download);
+  }
+
+  m_columnsValid = true;
+  m_columnsTick  = control->tick();
+
+  return &m_columns;
+}
+
+void
+DownloadList::set_defer_events(bool state) {
+  m_deferEvents = state;
+
+  if (!m_deferEvents)
+    flush_events();
+}
+
+// Inserted and erased events are always called directly, as the
+// callers rely on the handlers having run before the download is
+// used or deleted.
+bool
+DownloadList::defer_event(Download* download, const char* event_name) {
+  if (!m_deferEvents ||
+      std::strcmp(event_name, "event.download.inserted") == 0 ||
+      std::strcmp(event_name, "event.download.erased") == 0)
+    return false;
+
+  m_eventsDeferred++;
+
+  if (!m_pendingEvents.push(download, event_name))
+    m_eventsCoalesced++;
+
+  return true;
+}
+
+void
+DownloadList::call_event(const EventQueue::event_type& event) {
+  rpc::commands.call_catch(
+    event.second.data(),
+    rpc::make_target(event.first),
+    torrent::Object(),
+    ("Event '" + std::string(event.second) + "' failed: ").c_str());
+}
+
+// Dispatches the events of the download not yet run by the current
+// flush, then those still pending, until its handlers trigger no more.
+void
+DownloadList::flush_events(Download* download) {
+  while (true) {
+    EventQueue::queue_type events;
+
+    for (auto& event : m_flushingEvents) {
+      if (event.first != download)
+        continue;
+
+      events.push_back(event);
+      event = EventQueue::event_type(nullptr, std::string_view());
+    }
+
+    for (const auto& event : m_pendingEvents.take(download))
+      events.push_back(event);
+
+    if (events.empty())
+      return;
+
+    for (const auto& event : events)
+      call_event(event);
+  }
+}
+
+void
+DownloadList::drop_events(Download* download) {
+  m_pendingEvents.erase(download);
+
+  // The download might be erased by a handler while flushing, so
+  // clear the remaining entries rather than invalidating iterators.
+  std::replace_if(
+    m_flushingEvents.begin(),
+    m_flushingEvents.end(),
+    [download](const auto& event) { return event.first == download; },
+    EventQueue::event_type(nullptr, std::string_view()));
+}
+
+void
+DownloadList::flush_events() {
+  if (!m_flushingEvents.empty())
+    return;
+
+  while (!m_pendingEvents.empty()) {
+    m_flushingEvents = m_pendingEvents.take();
+
+    control->view_manager()->set_defer_filter(true);
+
+    // Entries are cleared as they run, so that flush_events(download)
+    // only picks up those that have not.
+    for (size_t i = 0; i < m_flushingEvents.size(); i++) {
+      const auto event = m_flushingEvents[i];
+
+      if (event.first == nullptr)
+        continue;
+
+      m_flushingEvents[i] = EventQueue::event_type(nullptr, std::string_view());
+      call_event(event);
+    }
+
+    m_flushingEvents.clear();
+
+    control->view_manager()->set_defer_filter(false);
+    control->view_manager()->flush_filter();
+  }
+}
+
+std::string
+DownloadList::lowercase_name(Download* download) {
+  std::string name = download->info()->name();
+
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+  return name;
+}
+
+void
+DownloadList::set_index_names(bool state) {
+  m_indexNames = state;
+  m_names.clear();
+
+  if (!m_indexNames)
+    return;
+
+  m_names.reserve(size());
+
+  for (const auto& download : *this) {
+    m_names[download] = lowercase_name(download);
+  }
+}
+
+const std::string*
+DownloadList::find_name(Download* download) const {
+  auto itr = m_names.find(download);
+
+  return itr != m_names.end() ? &itr->second : nullptr;
+}
+
 }
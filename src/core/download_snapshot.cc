@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <algorithm>
+#include <cctype>
+#include <torrent/download_info.h>
+#include <torrent/utils/string_manip.h>
+#include <torrent/utils/timer.h>
+
+#include "core/download.h"
+#include "core/download_list.h"
+#include "core/download_snapshot.h"
+#include "core/view.h"
+#include "core/view_manager.h"
+
+namespace core {
+
+std::shared_ptr<const DownloadSnapshot>
+DownloadSnapshot::create(DownloadList* list,
+                         ViewManager*  views,
+                         uint64_t      tick) {
+  std::shared_ptr<DownloadSnapshot> snapshot(new DownloadSnapshot);
+  DownloadColumns*                  columns = list->columns();
+
+  snapshot->m_tick = tick;
+  snapshot->m_time = torrent::utils::timer::current().usec();
+  snapshot->m_entries.resize(columns->size());
+  snapshot->m_hashes.reserve(columns->size());
+
+  for (size_t row = 0; row < columns->size(); row++) {
+    Download*   download = columns->download(row);
+    entry_type& entry    = snapshot->m_entries[row];
+
+    entry.hash = torrent::utils::transform_hex_str(download->info()->hash());
+    entry.name = download->info()->name();
+
+    for (int i = 0; i < DownloadColumns::COLUMN_MAX_SIZE; i++)
+      entry.values[i] = columns->column(i)[row];
+
+    snapshot->m_hashes.emplace(entry.hash, row);
+  }
+
+  for (const auto& view : *views) {
+    view_type& rows = snapshot->m_views[view->name()];
+
+    rows.reserve(view->size_visible());
+
+    for (auto itr = view->begin_visible(); itr != view->end_visible(); ++itr) {
+      size_t row = columns->find(*itr);
+
+      if (row != columns->size())
+        rows.push_back(row);
+    }
+  }
+
+  return snapshot;
+}
+
+int
+DownloadSnapshot::field_index(const std::string& command) {
+  int column = DownloadColumns::column_index(command);
+
+  if (column != -1)
+    return column;
+
+  if (command == "d.hash" || command == "d.hash=")
+    return FIELD_HASH;
+
+  if (command == "d.name" || command == "d.name=")
+    return FIELD_NAME;
+
+  return -1;
+}
+
+const DownloadSnapshot::entry_type*
+DownloadSnapshot::find(const std::string& hash) const {
+  std::string key(hash);
+
+  std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) {
+    return std::toupper(c);
+  });
+
+  auto itr = m_hashes.find(key);
+
+  return itr != m_hashes.end() ? &m_entries[itr->second] : nullptr;
+}
+
+const DownloadSnapshot::view_type*
+DownloadSnapshot::find_view(const std::string& name) const {
+  auto itr = m_views.find(name);
+
+  return itr != m_views.end() ? &itr->second : nullptr;
+}
+
+torrent::Object
+DownloadSnapshot::get(const entry_type& entry, int field) {
+  switch (field) {
+    case FIELD_HASH:
+      return entry.hash;
+    case FIELD_NAME:
+      return entry.name;
+    default:
+      return entry.values[field];
+  }
+}
+
+}
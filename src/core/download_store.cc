@@ -4,8 +4,9 @@
 // DownloadStore handles the saving and listing of session torrents.
 
 #include <cstdio>
+#include <cstring>
 #include <fcntl.h>
-#include <fstream>
+#include <sstream>
 #include <unistd.h>
 
 #include <torrent/exceptions.h>
@@ -14,17 +15,29 @@
 #include <torrent/rate.h>
 #include <torrent/torrent.h>
 #include <torrent/utils/error_number.h>
+#include <torrent/utils/log.h>
 #include <torrent/utils/path.h>
 #include <torrent/utils/resume.h>
 #include <torrent/utils/string_manip.h>
 
 #include "utils/directory.h"
 
+#include "control.h"
 #include "core/download.h"
+#include "core/download_list.h"
 #include "core/download_store.h"
+#include "core/manager.h"
+#include "core/session_file.h"
+#include "utils/usdt.h"
 
 namespace core {
 
+static SessionPack::hash_type
+hash_key(Download* d) {
+  return SessionPack::hash_type(d->info()->hash().begin(),
+                                d->info()->hash().end());
+}
+
 void
 DownloadStore::enable(bool lock) {
   if (is_enabled())
@@ -57,6 +70,20 @@ DownloadStore::enable(bool lock) {
       throw torrent::input_error(msg);
     }
   }
+
+  if (!is_packed()) {
+    if (m_async)
+      m_writer.start();
+
+    return;
+  }
+
+  try {
+    m_pack.open(m_path + "rtorrent.pack");
+  } catch (const torrent::storage_error& e) {
+    m_lockfile.unlock();
+    throw torrent::input_error(e.what());
+  }
 }
 
 void
@@ -64,6 +91,14 @@ DownloadStore::disable() {
   if (!is_enabled())
     return;
 
+  if (m_pack.is_open()) {
+    flush_packed();
+    m_pack.close();
+  }
+
+  m_writer.stop();
+  collect_writes();
+
   m_lockfile.unlock();
 }
 
@@ -79,46 +114,166 @@ DownloadStore::set_path(const std::string& path) {
     m_path = torrent::utils::path_expand(path);
 }
 
+const char*
+DownloadStore::format_name() const {
+  return m_format == FORMAT_PACKED ? "packed" : "files";
+}
+
+void
+DownloadStore::set_format(const std::string& name) {
+  if (is_enabled())
+    throw torrent::input_error(
+      "Tried to change session format while it is enabled.");
+
+  if (name == "files")
+    m_format = FORMAT_FILES;
+  else if (name == "packed")
+    m_format = FORMAT_PACKED;
+  else
+    throw torrent::input_error("Invalid session format: \"" + name + "\".");
+}
+
+void
+DownloadStore::set_async(bool state) {
+  m_async = state;
+
+  if (!is_enabled() || is_packed())
+    return;
+
+  if (m_async) {
+    m_writer.start();
+  } else {
+    m_writer.stop();
+    collect_writes();
+  }
+}
+
+void
+DownloadStore::collect_writes() {
+  SessionWriter::result_list results;
+
+  m_writer.collect(&results);
+
+  for (const auto& result : results) {
+    if (result.success)
+      continue;
+
+    lt_log_print(torrent::LOG_ERROR,
+                 "Failed to save session torrent %s.",
+                 torrent::utils::transform_hex_str(result.hash).c_str());
+
+    DownloadList* list = control->core()->download_list();
+    auto itr = list->find(*torrent::HashString::cast_from(result.hash));
+
+    if (itr != list->end())
+      (*itr)->set_session_dirty();
+  }
+}
+
 bool
-DownloadStore::write_bencode(const std::string&     filename,
-                             const torrent::Object& obj,
-                             uint32_t               skip_mask) {
-  torrent::Object tmp;
-  std::fstream    output(filename.c_str(), std::ios::out | std::ios::trunc);
-  int fd = -1;
+DownloadStore::end_batch() {
+  if (m_batch == 0)
+    throw torrent::internal_error(
+      "DownloadStore::end_batch() called without begin_batch().");
 
-  if (!output.is_open())
-    goto download_store_save_error;
+  if (--m_batch != 0)
+    return true;
 
-  torrent::object_write_bencode(&output, &obj, skip_mask);
+  if (!m_renames.empty())
+    return flush_renames();
 
-  if (!output.good())
-    goto download_store_save_error;
+  return !m_pack.is_open() || flush_packed();
+}
 
-  output.close();
+bool
+DownloadStore::read_packed(const SessionPack::hash_type& hash,
+                           SessionLoader::part_list*     parts) const {
+  const std::pair<SessionPack::part_type, const char*> part_keys[] = {
+    { SessionPack::PART_TORRENT, "" },
+    { SessionPack::PART_RESUME, "libtorrent_resume" },
+    { SessionPack::PART_RTORRENT, "rtorrent" }
+  };
+
+  std::string name = torrent::utils::transform_hex_str(hash);
+
+  for (const auto& part : part_keys) {
+    std::string data;
+
+    if (!m_pack.get(hash, part.first, &data)) {
+      if (part.first == SessionPack::PART_TORRENT)
+        return false;
 
-  // Test the new file, to ensure it is a valid bencode string.
-  output.open(filename.c_str(), std::ios::in);
-  output >> tmp;
+      continue;
+    }
+
+    parts->push_back(
+      SessionLoader::part_type{ part.second, name, std::move(data) });
+  }
+
+  return true;
+}
+
+bool
+DownloadStore::read_files(const std::string&        filename,
+                          SessionLoader::part_list* parts) {
+  const char* const part_keys[] = { "", "rtorrent", "libtorrent_resume" };
+
+  for (const char* key : part_keys) {
+    std::string part_filename =
+      *key == '\0' ? filename : filename + '.' + key;
+    utils::MappedFile mapping;
+
+    if (!mapping.open(part_filename)) {
+      if (*key == '\0')
+        return false;
+
+      continue;
+    }
+
+    parts->push_back(SessionLoader::part_type{
+      key, part_filename, std::string(), std::move(mapping) });
+  }
+
+  return true;
+}
 
-  if (!output.good())
-    goto download_store_save_error;
+void
+DownloadStore::put_packed(Download*              d,
+                          SessionPack::part_type part,
+                          const torrent::Object& obj,
+                          uint32_t               skip_mask) {
+  m_pack.put(hash_key(d), part, bencode_string(obj, skip_mask));
+}
 
-  output.close();
+bool
+DownloadStore::flush_packed() {
+  if (!m_pack.flush()) {
+    lt_log_print(torrent::LOG_ERROR,
+                 "Could not write session pack \"%s\".",
+                 m_pack.path().c_str());
+
+    // The failed batch may have held any of them.
+    for (const auto& download : *control->core()->download_list()) {
+      download->set_session_dirty();
+    }
 
-  // Ensure that the new file is actually written to the disk
-  fd = ::open(filename.c_str(), O_WRONLY);
-  if (fd < 0)
-    goto download_store_save_error;
+    return false;
+  }
 
-  fsync(fd);
-  ::close(fd);
+  if (m_pack.should_compact() && !m_pack.compact())
+    lt_log_print(torrent::LOG_WARN,
+                 "Could not compact session pack \"%s\".",
+                 m_pack.path().c_str());
 
   return true;
+}
 
-download_store_save_error:
-  output.close();
-  return false;
+std::string
+DownloadStore::bencode_string(const torrent::Object& obj, uint32_t skip_mask) {
+  std::ostringstream stream;
+
+  torrent::object_write_bencode(&stream, &obj, skip_mask);
+  return stream.str();
 }
 
 bool
@@ -126,6 +281,9 @@ DownloadStore::save(Download* d, int flags) {
   if (!is_enabled())
     return true;
 
+  RT_PROBE2(session_save_start, d->info()->hash().begin(), flags);
+  RT_PROBE_ON_EXIT(RT_PROBE1(session_save_done, d->info()->hash().begin()));
+
   torrent::Object* resume_base =
     &d->download()->bencode()->get_key("libtorrent_resume");
   torrent::Object* rtorrent_base =
@@ -152,71 +310,169 @@ DownloadStore::save(Download* d, int flags) {
   resume_base->set_flags(torrent::Object::flag_session_data);
   rtorrent_base->set_flags(torrent::Object::flag_session_data);
 
+  if (m_pack.is_open()) {
+    put_packed(d, SessionPack::PART_RESUME, *resume_base, 0);
+    put_packed(d, SessionPack::PART_RTORRENT, *rtorrent_base, 0);
+
+    if (!(flags & flag_skip_static))
+      put_packed(d,
+                 SessionPack::PART_TORRENT,
+                 *d->bencode(),
+                 torrent::Object::flag_session_data);
+
+    d->set_session_dirty(false);
+    return m_batch != 0 || flush_packed();
+  }
+
   std::string base_filename = create_filename(d);
 
-  if (!write_bencode(
-        base_filename + ".libtorrent_resume.new", *resume_base, 0) ||
-      !write_bencode(base_filename + ".rtorrent.new", *rtorrent_base, 0))
+  if (m_writer.is_running()) {
+    SessionWriter::job_type job;
+
+    job.hash = hash_key(d);
+    job.files.push_back(
+      SessionWriter::file_type{ base_filename + ".libtorrent_resume",
+                                session_file_string(*resume_base, 0) });
+    job.files.push_back(
+      SessionWriter::file_type{ base_filename + ".rtorrent",
+                                session_file_string(*rtorrent_base, 0) });
+
+    if (!(flags & flag_skip_static))
+      job.files.push_back(SessionWriter::file_type{
+        base_filename,
+        session_file_string(*d->bencode(),
+                            torrent::Object::flag_session_data) });
+
+    m_writer.push(std::move(job));
+
+    d->set_session_dirty(false);
+    return true;
+  }
+
+  if (!write_file(base_filename + ".libtorrent_resume", *resume_base, 0) ||
+      !write_file(base_filename + ".rtorrent", *rtorrent_base, 0))
     return false;
 
-  ::rename((base_filename + ".libtorrent_resume.new").c_str(),
-           (base_filename + ".libtorrent_resume").c_str());
-  ::rename((base_filename + ".rtorrent.new").c_str(),
-           (base_filename + ".rtorrent").c_str());
+  if (!(flags & flag_skip_static))
+    write_file(
+      base_filename, *d->bencode(), torrent::Object::flag_session_data);
 
-  if (!(flags & flag_skip_static) &&
-      write_bencode(base_filename + ".new",
-                    *d->bencode(),
-                    torrent::Object::flag_session_data))
-    ::rename((base_filename + ".new").c_str(), base_filename.c_str());
+  d->set_session_dirty(false);
+  return true;
+}
 
+bool
+DownloadStore::write_file(const std::string&     filename,
+                          const torrent::Object& obj,
+                          uint32_t               skip_mask) {
+  if (!m_syncOnce || m_batch == 0)
+    return session_file_write(filename, obj, skip_mask);
+
+  if (!session_file_write_new(filename, obj, skip_mask, false))
+    return false;
+
+  m_renames.push_back(filename);
   return true;
 }
 
+bool
+DownloadStore::flush_renames() {
+  std::vector<std::string> renames;
+  renames.swap(m_renames);
+
+  int fd = ::open(m_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+#ifdef __linux__
+  bool result = fd != -1 && ::syncfs(fd) == 0;
+#else
+  ::sync();
+  bool result = fd != -1;
+#endif
+
+  for (const auto& filename : renames) {
+    std::string tmp_filename = filename + ".new";
+
+    if (result && ::rename(tmp_filename.c_str(), filename.c_str()) == 0)
+      continue;
+
+    ::unlink(tmp_filename.c_str());
+    result = false;
+  }
+
+  if (fd != -1) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+
+  if (!result) {
+    lt_log_print(torrent::LOG_ERROR,
+                 "Could not sync session directory \"%s\".",
+                 m_path.c_str());
+
+    for (const auto& download : *control->core()->download_list()) {
+      download->set_session_dirty();
+    }
+  }
+
+  return result;
+}
+
 void
 DownloadStore::remove(Download* d) {
   if (!is_enabled())
     return;
 
+  if (m_pack.is_open()) {
+    m_pack.remove(hash_key(d));
+
+    if (m_batch == 0)
+      flush_packed();
+
+    return;
+  }
+
+  if (m_writer.is_running()) {
+    SessionWriter::job_type job;
+
+    job.hash    = hash_key(d);
+    job.unlinks = { create_filename(d) + ".libtorrent_resume",
+                    create_filename(d) + ".rtorrent",
+                    create_filename(d) };
+
+    m_writer.push(std::move(job));
+    return;
+  }
+
   ::unlink((create_filename(d) + ".libtorrent_resume").c_str());
   ::unlink((create_filename(d) + ".rtorrent").c_str());
   ::unlink(create_filename(d).c_str());
 }
 
-// This also needs to check that it isn't a directory.
-bool
-not_correct_format(const utils::directory_entry& entry) {
-  return !DownloadStore::is_correct_format(entry.d_name);
-}
-
-utils::Directory
+utils::DirectoryNames
 DownloadStore::get_formated_entries() {
-  if (!is_enabled())
-    return utils::Directory();
+  utils::DirectoryNames names;
 
-  utils::Directory d(m_path);
+  if (!is_enabled())
+    return names;
 
-  if (!d.update(utils::Directory::update_hide_dot))
+  if (!names.update(m_path,
+                    utils::DirectoryNames::update_hide_dot,
+                    [](const char* name, size_t length) {
+                      return is_correct_format(name, length);
+                    }))
     throw torrent::storage_error(
       "core::DownloadStore::update() could not open directory \"" + m_path +
       "\"");
 
-  d.erase(std::remove_if(d.begin(),
-                         d.end(),
-                         [](const utils::directory_entry& entry) {
-                           return not_correct_format(entry);
-                         }),
-          d.end());
-
-  return d;
+  return names;
 }
 
 bool
-DownloadStore::is_correct_format(const std::string& f) {
-  if (f.size() != 48 || f.substr(40) != ".torrent")
+DownloadStore::is_correct_format(const char* name, size_t length) {
+  if (length != 48 || std::memcmp(name + 40, ".torrent", 8) != 0)
     return false;
 
-  for (std::string::const_iterator itr = f.begin(); itr != f.end() - 8; ++itr)
+  for (const char* itr = name; itr != name + 40; ++itr)
     if (!(*itr >= '0' && *itr <= '9') && !(*itr >= 'A' && *itr <= 'F'))
       return false;
 
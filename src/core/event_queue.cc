@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <algorithm>
+
+#include "core/event_queue.h"
+
+namespace core {
+
+bool
+EventQueue::push(Download* download, std::string_view event_name) {
+  event_type event(download, event_name);
+
+  auto [itr, inserted] = m_index.try_emplace(event, m_events.size());
+
+  if (!inserted) {
+    m_events[itr->second] = event_type(nullptr, std::string_view());
+    itr->second           = m_events.size();
+  }
+
+  m_events.push_back(event);
+
+  // Keep the stale slots from outgrowing the live ones.
+  if (m_events.size() > 2 * m_index.size() + 16)
+    compact();
+
+  return inserted;
+}
+
+EventQueue::queue_type
+EventQueue::take() {
+  queue_type events;
+
+  events.swap(m_events);
+  events.erase(std::remove_if(events.begin(), events.end(), &is_stale),
+               events.end());
+  m_index.clear();
+
+  return events;
+}
+
+EventQueue::queue_type
+EventQueue::take(Download* download) {
+  queue_type events;
+
+  for (auto& event : m_events) {
+    if (event.first != download)
+      continue;
+
+    events.push_back(event);
+    m_index.erase(event);
+    event = event_type(nullptr, std::string_view());
+  }
+
+  return events;
+}
+
+void
+EventQueue::erase(Download* download) {
+  take(download);
+}
+
+void
+EventQueue::clear() {
+  m_events.clear();
+  m_index.clear();
+}
+
+void
+EventQueue::compact() {
+  m_events.erase(std::remove_if(m_events.begin(), m_events.end(), &is_stale),
+                 m_events.end());
+
+  for (size_t i = 0; i < m_events.size(); i++)
+    m_index[m_events[i]] = i;
+}
+
+}
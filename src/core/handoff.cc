@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <torrent/utils/log.h>
+
+#include "core/handoff.h"
+#include "core/session_file.h"
+
+namespace core {
+
+const char* const handoff_env = "RTORRENT_HANDOFF_FD";
+
+namespace {
+
+int
+open_anonymous() {
+#ifdef __linux__
+  int fd = ::memfd_create("rtorrent-handoff", 0);
+
+  if (fd != -1)
+    return fd;
+#endif
+
+  const char* tmpdir = std::getenv("TMPDIR");
+  std::string path   = std::string(tmpdir != nullptr ? tmpdir : "/tmp") +
+                     "/rtorrent-handoff.XXXXXX";
+
+  int fd_tmp = ::mkstemp(&path[0]);
+
+  if (fd_tmp != -1)
+    ::unlink(path.c_str());
+
+  return fd_tmp;
+}
+
+bool
+write_all(int fd, const std::string& data) {
+  const char* first = data.data();
+  const char* last  = data.data() + data.size();
+
+  while (first != last) {
+    ssize_t result = ::write(fd, first, last - first);
+
+    if (result == -1 && errno == EINTR)
+      continue;
+
+    if (result <= 0)
+      return false;
+
+    first += result;
+  }
+
+  return ::lseek(fd, 0, SEEK_SET) == 0;
+}
+
+bool
+read_all(int fd, std::string* data) {
+  struct stat st;
+
+  if (::fstat(fd, &st) == -1)
+    return false;
+
+  data->resize(st.st_size);
+
+  size_t offset = 0;
+
+  while (offset != data->size()) {
+    ssize_t result = ::read(fd, &(*data)[offset], data->size() - offset);
+
+    if (result == -1 && errno == EINTR)
+      continue;
+
+    if (result <= 0)
+      return false;
+
+    offset += result;
+  }
+
+  return true;
+}
+
+void
+set_cloexec(int fd, bool state) {
+  int flags = ::fcntl(fd, F_GETFD);
+
+  if (flags == -1)
+    return;
+
+  ::fcntl(fd, F_SETFD, state ? flags | FD_CLOEXEC : flags & ~FD_CLOEXEC);
+}
+
+// Descriptors opened by libtorrent, such as those of open files, are
+// not all close-on-exec.
+void
+set_cloexec_all() {
+  DIR* dir = ::opendir("/proc/self/fd");
+
+  if (dir == nullptr) {
+    for (int fd = 3, last = ::getdtablesize(); fd < last; fd++) {
+      set_cloexec(fd, true);
+    }
+
+    return;
+  }
+
+  while (dirent* entry = ::readdir(dir)) {
+    int fd = std::atoi(entry->d_name);
+
+    if (fd > 2)
+      set_cloexec(fd, true);
+  }
+
+  ::closedir(dir);
+}
+
+}
+
+handoff_args
+handoff_arguments(int argc, char** argv) {
+  handoff_args args(argv, argv + argc);
+
+  if (args.empty() || args.front().empty() || args.front()[0] == '/' ||
+      args.front().find('/') == std::string::npos)
+    return args;
+
+  char cwd[PATH_MAX];
+
+  if (::getcwd(cwd, sizeof(cwd)) != nullptr)
+    args.front() = std::string(cwd) + '/' + args.front();
+
+  return args;
+}
+
+bool
+handoff_exec(const handoff_args&    args,
+             const torrent::Object& state,
+             const handoff_fds&     keep) {
+  if (args.empty())
+    return false;
+
+  int fd = open_anonymous();
+
+  if (fd == -1 || !write_all(fd, session_file_string(state, 0))) {
+    lt_log_print(torrent::LOG_ERROR, "Could not write the restart state.");
+
+    if (fd != -1)
+      ::close(fd);
+
+    return false;
+  }
+
+  set_cloexec_all();
+  set_cloexec(fd, false);
+
+  for (int keep_fd : keep) {
+    set_cloexec(keep_fd, false);
+  }
+
+  std::vector<char*> argv;
+
+  for (const auto& arg : args) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+
+  argv.push_back(nullptr);
+
+  ::setenv(handoff_env, std::to_string(fd).c_str(), 1);
+  ::execvp(argv.front(), argv.data());
+
+  int error = errno;
+
+  ::unsetenv(handoff_env);
+  ::close(fd);
+
+  lt_log_print(torrent::LOG_ERROR,
+               "Could not restart \"%s\": %s",
+               argv.front(),
+               std::strerror(error));
+  return false;
+}
+
+bool
+handoff_read(torrent::Object* state) {
+  const char* value = std::getenv(handoff_env);
+
+  if (value == nullptr)
+    return false;
+
+  int fd = std::atoi(value);
+
+  ::unsetenv(handoff_env);
+
+  if (fd <= 2)
+    return false;
+
+  std::string data;
+  bool        result = read_all(fd, &data) &&
+                session_file_parse("restart state", data, state) &&
+                state->is_map();
+
+  ::close(fd);
+
+  if (!result) {
+    lt_log_print(torrent::LOG_ERROR, "Could not read the restart state.");
+    *state = torrent::Object();
+  }
+
+  return result;
+}
+
+}
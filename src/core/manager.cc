@@ -4,16 +4,20 @@
 #include <cstdio>
 #include <cstring>
 #include <filesystem>
+#include <fnmatch.h>
 #include <fstream>
 #include <glob.h>
 #include <sstream>
 #include <sys/select.h>
 
+#include <torrent/chunk_manager.h>
 #include <torrent/connection_manager.h>
+#include <torrent/data/file_manager.h>
 #include <torrent/error.h>
 #include <torrent/exceptions.h>
 #include <torrent/object.h>
 #include <torrent/object_stream.h>
+#include <torrent/rate.h>
 #include <torrent/throttle.h>
 #include <torrent/tracker_list.h>
 #include <torrent/utils/address_info.h>
@@ -27,16 +31,20 @@
 #include "rpc/parse_commands.h"
 #include "utils/directory.h"
 #include "utils/file_status_cache.h"
+#include "utils/stats_segment.h"
 
 #include "control.h"
 #include "core/curl_get.h"
+#include "core/dormant_list.h"
 #include "core/download.h"
 #include "core/download_factory.h"
+#include "core/download_snapshot.h"
 #include "core/download_store.h"
 #include "core/http_queue.h"
 #include "core/manager.h"
 #include "core/poll_manager.h"
 #include "core/view.h"
+#include "core/view_manager.h"
 #include "globals.h"
 
 namespace core {
@@ -106,7 +114,9 @@ Manager::Manager()
   , m_log_complete(torrent::log_open_log_buffer("complete")) {
   m_downloadStore   = new DownloadStore();
   m_downloadList    = new DownloadList();
+  m_dormantList     = new DormantList();
   m_fileStatusCache = new FileStatusCache();
+  m_statsSegment    = new StatsSegment();
   m_httpQueue       = new HttpQueue();
   m_httpStack       = new CurlStack();
 
@@ -122,8 +132,10 @@ Manager::~Manager() {
   // TODO: Clean up logs objects.
 
   delete m_downloadStore;
+  delete m_dormantList;
   delete m_httpQueue;
   delete m_fileStatusCache;
+  delete m_statsSegment;
 }
 
 void
@@ -137,6 +149,105 @@ Manager::set_hashing_view(View* v) {
     [this] { receive_hashing_changed(); });
 }
 
+void
+Manager::publish_snapshot() {
+  int64_t interval = rpc::call_command_value("system.snapshot.interval");
+
+  if (interval <= 0) {
+    if (m_snapshotTime != 0) {
+      std::atomic_store(&m_snapshot, std::shared_ptr<const DownloadSnapshot>());
+      m_snapshotTime = 0;
+    }
+
+    return;
+  }
+
+  if (m_snapshotTime + interval * 1000 > cachedTime.usec())
+    return;
+
+  std::atomic_store(
+    &m_snapshot,
+    DownloadSnapshot::create(
+      m_downloadList, control->view_manager(), control->tick()));
+
+  m_snapshotTime = cachedTime.usec();
+}
+
+void
+Manager::publish_stats() {
+  if (!m_statsSegment->is_open())
+    return;
+
+  int64_t interval = rpc::call_command_value("system.stats_segment.interval");
+
+  if (m_statsTime + interval * 1000 > cachedTime.usec())
+    return;
+
+  m_statsTime = cachedTime.usec();
+
+  torrent::ChunkManager* chunkManager = torrent::chunk_manager();
+  torrent::FileManager*  fileManager  = torrent::file_manager();
+
+  StatsSegment::global_type global{};
+
+  global.up_rate         = torrent::up_rate()->rate();
+  global.up_total        = torrent::up_rate()->total();
+  global.up_max_rate     = torrent::up_throttle_global()->max_rate();
+  global.down_rate       = torrent::down_rate()->rate();
+  global.down_total      = torrent::down_rate()->total();
+  global.down_max_rate   = torrent::down_throttle_global()->max_rate();
+  global.sockets_open    = torrent::connection_manager()->size();
+  global.sockets_max     = torrent::connection_manager()->max_size();
+  global.files_open      = fileManager->open_files();
+  global.files_max       = fileManager->max_open_files();
+  global.memory_usage    = chunkManager->memory_usage();
+  global.memory_max      = chunkManager->max_memory_usage();
+  global.hash_queue_size = torrent::hash_queue_size();
+
+  std::vector<StatsSegment::download_type> downloads(m_downloadList->size());
+
+  auto entry = downloads.begin();
+
+  for (Download* download : *m_downloadList) {
+    const torrent::DownloadInfo* info     = download->info();
+    torrent::FileList*           fileList = download->file_list();
+
+    std::string hash = torrent::utils::transform_hex_str(info->hash());
+
+    std::memcpy(entry->hash, hash.data(), StatsSegment::hash_size);
+    StatsSegment::set_name(&*entry, info->name());
+
+    entry->flags = (info->is_open() ? StatsSegment::flag_open : 0) |
+                   (info->is_active() ? StatsSegment::flag_active : 0) |
+                   (download->is_done() ? StatsSegment::flag_complete : 0) |
+                   (download->is_hash_checking() ? StatsSegment::flag_hashing
+                                                 : 0);
+    entry->peers = download->connection_list_size();
+
+    entry->priority   = download->priority();
+    entry->up_rate    = info->up_rate()->rate();
+    entry->up_total   = info->up_rate()->total();
+    entry->down_rate  = info->down_rate()->rate();
+    entry->down_total = info->down_rate()->total();
+    entry->bytes_done = download->download()->bytes_done();
+    entry->left_bytes = fileList->left_bytes();
+    entry->size_bytes = fileList->size_bytes();
+
+    if (download->is_hash_checking() || entry->bytes_done <= 0)
+      entry->ratio = 0;
+    else
+      entry->ratio = (1000 * entry->up_total) / entry->bytes_done;
+
+    ++entry;
+  }
+
+  if (!m_statsSegment->publish(control->tick(), global, downloads))
+    lt_log_print(torrent::LOG_WARN,
+                 "Could not publish to stats segment '%s': %s",
+                 m_statsSegment->path().c_str(),
+                 std::strerror(errno));
+}
+
 torrent::ThrottlePair
 Manager::get_throttle(const std::string& name) {
   ThrottleMap::const_iterator itr = m_throttles.find(name);
@@ -263,6 +374,18 @@ Manager::listen_open() {
   if (portFirst > portLast || portLast >= (1 << 16))
     throw torrent::input_error("Invalid port range.");
 
+  // Keep the port used before 'system.restart', which peers and
+  // trackers already know.
+  const torrent::Object& handoff = control->handoff();
+
+  if (handoff.is_map() && handoff.has_key_value("listen_port")) {
+    int port = handoff.get_key_value("listen_port");
+
+    if (port >= portFirst && port <= portLast &&
+        torrent::connection_manager()->listen_open(port, port))
+      return;
+  }
+
   if (rpc::call_command_value("network.port_random")) {
     int boundary = portFirst + random() % (portLast - portFirst + 1);
 
@@ -457,6 +580,68 @@ Manager::try_create_download(const std::string&       uri,
   return result;
 }
 
+std::vector<int>
+Manager::batch_flags(const torrent::Object::list_type& payloads, int flags) {
+  std::vector<int> result;
+  result.reserve(payloads.size());
+
+  for (const auto& payload : payloads) {
+    if (!payload.is_string())
+      throw torrent::input_error("Batch payloads must be strings.");
+
+    result.push_back(is_data_uri(payload.as_string())
+                       ? flags & ~create_raw_data
+                       : flags | create_raw_data);
+  }
+
+  return result;
+}
+
+torrent::Object
+Manager::try_create_download_batch(const torrent::Object::list_type& payloads,
+                                   int                               flags) {
+  // Check every payload first, so that a bad one doesn't leave the
+  // batch half created.
+  std::vector<int> payloadFlags = batch_flags(payloads, flags);
+
+  torrent::Object             rawResult = torrent::Object::create_list();
+  torrent::Object::list_type& result    = rawResult.as_list();
+
+  // Filter each view once for the whole batch rather than once per
+  // download inserted.
+  bool deferring = control->view_manager()->is_deferring_filter();
+
+  auto finish = [this, deferring]() {
+    m_downloadStore->end_batch();
+    control->view_manager()->set_defer_filter(deferring);
+
+    if (!deferring)
+      control->view_manager()->flush_filter();
+  };
+
+  m_downloadStore->begin_batch();
+  control->view_manager()->set_defer_filter(true);
+
+  try {
+    for (size_t i = 0; i < payloads.size(); i++) {
+      try {
+        result.push_back(try_create_download(payloads[i].as_string(),
+                                             payloadFlags[i] | create_throw,
+                                             command_list_type()));
+      } catch (const torrent::input_error&) {
+        // Already logged by the factory unless quiet.
+        result.push_back(std::string());
+      }
+    }
+  } catch (...) {
+    finish();
+    throw;
+  }
+
+  finish();
+  return rawResult;
+}
+
 void
 Manager::try_create_download_from_meta_download(torrent::Object*   bencode,
                                                 const std::string& metafile) {
@@ -490,9 +675,51 @@ path_expand_transform(std::string path, const utils::directory_entry& entry) {
   return path + entry.d_name;
 }
 
+// Watch directory patterns are usually a plain directory followed by
+// a wildcard file name. These are matched while listing the directory,
+// instead of through glob(), which is slow on large directories.
+bool
+path_expand_names(std::vector<std::string>* paths, const std::string& pattern) {
+  size_t split = pattern.rfind('/');
+
+  if (split == std::string::npos ||
+      pattern.find_first_of("*?[\\") < split + 1 ||
+      pattern.find_first_of("*?[", split + 1) == std::string::npos ||
+      pattern.find('\\', split + 1) != std::string::npos)
+    return false;
+
+  std::string directory =
+    torrent::utils::path_expand(pattern.substr(0, split + 1));
+  std::string name = pattern.substr(split + 1);
+
+  utils::DirectoryNames names;
+
+  // As with glob(), a missing directory matches nothing.
+  names.update(directory,
+               utils::DirectoryNames::update_sort,
+               [&name](const char* entry, size_t) {
+                 return fnmatch(name.c_str(), entry, FNM_PERIOD) == 0;
+               });
+
+  for (size_t index = 0; index < names.size(); index++) {
+    std::error_code error;
+    std::string     resolved_path =
+      std::filesystem::absolute(directory + names.name(index), error)
+        .lexically_normal();
+
+    if (!error)
+      paths->push_back(resolved_path);
+  }
+
+  return true;
+}
+
 // Move this somewhere better.
 void
 path_expand(std::vector<std::string>* paths, const std::string& pattern) {
+  if (path_expand_names(paths, pattern))
+    return;
+
   glob_t glob_result;
 
   glob(pattern.c_str(), GLOB_TILDE, nullptr, &glob_result);
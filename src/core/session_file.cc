@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <streambuf>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <torrent/exceptions.h>
+#include <torrent/object_stream.h>
+#include <torrent/utils/log.h>
+
+#include "core/session_file.h"
+#include "utils/mapped_file.h"
+
+namespace core {
+
+namespace {
+
+// Key used by versions that stored the checksum inside the dictionary.
+const char legacy_checksum_key[] = "~checksum";
+
+// The trailer is "~crc32:", eight lower case hex digits and a newline.
+const char   trailer_prefix[]    = "~crc32:";
+const size_t trailer_prefix_size = sizeof(trailer_prefix) - 1;
+const size_t trailer_size        = trailer_prefix_size + 9;
+
+const size_t write_buffer_size = 64 << 10;
+
+std::string
+checksum_trailer(uint32_t crc) {
+  char buffer[trailer_size + 1];
+
+  std::snprintf(buffer, sizeof(buffer), "%s%08x\n", trailer_prefix, crc);
+  return std::string(buffer, trailer_size);
+}
+
+// Returns true and sets 'crc' if 'data' ends with a checksum trailer.
+bool
+parse_trailer(const char* data, size_t length, uint32_t* crc) {
+  if (length < trailer_size)
+    return false;
+
+  const char* trailer = data + length - trailer_size;
+
+  if (std::memcmp(trailer, trailer_prefix, trailer_prefix_size) != 0 ||
+      trailer[trailer_size - 1] != '\n')
+    return false;
+
+  *crc = 0;
+
+  for (size_t i = trailer_prefix_size; i != trailer_size - 1; i++) {
+    char c = trailer[i];
+
+    if (c >= '0' && c <= '9')
+      *crc = (*crc << 4) | (c - '0');
+    else if (c >= 'a' && c <= 'f')
+      *crc = (*crc << 4) | (c - 'a' + 10);
+    else
+      return false;
+  }
+
+  return true;
+}
+
+// Buffers output to a file descriptor and computes the CRC32 of
+// everything written through it.
+class checksum_buf : public std::streambuf {
+public:
+  checksum_buf(int fd)
+    : m_fd(fd)
+    , m_buffer(write_buffer_size) {
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+  }
+
+  uint32_t crc() const {
+    return m_crc;
+  }
+
+  bool flush() {
+    if (!write(pbase(), pptr() - pbase()))
+      return false;
+
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    return true;
+  }
+
+protected:
+  int_type overflow(int_type c) override {
+    if (!flush())
+      return traits_type::eof();
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    return flush() ? 0 : -1;
+  }
+
+private:
+  bool write(const char* data, size_t length) {
+    m_crc = session_crc32(m_crc, data, length);
+
+    while (length != 0) {
+      ssize_t result = ::write(m_fd, data, length);
+
+      if (result == -1 && errno == EINTR)
+        continue;
+
+      if (result <= 0)
+        return false;
+
+      data += result;
+      length -= result;
+    }
+
+    return true;
+  }
+
+  int               m_fd;
+  uint32_t          m_crc{ 0 };
+  std::vector<char> m_buffer;
+};
+
+}
+
+uint32_t
+session_crc32(uint32_t crc, const char* data, size_t length) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+
+      for (int k = 0; k < 8; k++)
+        c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+
+      t[i] = c;
+    }
+
+    return t;
+  }();
+
+  crc = ~crc;
+
+  while (length--)
+    crc = table[(crc ^ static_cast<uint8_t>(*data++)) & 0xff] ^ (crc >> 8);
+
+  return ~crc;
+}
+
+bool
+session_file_write(const std::string&     filename,
+                   const torrent::Object& object,
+                   uint32_t               skip_mask) {
+  std::string tmp_filename = filename + ".new";
+
+  if (!session_file_write_new(filename, object, skip_mask, true))
+    return false;
+
+  if (::rename(tmp_filename.c_str(), filename.c_str()) == -1) {
+    ::unlink(tmp_filename.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool
+session_file_write_new(const std::string&     filename,
+                       const torrent::Object& object,
+                       uint32_t               skip_mask,
+                       bool                   sync) {
+  std::string tmp_filename = filename + ".new";
+
+  int fd = ::open(
+    tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd == -1)
+    return false;
+
+  checksum_buf buffer(fd);
+  std::ostream stream(&buffer);
+
+  torrent::object_write_bencode(&stream, &object, skip_mask);
+
+  bool result = stream.good() && buffer.flush();
+
+  if (result)
+    stream << checksum_trailer(buffer.crc());
+
+  result = result && stream.good() && buffer.flush() &&
+           (!sync || ::fsync(fd) == 0);
+  result = ::close(fd) == 0 && result;
+
+  if (!result)
+    ::unlink(tmp_filename.c_str());
+
+  return result;
+}
+
+std::string
+session_file_string(const torrent::Object& object, uint32_t skip_mask) {
+  std::ostringstream stream;
+
+  torrent::object_write_bencode(&stream, &object, skip_mask);
+
+  std::string data = stream.str();
+
+  return data + checksum_trailer(session_crc32(0, data.data(), data.size()));
+}
+
+bool
+session_file_read(const std::string& filename, torrent::Object* object) {
+  utils::MappedFile file;
+
+  return file.open(filename) &&
+         session_file_parse(filename, file.data(), file.size(), object);
+}
+
+bool
+session_file_read_data(const std::string& filename, std::string* data) {
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd == -1)
+    return false;
+
+  struct stat st;
+
+  if (::fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    return false;
+  }
+
+  // The file may change size while being read, so read until end of
+  // file rather than trusting st_size.
+  data->resize(st.st_size + 1);
+
+  size_t length = 0;
+  bool   result = true;
+
+  while (true) {
+    if (length == data->size())
+      data->resize(data->size() * 2);
+
+    ssize_t count = ::read(fd, &(*data)[length], data->size() - length);
+
+    if (count == -1 && errno == EINTR)
+      continue;
+
+    if (count <= 0) {
+      result = count == 0;
+      break;
+    }
+
+    length += count;
+  }
+
+  ::close(fd);
+
+  data->resize(length);
+  return result;
+}
+
+bool
+bencode_parse(const char* data, size_t length, torrent::Object* object) {
+  try {
+    torrent::object_read_bencode_c(data, data + length, object);
+    return true;
+
+  } catch (const torrent::input_error&) {
+    return false;
+  }
+}
+
+bool
+session_file_parse(const std::string& filename,
+                   const char*        data,
+                   size_t             length,
+                   torrent::Object*   object) {
+  uint32_t crc;
+
+  if (parse_trailer(data, length, &crc)) {
+    length -= trailer_size;
+
+    if (session_crc32(0, data, length) != crc) {
+      lt_log_print(torrent::LOG_WARN,
+                   "Session file \"%s\" has a bad checksum.",
+                   filename.c_str());
+      return false;
+    }
+  }
+
+  if (!bencode_parse(data, length, object))
+    return false;
+
+  // The embedded checksum of earlier versions may have been left stale
+  // by a tool that rewrote the file, so it is dropped unverified.
+  if (object->is_map())
+    object->erase_key(legacy_checksum_key);
+
+  return true;
+}
+
+}
@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <algorithm>
+#include <chrono>
+
+#include "core/session_file.h"
+#include "core/session_loader.h"
+
+namespace core {
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+int64_t
+elapsed_since(clock_type::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           clock_type::now() - start)
+    .count();
+}
+
+double
+to_seconds(int64_t nanoseconds) {
+  return nanoseconds / 1e9;
+}
+
+bool
+parse_part(const SessionLoader::part_type& part, torrent::Object* object) {
+  if (part.mapping.is_open())
+    return session_file_parse(
+      part.filename, part.mapping.data(), part.mapping.size(), object);
+  else
+    return session_file_parse(part.filename, part.data, object);
+}
+
+}
+
+SessionLoader::SessionLoader(size_t size, read_slot slot)
+  : m_slot(std::move(slot))
+  , m_entries(size) {}
+
+SessionLoader::~SessionLoader() {
+  stop();
+}
+
+void
+SessionLoader::start(unsigned int threads) {
+  if (threads == 0)
+    threads = std::min(std::max(std::thread::hardware_concurrency(), 1u), 8u);
+
+  // No more threads than entries, but at least one so that next()
+  // can always complete.
+  threads = std::min<size_t>(threads, std::max<size_t>(m_entries.size(), 1));
+
+  m_window      = threads * entries_per_thread;
+  m_threadCount = threads;
+
+  for (unsigned int i = 0; i < threads; i++) {
+    m_threads.emplace_back([this] { run(); });
+  }
+}
+
+void
+SessionLoader::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+
+  m_workers.notify_all();
+
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+
+  m_threads.clear();
+}
+
+SessionLoader::object_ptr
+SessionLoader::next() {
+  auto start = clock_type::now();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  if (m_nextConsume >= m_entries.size())
+    return object_ptr();
+
+  entry_type& entry = m_entries[m_nextConsume];
+
+  m_consumer.wait(lock, [&entry] { return entry.done; });
+  m_nextConsume++;
+
+  lock.unlock();
+  m_workers.notify_all();
+
+  m_waitTime += elapsed_since(start);
+  return std::move(entry.object);
+}
+
+double
+SessionLoader::read_seconds() const {
+  return to_seconds(m_readTime);
+}
+
+double
+SessionLoader::decode_seconds() const {
+  return to_seconds(m_decodeTime);
+}
+
+double
+SessionLoader::wait_seconds() const {
+  return to_seconds(m_waitTime);
+}
+
+void
+SessionLoader::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true) {
+    m_workers.wait(lock, [this] {
+      return m_stop || m_nextLoad >= m_entries.size() ||
+             m_nextLoad < m_nextConsume + m_window;
+    });
+
+    if (m_stop || m_nextLoad >= m_entries.size())
+      break;
+
+    size_t index = m_nextLoad++;
+
+    lock.unlock();
+
+    object_ptr object(new torrent::Object);
+
+    if (!load(index, object.get()))
+      object.reset();
+
+    lock.lock();
+
+    m_entries[index].object = std::move(object);
+    m_entries[index].done   = true;
+
+    if (index == m_nextConsume)
+      m_consumer.notify_one();
+  }
+}
+
+bool
+SessionLoader::load(size_t index, torrent::Object* object) {
+  part_list parts;
+
+  auto start = clock_type::now();
+  bool read  = m_slot(index, &parts) && !parts.empty();
+
+  m_readTime += elapsed_since(start);
+
+  if (!read)
+    return false;
+
+  start = clock_type::now();
+
+  bool result = decode(parts, object);
+
+  m_decodeTime += elapsed_since(start);
+  return result;
+}
+
+bool
+SessionLoader::decode(const part_list& parts, torrent::Object* object) {
+  if (parts.empty() || !parse_part(parts.front(), object) ||
+      !object->is_map())
+    return false;
+
+  for (auto itr = parts.begin() + 1; itr != parts.end(); ++itr) {
+    torrent::Object part;
+
+    // Side files that cannot be decoded are ignored, as when loading
+    // through DownloadFactory.
+    if (parse_part(*itr, &part))
+      object->insert_key_move(itr->key, part);
+  }
+
+  return true;
+}
+
+}
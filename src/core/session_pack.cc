@@ -0,0 +1,570 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <torrent/exceptions.h>
+#include <torrent/utils/log.h>
+
+#include "core/session_file.h"
+#include "core/session_pack.h"
+
+namespace core {
+
+namespace {
+
+const char   pack_header[]    = "RTPACK01";
+const size_t pack_header_size = 8;
+
+// "RTPk" in little endian.
+const uint32_t record_magic       = 0x6b505452;
+const size_t   record_header_size = 33;
+const int      record_remove      = SessionPack::PART_MAX_SIZE;
+
+const size_t compact_buffer_size = 1 << 20;
+const size_t resync_chunk_size   = 1 << 16;
+
+bool
+write_all(int fd, const char* data, size_t length, uint64_t offset) {
+  while (length != 0) {
+    ssize_t result = ::pwrite(fd, data, length, offset);
+
+    if (result == -1 && errno == EINTR)
+      continue;
+
+    if (result <= 0)
+      return false;
+
+    data += result;
+    length -= result;
+    offset += result;
+  }
+
+  return true;
+}
+
+bool
+read_all(int fd, char* data, size_t length, uint64_t offset) {
+  while (length != 0) {
+    ssize_t result = ::pread(fd, data, length, offset);
+
+    if (result == -1 && errno == EINTR)
+      continue;
+
+    if (result <= 0)
+      return false;
+
+    data += result;
+    length -= result;
+    offset += result;
+  }
+
+  return true;
+}
+
+bool
+sync_directory(const std::string& path) {
+  std::string::size_type split = path.rfind('/');
+  std::string            dir =
+    split == std::string::npos ? "." : path.substr(0, split + 1);
+
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  if (fd == -1)
+    return false;
+
+  bool result = ::fsync(fd) == 0;
+  ::close(fd);
+
+  return result;
+}
+
+uint32_t
+record_checksum(const char* header, const char* payload, uint32_t size) {
+  return session_crc32(
+    session_crc32(0, header + 8, record_header_size - 8), payload, size);
+}
+
+// Whether a complete record with a valid checksum starts at 'offset'. The
+// payload is checksummed in bounded chunks so a corrupt size field cannot
+// force a large allocation.
+bool
+is_valid_record(int fd, uint64_t offset, uint64_t file_size) {
+  char     header[record_header_size];
+  uint32_t magic;
+  uint32_t crc;
+  uint32_t size;
+
+  if (file_size - offset < record_header_size ||
+      !read_all(fd, header, record_header_size, offset))
+    return false;
+
+  std::memcpy(&magic, header, 4);
+  std::memcpy(&crc, header + 4, 4);
+  std::memcpy(&size, header + 8, 4);
+
+  if (magic != record_magic ||
+      static_cast<uint8_t>(header[12]) > record_remove ||
+      file_size - offset - record_header_size < size)
+    return false;
+
+  uint32_t    sum = session_crc32(0, header + 8, record_header_size - 8);
+  std::string buffer(std::min<size_t>(size, resync_chunk_size), '\0');
+
+  for (offset += record_header_size; size != 0;) {
+    size_t length = std::min<size_t>(size, buffer.size());
+
+    if (!read_all(fd, &buffer[0], length, offset))
+      return false;
+
+    sum = session_crc32(sum, buffer.data(), length);
+    size -= length;
+    offset += length;
+  }
+
+  return sum == crc;
+}
+
+}
+
+SessionPack::~SessionPack() {
+  close();
+}
+
+void
+SessionPack::open(const std::string& path) {
+  if (is_open())
+    throw torrent::internal_error("SessionPack::open() pack is already open.");
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+  if (fd == -1)
+    throw torrent::storage_error("Could not open session pack \"" + path +
+                                 "\": " + std::strerror(errno));
+
+  struct stat st;
+
+  if (::fstat(fd, &st) == -1) {
+    ::close(fd);
+    throw torrent::storage_error("Could not stat session pack \"" + path +
+                                 "\": " + std::strerror(errno));
+  }
+
+  m_fd       = fd;
+  m_path     = path;
+  m_fileSize = st.st_size;
+
+  if (m_fileSize == 0) {
+    if (!write_all(m_fd, pack_header, pack_header_size, 0) ||
+        ::fsync(m_fd) == -1) {
+      close();
+      throw torrent::storage_error("Could not initialize session pack \"" +
+                                   path + "\".");
+    }
+
+    m_fileSize = pack_header_size;
+    return;
+  }
+
+  char header[pack_header_size];
+
+  if (m_fileSize < pack_header_size ||
+      !read_all(m_fd, header, pack_header_size, 0) ||
+      std::memcmp(header, pack_header, pack_header_size) != 0) {
+    close();
+    throw torrent::storage_error("File \"" + path +
+                                 "\" is not a session pack.");
+  }
+
+  scan();
+}
+
+void
+SessionPack::close() {
+  if (!is_open())
+    return;
+
+  ::close(m_fd);
+
+  m_fd       = -1;
+  m_fileSize = 0;
+  m_liveSize = 0;
+
+  m_index.clear();
+  m_buffer.clear();
+  m_pending.clear();
+}
+
+SessionPack::key_list
+SessionPack::keys() const {
+  std::vector<std::pair<uint64_t, const hash_type*>> order;
+
+  order.reserve(m_index.size());
+
+  for (const auto& entry : m_index) {
+    if (entry.second.parts[PART_TORRENT].offset != 0)
+      order.emplace_back(entry.second.parts[PART_TORRENT].offset, &entry.first);
+  }
+
+  std::sort(order.begin(), order.end());
+
+  key_list result;
+  result.reserve(order.size());
+
+  for (const auto& itr : order) {
+    result.push_back(*itr.second);
+  }
+
+  return result;
+}
+
+bool
+SessionPack::get(const hash_type& hash,
+                 part_type        part,
+                 std::string*     data) const {
+  auto itr = m_index.find(hash);
+
+  if (itr == m_index.end() || itr->second.parts[part].offset == 0)
+    return false;
+
+  const location_type& location = itr->second.parts[part];
+
+  return read_record(location.offset, location.size, data);
+}
+
+void
+SessionPack::put(const hash_type&   hash,
+                 part_type          part,
+                 const std::string& data) {
+  append(hash, part, data);
+}
+
+void
+SessionPack::remove(const hash_type& hash) {
+  append(hash, record_remove, std::string());
+}
+
+bool
+SessionPack::flush() {
+  if (m_buffer.empty())
+    return true;
+
+  if (!write_all(m_fd, m_buffer.data(), m_buffer.size(), m_fileSize) ||
+      ::fsync(m_fd) == -1) {
+    if (::ftruncate(m_fd, m_fileSize) == -1)
+      lt_log_print(torrent::LOG_ERROR,
+                   "Could not truncate session pack \"%s\": %s",
+                   m_path.c_str(),
+                   std::strerror(errno));
+
+    m_buffer.clear();
+    m_pending.clear();
+    return false;
+  }
+
+  for (const auto& pending : m_pending) {
+    apply(
+      pending.hash, pending.type, m_fileSize + pending.offset, pending.size);
+  }
+
+  m_fileSize += m_buffer.size();
+
+  m_buffer.clear();
+  m_pending.clear();
+  return true;
+}
+
+bool
+SessionPack::compact() {
+  if (!flush())
+    return false;
+
+  struct record_type {
+    uint64_t         offset;
+    uint32_t         size;
+    int              part;
+    const hash_type* hash;
+
+    bool operator<(const record_type& other) const {
+      return offset < other.offset;
+    }
+  };
+
+  // Keep the records in their current order, so that keys() is not
+  // changed by compacting.
+  std::vector<record_type> records;
+
+  for (const auto& entry : m_index) {
+    for (int part = 0; part < PART_MAX_SIZE; part++) {
+      const location_type& location = entry.second.parts[part];
+
+      if (location.offset != 0)
+        records.push_back(
+          record_type{ location.offset, location.size, part, &entry.first });
+    }
+  }
+
+  std::sort(records.begin(), records.end());
+
+  std::string new_path = m_path + ".new";
+  int         fd =
+    ::open(new_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd == -1)
+    return false;
+
+  index_type  index;
+  std::string buffer(pack_header, pack_header_size);
+  uint64_t    offset  = pack_header_size;
+  uint64_t    written = 0;
+  bool        result  = true;
+
+  for (const auto& record : records) {
+    size_t start = buffer.size();
+    buffer.resize(start + record_header_size + record.size);
+
+    if (!read_all(m_fd,
+                  &buffer[start],
+                  record_header_size + record.size,
+                  record.offset)) {
+      result = false;
+      break;
+    }
+
+    index[*record.hash].parts[record.part] =
+      location_type{ offset, record.size };
+    offset += record_header_size + record.size;
+
+    if (buffer.size() >= compact_buffer_size) {
+      if (!(result = write_all(fd, buffer.data(), buffer.size(), written)))
+        break;
+
+      written += buffer.size();
+      buffer.clear();
+    }
+  }
+
+  result = result && write_all(fd, buffer.data(), buffer.size(), written) &&
+           ::fsync(fd) == 0 && ::rename(new_path.c_str(), m_path.c_str()) == 0;
+
+  if (!result) {
+    ::close(fd);
+    ::unlink(new_path.c_str());
+    return false;
+  }
+
+  sync_directory(m_path);
+
+  ::close(m_fd);
+
+  m_fd       = fd;
+  m_fileSize = offset;
+  m_liveSize = offset - pack_header_size;
+  m_index.swap(index);
+
+  return true;
+}
+
+void
+SessionPack::scan() {
+  uint64_t    offset = pack_header_size;
+  std::string payload;
+
+  while (offset < m_fileSize) {
+    char     header[record_header_size];
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t size;
+
+    if (m_fileSize - offset < record_header_size)
+      break;
+
+    if (!read_all(m_fd, header, record_header_size, offset))
+      throw torrent::storage_error("Could not read session pack \"" + m_path +
+                                   "\": " + std::strerror(errno));
+
+    std::memcpy(&magic, header, 4);
+    std::memcpy(&crc, header + 4, 4);
+    std::memcpy(&size, header + 8, 4);
+
+    int type = static_cast<uint8_t>(header[12]);
+
+    if (magic != record_magic || type > record_remove ||
+        m_fileSize - offset - record_header_size < size) {
+      uint64_t next = resync(offset);
+
+      if (next != m_fileSize) {
+        lt_log_print(torrent::LOG_WARN,
+                     "Skipping %llu corrupt bytes of session pack \"%s\" at "
+                     "offset %llu.",
+                     static_cast<unsigned long long>(next - offset),
+                     m_path.c_str(),
+                     static_cast<unsigned long long>(offset));
+
+        offset = next;
+        continue;
+      }
+
+      // Only a record header whose payload runs past the end is what an
+      // interrupted flush leaves behind. Keep anything else for
+      // inspection, later appends are found by resyncing past it.
+      if (magic == record_magic && type <= record_remove)
+        break;
+
+      lt_log_print(torrent::LOG_WARN,
+                   "Ignoring %llu corrupt bytes at the end of session pack "
+                   "\"%s\".",
+                   static_cast<unsigned long long>(m_fileSize - offset),
+                   m_path.c_str());
+      return;
+    }
+
+    payload.resize(size);
+
+    if (size != 0 &&
+        !read_all(m_fd, &payload[0], size, offset + record_header_size))
+      throw torrent::storage_error("Could not read session pack \"" + m_path +
+                                   "\": " + std::strerror(errno));
+
+    if (record_checksum(header, payload.data(), size) == crc)
+      apply(hash_type(header + 13, 20), type, offset, size);
+    else
+      lt_log_print(torrent::LOG_WARN,
+                   "Skipping session pack record with a bad checksum at "
+                   "offset %llu.",
+                   static_cast<unsigned long long>(offset));
+
+    offset += record_header_size + size;
+  }
+
+  if (offset == m_fileSize)
+    return;
+
+  lt_log_print(torrent::LOG_WARN,
+               "Truncating session pack \"%s\" from %llu to %llu bytes.",
+               m_path.c_str(),
+               static_cast<unsigned long long>(m_fileSize),
+               static_cast<unsigned long long>(offset));
+
+  if (::ftruncate(m_fd, offset) == -1)
+    throw torrent::storage_error("Could not truncate session pack \"" +
+                                 m_path + "\": " + std::strerror(errno));
+
+  m_fileSize = offset;
+}
+
+// Returns the offset of the next valid record after 'offset', or the
+// file size if there is none. The file is scanned in fixed-size chunks,
+// keeping the last three bytes of each so a magic split across a chunk
+// boundary is still found.
+uint64_t
+SessionPack::resync(uint64_t offset) {
+  char magic[4];
+  std::memcpy(magic, &record_magic, 4);
+
+  std::string window;
+  uint64_t    next = offset + 1;
+
+  while (next < m_fileSize) {
+    size_t   keep   = std::min<size_t>(window.size(), 3);
+    size_t   length = std::min<uint64_t>(m_fileSize - next, resync_chunk_size);
+    uint64_t base   = next - keep;
+
+    window.erase(0, window.size() - keep);
+    window.resize(keep + length);
+
+    if (!read_all(m_fd, &window[keep], length, next))
+      throw torrent::storage_error("Could not read session pack \"" +
+                                   m_path + "\": " + std::strerror(errno));
+
+    next += length;
+
+    for (auto pos = window.find(magic, 0, 4); pos != std::string::npos;
+         pos = window.find(magic, pos + 1, 4)) {
+      if (is_valid_record(m_fd, base + pos, m_fileSize))
+        return base + pos;
+    }
+  }
+
+  return m_fileSize;
+}
+
+void
+SessionPack::apply(const hash_type& hash,
+                   int              type,
+                   uint64_t         offset,
+                   uint32_t         size) {
+  if (type == record_remove) {
+    auto itr = m_index.find(hash);
+
+    if (itr == m_index.end())
+      return;
+
+    for (const auto& location : itr->second.parts) {
+      if (location.offset != 0)
+        m_liveSize -= record_header_size + location.size;
+    }
+
+    m_index.erase(itr);
+    return;
+  }
+
+  location_type& location = m_index[hash].parts[type];
+
+  if (location.offset != 0)
+    m_liveSize -= record_header_size + location.size;
+
+  location = location_type{ offset, size };
+  m_liveSize += record_header_size + size;
+}
+
+void
+SessionPack::append(const hash_type& hash, int type, const std::string& data) {
+  if (hash.size() != 20)
+    throw torrent::internal_error("SessionPack::append() invalid hash size.");
+
+  size_t   start = m_buffer.size();
+  uint32_t size  = data.size();
+  char     header[record_header_size];
+
+  std::memcpy(header, &record_magic, 4);
+  std::memcpy(header + 8, &size, 4);
+  header[12] = static_cast<char>(type);
+  std::memcpy(header + 13, hash.data(), 20);
+
+  uint32_t crc = record_checksum(header, data.data(), size);
+  std::memcpy(header + 4, &crc, 4);
+
+  m_buffer.append(header, record_header_size);
+  m_buffer.append(data);
+
+  m_pending.push_back(pending_type{ hash, type, start, size });
+}
+
+bool
+SessionPack::read_record(uint64_t     offset,
+                         uint32_t     size,
+                         std::string* data) const {
+  std::string record(record_header_size + size, '\0');
+
+  if (!read_all(m_fd, &record[0], record.size(), offset))
+    return false;
+
+  uint32_t crc;
+  std::memcpy(&crc, record.data() + 4, 4);
+
+  const char* payload = record.data() + record_header_size;
+
+  if (record_checksum(record.data(), payload, size) != crc)
+    return false;
+
+  data->assign(record, record_header_size, size);
+  return true;
+}
+
+}
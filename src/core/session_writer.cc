@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "core/session_writer.h"
+
+namespace core {
+
+SessionWriter::~SessionWriter() {
+  stop();
+}
+
+void
+SessionWriter::start() {
+  if (is_running())
+    return;
+
+  m_stop   = false;
+  m_thread = std::thread([this] { run(); });
+}
+
+void
+SessionWriter::stop() {
+  if (!is_running())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+
+  m_condition.notify_all();
+  m_thread.join();
+}
+
+void
+SessionWriter::push(job_type&& job) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back(std::move(job));
+  }
+
+  m_condition.notify_one();
+}
+
+size_t
+SessionWriter::pending() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return m_jobs.size() + m_active;
+}
+
+void
+SessionWriter::collect(result_list* results) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (results->empty()) {
+    results->swap(m_results);
+    return;
+  }
+
+  results->insert(results->end(), m_results.begin(), m_results.end());
+  m_results.clear();
+}
+
+bool
+SessionWriter::write_file(const file_type& file) {
+  std::string tmp_filename = file.filename + ".new";
+
+  int fd = ::open(
+    tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd == -1)
+    return false;
+
+  const char* data   = file.data.data();
+  size_t      length = file.data.size();
+
+  while (length != 0) {
+    ssize_t result = ::write(fd, data, length);
+
+    if (result == -1 && errno == EINTR)
+      continue;
+
+    if (result <= 0) {
+      ::close(fd);
+      ::unlink(tmp_filename.c_str());
+      return false;
+    }
+
+    data += result;
+    length -= result;
+  }
+
+  if (::fsync(fd) == -1 || ::close(fd) == -1) {
+    ::unlink(tmp_filename.c_str());
+    return false;
+  }
+
+  return ::rename(tmp_filename.c_str(), file.filename.c_str()) == 0;
+}
+
+void
+SessionWriter::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true) {
+    m_condition.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+
+    if (m_jobs.empty())
+      break;
+
+    job_type job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    m_active++;
+
+    lock.unlock();
+
+    bool success = true;
+
+    for (const auto& file : job.files) {
+      success = write_file(file) && success;
+    }
+
+    for (const auto& filename : job.unlinks) {
+      ::unlink(filename.c_str());
+    }
+
+    lock.lock();
+
+    m_active--;
+    m_results.push_back(result_type{ std::move(job.hash), success });
+  }
+}
+
+}
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <set>
 #include <torrent/download.h>
 #include <torrent/exceptions.h>
 
@@ -13,6 +14,7 @@
 #include "core/view.h"
 #include "rpc/object_storage.h"
 #include "rpc/parse_commands.h"
+#include "utils/usdt.h"
 
 namespace core {
 
@@ -179,6 +181,10 @@ View::initialize(const std::string& name) {
 
 void
 View::erase(Download* download) {
+  m_deferredFilter.erase(
+    std::remove(m_deferredFilter.begin(), m_deferredFilter.end(), download),
+    m_deferredFilter.end());
+
   iterator itr = std::find(base_type::begin(), base_type::end(), download);
 
   if (itr >= end_visible()) {
@@ -247,31 +253,90 @@ View::sort() {
     return;
   }
 
+  torrent::utils::timer started = torrent::utils::timer::current();
+
+  RT_PROBE2(view_sort_start, m_name.c_str(), (uint64_t)size_visible());
+
   Download* curFocus = focus() != end_visible() ? *focus() : nullptr;
 
   // Don't go randomly switching around equivalent elements.
-  std::stable_sort(
-    begin(), end_visible(), view_downloads_compare(m_sortCurrent));
+  if (!m_hasColumnSort ||
+      !control->core()->download_list()->columns()->sort(
+        m_columnSort, begin(), end_visible()))
+    std::stable_sort(
+      begin(), end_visible(), view_downloads_compare(m_sortCurrent));
 
   m_focus = position(std::find(begin(), end_visible(), curFocus));
   emit_changed();
+
+  m_stats.sort_last = (torrent::utils::timer::current() - started).usec();
+  m_stats.sort_time += m_stats.sort_last;
+  m_stats.sort_count++;
+
+  RT_PROBE2(view_sort_done, m_name.c_str(), m_stats.sort_last);
 }
 
 void
 View::filter() {
+  filter_range(false);
+}
+
+void
+View::filter_narrow() {
+  filter_range(true);
+}
+
+void
+View::filter_range(bool narrow) {
   // Do NOT allow filter STARTED and STOPPED views: they are special
   if (m_name == "started" || m_name == "stopped")
     return;
 
+  torrent::utils::timer started = torrent::utils::timer::current();
+
+  RT_PROBE3(view_filter_start, m_name.c_str(), (uint64_t)size(), (int)narrow);
+
+  DownloadList*              list    = control->core()->download_list();
+  DownloadColumns*           columns = nullptr;
+  DownloadColumns::mask_type mask;
+
+  if (m_hasColumnFilter) {
+    columns = list->columns();
+    columns->filter(m_columnFilter, &mask);
+  }
+
+  torrent::Object        empty;
+  const torrent::Object& temp_filter = m_hasTempName ? empty : m_temp_filter;
+
+  auto matches_name = [&](Download* download) {
+    const std::string* name = list->find_name(download);
+
+    if (name != nullptr)
+      return name->find(m_tempName) != std::string::npos;
+
+    return DownloadList::lowercase_name(download).find(m_tempName) !=
+           std::string::npos;
+  };
+
+  auto matches = [&](Download* download) {
+    if (m_hasTempName && !matches_name(download))
+      return false;
+
+    size_t row = columns != nullptr ? columns->find(download) : 0;
+
+    if (columns == nullptr || row == columns->size())
+      return view_downloads_filter(m_filter, temp_filter)(download);
+
+    return mask[row] != 0;
+  };
+
   // Parition the list in two steps so we know which elements changed.
+  // When narrowing, nothing that is filtered can become visible.
   iterator splitVisible =
-    std::stable_partition(begin_visible(),
-                          end_visible(),
-                          view_downloads_filter(m_filter, m_temp_filter));
+    std::stable_partition(begin_visible(), end_visible(), matches);
   iterator splitFiltered =
-    std::stable_partition(begin_filtered(),
-                          end_filtered(),
-                          view_downloads_filter(m_filter, m_temp_filter));
+    narrow ? end_visible()
+           : std::stable_partition(begin_filtered(), end_filtered(), matches);
 
   base_type changed(splitVisible, splitFiltered);
   iterator  splitChanged =
@@ -307,6 +372,15 @@ View::filter() {
   }
 
   emit_changed();
+
+  m_stats.filter_last = (torrent::utils::timer::current() - started).usec();
+  m_stats.filter_time += m_stats.filter_last;
+  m_stats.filter_count++;
+
+  RT_PROBE3(view_filter_done,
+            m_name.c_str(),
+            (uint64_t)m_size,
+            m_stats.filter_last);
 }
 
 void
@@ -363,6 +437,72 @@ View::filter_download(core::Download* download) {
   emit_changed();
 }
 
+void
+View::flush_filter() {
+  base_type           pending;
+  std::set<Download*> seen;
+
+  pending.swap(m_deferredFilter);
+
+  for (const auto& download : pending) {
+    if (seen.insert(download).second)
+      filter_download(download);
+  }
+}
+
+void
+View::update_column_filter() {
+  column_filter filter;
+  column_filter filter_temp;
+
+  m_hasColumnFilter =
+    DownloadColumns::compile_filter(m_filter, &filter) &&
+    DownloadColumns::compile_filter(
+      m_hasTempName ? torrent::Object() : m_temp_filter, &filter_temp);
+
+  if (!m_hasColumnFilter)
+    return;
+
+  m_columnFilter      = column_filter();
+  m_columnFilter.type = column_filter::NODE_AND;
+  m_columnFilter.children.push_back(std::move(filter));
+  m_columnFilter.children.push_back(std::move(filter_temp));
+}
+
+bool
+View::is_filter_temp_refinement(const torrent::Object& s) const {
+  std::string substring;
+
+  return m_hasTempName && filter_name_substring(s, &substring) &&
+         substring.find(m_tempName) != std::string::npos;
+}
+
+bool
+View::filter_name_substring(const torrent::Object& s, std::string* substring) {
+  static const std::string prefix = "match={d.name=,.*";
+  static const std::string suffix = ".*}";
+
+  if (!s.is_string())
+    return false;
+
+  const std::string& cmd = s.as_string();
+
+  if (cmd.size() < prefix.size() + suffix.size() ||
+      cmd.compare(0, prefix.size(), prefix) != 0 ||
+      cmd.compare(cmd.size() - suffix.size(), suffix.size(), suffix) != 0)
+    return false;
+
+  *substring =
+    cmd.substr(prefix.size(), cmd.size() - prefix.size() - suffix.size());
+
+  if (substring->find_first_of("\\.^$|?*+()[]{},\"") != std::string::npos)
+    return false;
+
+  std::transform(
+    substring->begin(), substring->end(), substring->begin(), ::tolower);
+  return true;
+}
+
 void
 View::set_filter_on_event(const std::string& event) {
   control->object_storage()->set_str_multi_key(
@@ -24,6 +24,7 @@ ViewManager::clear() {
   }
 
   base_type::clear();
+  m_index.clear();
 }
 
 ViewManager::iterator
@@ -37,19 +38,21 @@ ViewManager::insert(const std::string& name) {
   View* view = new View();
   view->initialize(name);
 
+  m_index.emplace(name, size());
+
   return base_type::insert(end(), view);
 }
 
 ViewManager::iterator
 ViewManager::find(const std::string& name) {
-  return std::find_if(
-    begin(), end(), [name](View* v) { return name == v->name(); });
+  index_type::const_iterator itr = m_index.find(name);
+
+  return itr != m_index.end() ? begin() + itr->second : end();
 }
 
 ViewManager::iterator
 ViewManager::find_throw(const std::string& name) {
-  iterator itr =
-    std::find_if(begin(), end(), [name](View* v) { return name == v->name(); });
+  iterator itr = find(name);
 
   if (itr == end())
     throw torrent::input_error("Could not find view: " + name);
@@ -84,8 +87,21 @@ ViewManager::set_filter_temp(const std::string&     name,
                              const torrent::Object& cmd) {
   iterator viewItr = find_throw(name);
 
+  bool narrow = (*viewItr)->is_filter_temp_refinement(cmd);
+
   (*viewItr)->set_filter_temp(cmd);
-  (*viewItr)->filter();
+
+  if (narrow)
+    (*viewItr)->filter_narrow();
+  else
+    (*viewItr)->filter();
+}
+
+void
+ViewManager::flush_filter() {
+  for (const auto& view : *this) {
+    view->flush_filter();
+  }
 }
 
 void
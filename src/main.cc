@@ -5,9 +5,11 @@
 
 #include "buildinfo.h"
 
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <dirent.h>
 #include <inttypes.h>
 #include <iostream>
 #include <queue>
@@ -15,6 +17,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <torrent/buildinfo.h>
@@ -25,16 +28,21 @@
 #include <torrent/torrent.h>
 #include <torrent/utils/error_number.h>
 #include <torrent/utils/log.h>
+#include <torrent/utils/string_manip.h>
 
 #ifdef LT_HAVE_BACKTRACE
 #include <execinfo.h>
 #endif
 
 #include "core/dht_manager.h"
+#include "core/dormant_list.h"
 #include "core/download.h"
 #include "core/download_factory.h"
+#include "core/download_list.h"
 #include "core/download_store.h"
+#include "core/handoff.h"
 #include "core/manager.h"
+#include "core/session_loader.h"
 #include "core/view_manager.h"
 #include "display/canvas.h"
 #include "display/manager.h"
@@ -47,6 +55,8 @@
 #include "rpc/parse_commands.h"
 #include "utils/directory.h"
 #include "utils/indicators.h"
+#include "utils/lock_stats.h"
+#include "utils/task_stats.h"
 
 #include "command_helpers.h"
 #include "control.h"
@@ -117,18 +127,83 @@ parse_options(int                                              argc,
   }
 }
 
+// We don't really support session torrents that are links. These
+// would be overwritten anyway on exit, and thus not really be
+// useful. Entries that are not regular files or links are skipped,
+// and only those whose type the file system didn't report need a
+// stat.
+static bool
+is_session_file(const std::string& filename, uint8_t type) {
+#ifdef DT_UNKNOWN
+  if (type == DT_REG || type == DT_LNK)
+    return true;
+
+  if (type != DT_UNKNOWN)
+    return false;
+#else
+  (void)type;
+#endif
+
+  struct stat st;
+
+  return ::stat(filename.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
 void
 load_session_torrents() {
+  using clock_type = std::chrono::steady_clock;
+
+  auto seconds_since = [](clock_type::time_point start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+  };
+
   indicators::BlockProgressBar* progress_bar = nullptr;
 
-  utils::Directory entries =
-    control->core()->download_store()->get_formated_entries();
+  core::DownloadStore* store = control->core()->download_store();
+
+  // Downloads passed on by 'system.restart' are already decoded, and
+  // the session directory is not read.
+  torrent::Object&            handoff     = control->handoff();
+  torrent::Object::list_type* handed_over = nullptr;
+
+  if (handoff.is_map() && handoff.has_key_list("downloads"))
+    handed_over = &handoff.get_key_list("downloads");
+
+  // A new pack is filled from the session files, if there are any.
+  bool from_pack = handed_over == nullptr && store->is_packed() &&
+                   store->pack()->is_open() && !store->pack()->empty();
+
+  auto readdir_start = clock_type::now();
+
+  core::SessionPack::key_list keys;
+  std::vector<std::string>    filenames;
+
+  if (from_pack) {
+    keys = store->pack()->keys();
+  } else if (handed_over == nullptr) {
+    utils::DirectoryNames entries = store->get_formated_entries();
+
+    filenames.reserve(entries.size());
+
+    for (size_t index = 0; index < entries.size(); index++) {
+      std::string filename = store->path() + entries.name(index);
+
+      if (is_session_file(filename, entries.type(index)))
+        filenames.push_back(std::move(filename));
+    }
+  }
+
+  double readdir_time = seconds_since(readdir_start);
 
-  const auto entries_size = entries.size();
+  const auto entries_size = handed_over != nullptr ? handed_over->size()
+                            : from_pack              ? keys.size()
+                                                     : filenames.size();
 
   if (!display::Canvas::isInitialized() && entries_size) {
     std::cout << "rTorrent: loading " << entries_size
-              << " entries from session directory" << std::endl;
+              << (handed_over != nullptr ? " entries from restart state"
+                                         : " entries from session directory")
+              << std::endl;
     if (isatty(fileno(stdin)) && isatty(fileno(stdout))) {
       progress_bar = new indicators::BlockProgressBar{
         indicators::option::BarWidth{ 50 },
@@ -140,17 +215,7 @@ load_session_torrents() {
     }
   }
 
-  for (const auto& entry : entries) {
-    // We don't really support session torrents that are links. These
-    // would be overwritten anyway on exit, and thus not really be
-    // useful.
-    if (!entry.is_file()) {
-      if (progress_bar != nullptr) {
-        progress_bar->tick();
-      }
-      continue;
-    }
-
+  auto create_factory = [&progress_bar, entries_size]() {
     core::DownloadFactory* f = new core::DownloadFactory(control->core());
 
     // Replace with session torrent flag.
@@ -169,10 +234,124 @@ load_session_torrents() {
       delete f;
     });
 
-    f->load(entries.path() + entry.d_name);
+    return f;
+  };
+
+  // Reading and decoding is done by the loader threads, while the
+  // downloads are created and inserted here in the original order.
+  core::SessionLoader loader(
+    handed_over != nullptr ? 0 : entries_size,
+    [store, from_pack, &keys, &filenames](
+      size_t index, core::SessionLoader::part_list* parts) {
+      if (from_pack)
+        return store->read_packed(keys[index], parts);
+      else
+        return core::DownloadStore::read_files(filenames[index], parts);
+    });
+
+  auto create_start = clock_type::now();
+
+  // Entries migrated to a new pack must all be loaded, as they are
+  // saved to it from the download list.
+  core::DormantList* dormant_list = control->core()->dormant_list();
+  bool               use_dormant = handed_over == nullptr &&
+                     dormant_list->is_enabled() &&
+                     !(store->is_packed() && !from_pack);
+
+  if (handed_over != nullptr && handoff.has_key("dormant"))
+    dormant_list->load_list(handoff.get_key("dormant"));
+
+  loader.start(store->load_threads());
+
+  for (size_t index = 0; index < entries_size; index++) {
+    if (handed_over != nullptr) {
+      torrent::Object& entry = (*handed_over)[index];
+      std::string      uri;
+
+      if (entry.has_key_map("rtorrent") &&
+          entry.get_key("rtorrent").has_key_string("loaded_file"))
+        uri = entry.get_key("rtorrent").get_key_string("loaded_file");
+
+      core::DownloadFactory* f = create_factory();
+
+      f->set_handed_over(true);
+      f->load_object(new torrent::Object(std::move(entry)), uri);
+      f->commit();
+      continue;
+    }
+
+    core::SessionLoader::object_ptr object = loader.next();
+
+    if (use_dormant && object != nullptr &&
+        core::DormantList::is_dormant(*object)) {
+      if (from_pack) {
+        dormant_list->insert(keys[index], std::string(), *object);
+      } else {
+        // Session torrents are named by their hex info hash.
+        const std::string& filename = filenames[index];
+
+        dormant_list->insert(core::DormantList::hash_from_hex(
+                               filename.substr(filename.size() - 48, 40)),
+                             filename,
+                             *object);
+      }
+
+      if (progress_bar != nullptr) {
+        progress_bar->tick();
+      }
+      continue;
+    }
+
+    if (object == nullptr && from_pack) {
+      lt_log_print(torrent::LOG_ERROR,
+                   "Could not read session torrent %s from the pack.",
+                   torrent::utils::transform_hex_str(keys[index]).c_str());
+
+      if (progress_bar != nullptr) {
+        progress_bar->tick();
+      }
+      continue;
+    }
+
+    core::DownloadFactory* f = create_factory();
+
+    // Let the factory retry the file, so that the failure is reported
+    // the usual way.
+    if (object == nullptr)
+      f->load(filenames[index]);
+    else
+      f->load_object(object.release(), from_pack ? "" : filenames[index]);
+
     f->commit();
   }
 
+  loader.stop();
+
+  double create_time = seconds_since(create_start) - loader.wait_seconds();
+
+  // Migrate from the per-file layout. The session files are left in
+  // place, but are no longer read while the pack has entries.
+  if (store->is_packed() && !from_pack && handed_over == nullptr &&
+      entries_size != 0) {
+    core::DownloadList* list = control->core()->download_list();
+
+    store->begin_batch();
+
+    for (const auto& download : *list) {
+      store->save_full(download);
+    }
+
+    if (store->end_batch())
+      lt_log_print(torrent::LOG_NOTICE,
+                   "Migrated %zu session torrents to the pack.",
+                   list->size());
+    else
+      lt_log_print(torrent::LOG_ERROR,
+                   "Failed to migrate session torrents to the pack.");
+  }
+
+  auto hash_start = clock_type::now();
+
   // Hash torrents
   if (progress_bar != nullptr) {
     progress_bar->set_option(indicators::option::PostfixText{ "Checking" });
@@ -185,11 +364,38 @@ load_session_torrents() {
 
   priority_queue_perform(&taskScheduler, cachedTime);
 
+  double hash_time = seconds_since(hash_start);
+
   if (progress_bar != nullptr) {
     progress_bar->set_option(indicators::option::PostfixText{ "" });
     progress_bar->mark_as_completed();
     delete progress_bar;
   }
+
+  if (entries_size == 0)
+    return;
+
+  char timing[256];
+
+  std::snprintf(timing,
+                sizeof(timing),
+                "readdir %.2fs, read %.2fs, decode %.2fs, create %.2fs, "
+                "hash queue %.2fs (read and decode summed over %u threads)",
+                readdir_time,
+                loader.read_seconds(),
+                loader.decode_seconds(),
+                create_time,
+                hash_time,
+                loader.threads());
+
+  lt_log_print(torrent::LOG_NOTICE,
+               "Loaded %zu session entries, %zu dormant: %s.",
+               entries_size,
+               dormant_list->size(),
+               timing);
+
+  if (!display::Canvas::isInitialized())
+    std::cout << "rTorrent: session entries loaded: " << timing << std::endl;
 }
 
 void
@@ -207,7 +413,9 @@ load_arg_torrents(char** first, char** last) {
 
 static uint64_t
 client_next_timeout() {
-  if (taskScheduler.empty())
+  if (control->core()->download_list()->has_pending_events())
+    return 0;
+  else if (taskScheduler.empty())
     return (control->is_shutdown_started()
               ? torrent::utils::timer::from_milliseconds(100)
               : torrent::utils::timer::from_seconds(60))
@@ -227,10 +435,21 @@ client_perform() {
   if (control->is_shutdown_received())
     control->handle_shutdown();
 
+  utils::LockStats::begin_hold("main");
+  utils::TaskStats::begin_tick();
+
   control->inc_tick();
 
   cachedTime = torrent::utils::timer::current();
-  torrent::utils::priority_queue_perform(&taskScheduler, cachedTime);
+  utils::TaskStats::perform(&taskScheduler, cachedTime);
+
+  control->core()->download_list()->flush_events();
+  control->core()->download_store()->collect_writes();
+  control->core()->publish_snapshot();
+  control->core()->publish_stats();
+
+  utils::TaskStats::end_tick();
+  utils::LockStats::end_hold();
 }
 
 int
@@ -246,6 +465,11 @@ main(int argc, char** argv) {
     torrent::log_initialize();
 
     control = new Control;
+    control->set_arguments(argc, argv);
+
+    if (core::handoff_read(&control->handoff()))
+      std::cout << "rTorrent: restarting from the state of the previous process"
+                << std::endl;
 
     // Seed RNG
     std::random_device rd;
@@ -638,6 +862,8 @@ main(int argc, char** argv) {
     load_session_torrents();
     load_arg_torrents(argv + firstArg, argv + argc);
 
+    control->release_handoff();
+
     // Make sure we update the display before any scheduled tasks can
     // run, so that loading of torrents doesn't look like it hangs on
     // startup.
@@ -659,7 +885,7 @@ main(int argc, char** argv) {
 
     torrent::thread_base::event_loop(torrent::main_thread());
 
-    control->core()->download_list()->session_save();
+    control->shutdown_save();
     control->cleanup();
 
   } catch (torrent::internal_error& e) {
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // Copyright (C) 2005-2011, Jari Sundell <jaris@ifi.uio.no>
 
+#include <chrono>
 #include <torrent/data/file_list_iterator.h>
 #include <torrent/exceptions.h>
 #include <torrent/object.h>
@@ -13,12 +14,51 @@
 
 #include "rpc/command.h"
 #include "rpc/command_map.h"
+#include "utils/allocation_count.h"
+#include "utils/trace.h"
+#include "utils/usdt.h"
 
 // For XMLRPC stuff, clean up.
 #include "rpc/parse_commands.h"
 
 namespace rpc {
 
+namespace {
+
+class profile_scope {
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  explicit profile_scope(command_map_profile* profile)
+    : m_profile(profile)
+    , m_allocations(utils::allocation_count())
+    , m_start(clock_type::now()) {}
+
+  ~profile_scope() {
+    uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      clock_type::now() - m_start)
+                      .count();
+    uint64_t max = m_profile->m_timeMax.load(std::memory_order_relaxed);
+
+    while (time > max && !m_profile->m_timeMax.compare_exchange_weak(
+                           max, time, std::memory_order_relaxed))
+      ;
+
+    m_profile->m_calls.fetch_add(1, std::memory_order_relaxed);
+    m_profile->m_time.fetch_add(time, std::memory_order_relaxed);
+    m_profile->m_allocations.fetch_add(utils::allocation_count() -
+                                         m_allocations,
+                                       std::memory_order_relaxed);
+  }
+
+private:
+  command_map_profile*   m_profile;
+  uint64_t               m_allocations;
+  clock_type::time_point m_start;
+};
+
+}
+
 command_base::stack_type command_base::current_stack;
 
 CommandMap::~CommandMap() {
@@ -72,6 +112,17 @@ CommandMap::insert(key_type key, int flags, const char* parm, const char* doc) {
 //   itr->second.m_anySlot = src.m_anySlot;
 // }
 
+void
+CommandMap::set_modifier(key_type key) {
+  iterator itr = base_type::find(key);
+
+  if (itr == base_type::end())
+    throw torrent::internal_error(
+      "CommandMap::set_modifier(...) key not found: " + std::string(key));
+
+  itr->second.m_flags |= flag_modifier;
+}
+
 void
 CommandMap::erase(iterator itr) {
   if (itr == end())
@@ -155,14 +206,46 @@ CommandMap::call_command(key_type           key,
     throw torrent::input_error("Command \"" + std::string(key) +
                                "\" does not exist.");
 
-  return itr->second.m_anySlot(&itr->second.m_variable, target, arg);
+  return call_command(itr, arg, target);
+}
+
+void
+CommandMap::profile_reset() {
+  for (auto& [key, data] : *this) {
+    data.m_profile.m_calls.store(0, std::memory_order_relaxed);
+    data.m_profile.m_time.store(0, std::memory_order_relaxed);
+    data.m_profile.m_timeMax.store(0, std::memory_order_relaxed);
+    data.m_profile.m_allocations.store(0, std::memory_order_relaxed);
+  }
 }
 
 const CommandMap::mapped_type
 CommandMap::call_command(iterator           itr,
                          const mapped_type& arg,
                          target_type        target) {
-  return itr->second.m_anySlot(&itr->second.m_variable, target, arg);
+  RT_TRACE_SPAN(itr->first);
+  RT_PROBE2(command_start, itr->first, (int)std::get<0>(target));
+  RT_PROBE_ON_EXIT(RT_PROBE1(command_done, itr->first));
+
+  if (!is_profiling())
+    return call_slot(itr, arg, target);
+
+  profile_scope scope(&itr->second.m_profile);
+  return call_slot(itr, arg, target);
+}
+
+const CommandMap::mapped_type
+CommandMap::call_slot(iterator           itr,
+                      const mapped_type& arg,
+                      target_type        target) {
+  if (!(itr->second.m_flags & flag_modifier) || !m_slotModified)
+    return itr->second.m_anySlot(&itr->second.m_variable, target, arg);
+
+  mapped_type result =
+    itr->second.m_anySlot(&itr->second.m_variable, target, arg);
+
+  m_slotModified(target);
+  return result;
 }
 
 }
@@ -4,11 +4,19 @@
 #include <torrent/exceptions.h>
 
 #include "rpc/command_scheduler_item.h"
+#include "utils/task_stats.h"
 
 namespace rpc {
 
+CommandSchedulerItem::CommandSchedulerItem(const std::string& key)
+  : m_key(key)
+  , m_interval(0) {
+  utils::TaskStats::set_name(&m_task, "schedule2 " + key);
+}
+
 CommandSchedulerItem::~CommandSchedulerItem() {
   priority_queue_erase(&taskScheduler, &m_task);
+  utils::TaskStats::erase_name(&m_task);
 }
 
 void
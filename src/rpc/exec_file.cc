@@ -1,19 +1,40 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // Copyright (C) 2005-2011, Jari Sundell <jaris@ifi.uio.no>
 
+#include <cstdio>
+#include <cstring>
 #include <fcntl.h>
+#include <iterator>
+#include <spawn.h>
 #include <string>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 #include <torrent/utils/error_number.h>
+#include <torrent/utils/log.h>
 #include <torrent/utils/path.h>
 
 #include "thread_base.h"
 
 #include "rpc/exec_file.h"
 #include "rpc/parse.h"
+#include "rpc/parse_commands.h"
+#include "utils/lock_stats.h"
+
+// Spawn without copying our page tables where the library can also
+// close the descriptors we do not pass on, else fork.
+#if defined(__GLIBC__) &&                                                      \
+  (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+#define RT_SPAWN_CLOSEFROM 1
+#endif
+
+#if defined(RT_SPAWN_CLOSEFROM) || defined(POSIX_SPAWN_CLOEXEC_DEFAULT)
+#define RT_SPAWN 1
+#endif
+
+extern char** environ;
 
 namespace rpc {
 
@@ -25,10 +46,126 @@ const int ExecFile::flag_throw;
 const int ExecFile::flag_capture;
 const int ExecFile::flag_background;
 
+namespace {
+
+void
+close_from(int first) {
+#ifdef SYS_close_range
+  if (::syscall(SYS_close_range, first, ~0U, 0) == 0)
+    return;
+#endif
+
+  for (int i = first, last = sysconf(_SC_OPEN_MAX); i < last; i++)
+    ::close(i);
+}
+
+}
+
 // Close m_logFd.
 
-int
-ExecFile::execute(const char* file, char* const* argv, int flags) {
+pid_t
+ExecFile::spawn(const char* file, char* const* argv, int outFd) {
+#ifdef RT_SPAWN
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t          attr;
+
+  posix_spawn_file_actions_init(&actions);
+  posix_spawnattr_init(&attr);
+
+  posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDWR, 0);
+
+  if (outFd != -1)
+    posix_spawn_file_actions_adddup2(&actions, outFd, 1);
+  else if (m_logFd != -1)
+    posix_spawn_file_actions_adddup2(&actions, m_logFd, 1);
+  else
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+
+  if (m_logFd != -1)
+    posix_spawn_file_actions_adddup2(&actions, m_logFd, 2);
+  else
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+#ifdef RT_SPAWN_CLOSEFROM
+  posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+#else
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_CLOEXEC_DEFAULT);
+#endif
+
+  pid_t pid;
+  int   error = posix_spawnp(&pid, file, &actions, &attr, argv, environ);
+
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+
+  if (error != 0) {
+    errno = error;
+    return -1;
+  }
+
+  return pid;
+#else
+  pid_t pid = fork();
+
+  if (pid != 0)
+    return pid;
+
+  int devNull = open("/dev/null", O_RDWR);
+  if (devNull != -1)
+    dup2(devNull, 0);
+  else
+    ::close(0);
+
+  if (outFd != -1)
+    dup2(outFd, 1);
+  else if (m_logFd != -1)
+    dup2(m_logFd, 1);
+  else if (devNull != -1)
+    dup2(devNull, 1);
+  else
+    ::close(1);
+
+  if (m_logFd != -1)
+    dup2(m_logFd, 2);
+  else if (devNull != -1)
+    dup2(devNull, 2);
+  else
+    ::close(2);
+
+  close_from(3);
+
+  _exit(execvp(file, argv));
+#endif
+}
+
+pid_t
+ExecFile::spawn_detached(const char* file, char* const* argv) {
+  pid_t pid = fork();
+
+  if (pid != 0)
+    return pid;
+
+  pid_t detachedPid = fork();
+
+  if (detachedPid != 0)
+    _exit(detachedPid == -1 ? -1 : 0);
+
+  int devNull = open("/dev/null", O_RDWR);
+
+  for (int fd = 0; fd != 3; fd++) {
+    if (devNull != -1)
+      dup2(devNull, fd);
+    else
+      ::close(fd);
+  }
+
+  close_from(3);
+
+  _exit(execvp(file, argv));
+}
+
+void
+ExecFile::log_command(char* const* argv) {
   ssize_t __attribute__((unused)) result;
 
   // Write the execued command and its parameters to the log fd.
@@ -44,69 +181,51 @@ ExecFile::execute(const char* file, char* const* argv, int flags) {
 
     result = write(m_logFd, "\n---\n", sizeof("\n---\n"));
   }
+}
 
-  int pipeFd[2];
+void
+ExecFile::log_status(int status) {
+  ssize_t __attribute__((unused)) result;
 
-  if ((flags & flag_capture) && pipe(pipeFd))
-    throw torrent::input_error("ExecFile::execute(...) Pipe creation failed.");
+  // Check return value?
+  if (m_logFd != -1) {
+    if (status == 0)
+      result =
+        write(m_logFd, "\n--- Success ---\n", sizeof("\n--- Success ---\n"));
+    else
+      result = write(m_logFd, "\n--- Error ---\n", sizeof("\n--- Error ---\n"));
+  }
+}
 
-  pid_t childPid = fork();
+int
+ExecFile::execute(const char* file, char* const* argv, int flags) {
+  ssize_t __attribute__((unused)) result;
 
-  if (childPid == -1)
-    throw torrent::input_error("ExecFile::execute(...) Fork failed.");
+  log_command(argv);
 
-  if (childPid == 0) {
-    if (flags & flag_background) {
-      pid_t detached_pid = fork();
+  if (flags & flag_background)
+    return execute_background(file, argv);
 
-      if (detached_pid == -1)
-        _exit(-1);
+  int pipeFd[2];
 
-      if (detached_pid != 0) {
-        if (m_logFd != -1)
-          result = write(m_logFd,
-                         "\n--- Background task ---\n",
-                         sizeof("\n--- Background task ---\n"));
+  if ((flags & flag_capture) && pipe(pipeFd))
+    throw torrent::input_error("ExecFile::execute(...) Pipe creation failed.");
 
-        _exit(0);
-      }
+  pid_t childPid = spawn(file, argv, (flags & flag_capture) ? pipeFd[1] : -1);
 
-      m_logFd = -1;
-      flags &= ~flag_capture;
+  if (childPid == -1) {
+    if (flags & flag_capture) {
+      ::close(pipeFd[0]);
+      ::close(pipeFd[1]);
     }
 
-    int devNull = open("/dev/null", O_RDWR);
-    if (devNull != -1)
-      dup2(devNull, 0);
-    else
-      ::close(0);
-
-    if (flags & flag_capture)
-      dup2(pipeFd[1], 1);
-    else if (m_logFd != -1)
-      dup2(m_logFd, 1);
-    else if (devNull != -1)
-      dup2(devNull, 1);
-    else
-      ::close(1);
-
-    if (m_logFd != -1)
-      dup2(m_logFd, 2);
-    else if (devNull != -1)
-      dup2(devNull, 2);
-    else
-      ::close(2);
-
-    // Close all fd's.
-    for (int i = 3, last = sysconf(_SC_OPEN_MAX); i != last; i++)
-      ::close(i);
-
-    _exit(execvp(file, argv));
+    log_status(-1);
+    return -1;
   }
 
   // We yield the global lock when waiting for the executed command to
   // finish so that XMLRPC and other threads can continue working.
-  ThreadBase::release_global_lock();
+  utils::LockStats::yield();
 
   if (flags & flag_capture) {
     m_capture = std::string();
@@ -139,31 +258,54 @@ ExecFile::execute(const char* file, char* const* argv, int flags) {
   } while (wpid == -1 && torrent::utils::error_number::current().value() ==
                            std::errc::interrupted);
 
-  ThreadBase::acquire_global_lock();
+  utils::LockStats::resume("exec");
 
   if (wpid != childPid)
     throw torrent::internal_error("ExecFile::execute(...) waitpid failed.");
 
-  // Check return value?
-  if (m_logFd != -1) {
-    if (status == 0)
-      result =
-        write(m_logFd, "\n--- Success ---\n", sizeof("\n--- Success ---\n"));
-    else
-      result = write(m_logFd, "\n--- Error ---\n", sizeof("\n--- Error ---\n"));
+  log_status(status);
+  return status;
+}
+
+int
+ExecFile::execute_background(const char* file, char* const* argv) {
+  ssize_t __attribute__((unused)) result;
+
+  pid_t childPid = spawn_detached(file, argv);
+
+  if (childPid == -1) {
+    log_status(-1);
+    return -1;
   }
 
+  // Only the intermediate child is waited for, which exits at once.
+  int status;
+  int wpid;
+
+  do {
+    wpid = waitpid(childPid, &status, 0);
+  } while (wpid == -1 && torrent::utils::error_number::current().value() ==
+                           std::errc::interrupted);
+
+  if (wpid != childPid)
+    throw torrent::internal_error("ExecFile::execute(...) waitpid failed.");
+
+  if (m_logFd != -1)
+    result = write(m_logFd,
+                   "\n--- Background task ---\n",
+                   sizeof("\n--- Background task ---\n"));
+
+  log_status(status);
   return status;
 }
 
-torrent::Object
-ExecFile::execute_object(const torrent::Object& rawArgs, int flags) {
-  char*  argsBuffer[max_args];
-  char** argsCurrent = argsBuffer;
-
-  // Size of value strings are less than 24.
-  char  valueBuffer[buffer_size];
-  char* valueCurrent = valueBuffer;
+void
+ExecFile::build_args(const torrent::Object& rawArgs,
+                     int                    flags,
+                     char**                 argsBuffer,
+                     char*                  valueBuffer) {
+  char** argsCurrent  = argsBuffer;
+  char*  valueCurrent = valueBuffer;
 
   if (rawArgs.is_list()) {
     const torrent::Object::list_type& args = rawArgs.as_list();
@@ -209,6 +351,16 @@ ExecFile::execute_object(const torrent::Object& rawArgs, int flags) {
   }
 
   *argsCurrent = nullptr;
+}
+
+torrent::Object
+ExecFile::execute_object(const torrent::Object& rawArgs, int flags) {
+  char* argsBuffer[max_args];
+
+  // Size of value strings are less than 24.
+  char valueBuffer[buffer_size];
+
+  build_args(rawArgs, flags, argsBuffer, valueBuffer);
 
   int status = execute(argsBuffer[0], argsBuffer, flags);
 
@@ -221,4 +373,72 @@ ExecFile::execute_object(const torrent::Object& rawArgs, int flags) {
   return torrent::Object((int64_t)status);
 }
 
+torrent::Object
+ExecFile::execute_async(const torrent::Object& rawArgs, int flags) {
+  if (!rawArgs.is_list() || rawArgs.as_list().size() < 2)
+    throw torrent::input_error("Too few arguments.");
+
+  const torrent::Object::list_type& args = rawArgs.as_list();
+
+  if (!args.front().is_string())
+    throw torrent::input_error("The callback must be a command name.");
+
+  std::string callback = args.front().as_string();
+
+  if (!callback.empty() && commands.find(callback.c_str()) == commands.end())
+    throw torrent::input_error("Command \"" + callback + "\" does not exist.");
+
+  torrent::Object command = torrent::Object::create_list();
+  command.as_list().assign(std::next(args.begin()), args.end());
+
+  char* argsBuffer[max_args];
+  char  valueBuffer[buffer_size];
+
+  build_args(command, flags, argsBuffer, valueBuffer);
+  log_command(argsBuffer);
+
+  // The output goes to an unlinked file instead of a pipe, so that
+  // nothing has to drain it while the command runs.
+  std::FILE* output = nullptr;
+
+  if ((flags & flag_capture) && (output = std::tmpfile()) == nullptr)
+    throw torrent::input_error("Could not create a file for the output.");
+
+  pid_t pid = spawn(
+    argsBuffer[0], argsBuffer, output != nullptr ? fileno(output) : -1);
+
+  if (pid == -1) {
+    if (output != nullptr)
+      std::fclose(output);
+
+    log_status(-1);
+    throw torrent::input_error("Could not execute \"" +
+                               std::string(argsBuffer[0]) +
+                               "\": " + std::strerror(errno));
+  }
+
+  m_watcher.insert(
+    pid, output, [this, callback](int status, const std::string& captured) {
+      log_status(status);
+
+      if (callback.empty())
+        return;
+
+      torrent::Object result = torrent::Object::create_list();
+      result.as_list().push_back((int64_t)status);
+      result.as_list().push_back(captured);
+
+      try {
+        commands.call_command(callback.c_str(), result);
+      } catch (torrent::input_error& e) {
+        lt_log_print(torrent::LOG_WARN,
+                     "execute: callback '%s' failed: %s",
+                     callback.c_str(),
+                     e.what());
+      }
+    });
+
+  return (int64_t)pid;
+}
+
 }
@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <torrent/event.h>
+#include <torrent/exceptions.h>
+#include <torrent/poll.h>
+#include <torrent/utils/thread_base.h>
+
+#include "signal_handler.h"
+
+#include "rpc/exec_watcher.h"
+
+namespace rpc {
+
+namespace {
+
+std::string
+read_output(std::FILE* file) {
+  std::string output;
+  char        buffer[4096];
+  size_t      length;
+
+  std::rewind(file);
+
+  while ((length = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    output.append(buffer, length);
+
+  return output;
+}
+
+}
+
+class ExecWatcher::Child : public torrent::Event {
+public:
+  Child(ExecWatcher* parent, pid_t pid, std::FILE* output, slot_done slot)
+    : m_parent(parent)
+    , m_pid(pid)
+    , m_output(output)
+    , m_slot(std::move(slot)) {
+    m_fileDesc = -1;
+  }
+  ~Child() override {
+    if (m_output != nullptr)
+      std::fclose(m_output);
+  }
+
+  const char* type_name() const override {
+    return "exec";
+  }
+
+  pid_t pid() const {
+    return m_pid;
+  }
+  std::FILE* output() const {
+    return m_output;
+  }
+  slot_done& slot() {
+    return m_slot;
+  }
+
+  bool is_polled() const {
+    return m_fileDesc != -1;
+  }
+
+  void open(int pidFd) {
+    m_fileDesc = pidFd;
+
+    m_parent->poll()->open(this);
+    m_parent->poll()->insert_read(this);
+    m_parent->poll()->insert_error(this);
+  }
+
+  void close() {
+    if (m_fileDesc == -1)
+      return;
+
+    m_parent->poll()->remove_read(this);
+    m_parent->poll()->remove_error(this);
+    m_parent->poll()->close(this);
+
+    ::close(m_fileDesc);
+    m_fileDesc = -1;
+  }
+
+private:
+  void event_read() override {
+    m_parent->reap(this);
+  }
+  void event_write() override {}
+  void event_error() override {
+    m_parent->reap(this);
+  }
+
+  ExecWatcher* m_parent;
+  pid_t        m_pid;
+  std::FILE*   m_output;
+  slot_done    m_slot;
+};
+
+class ExecWatcher::Signal : public torrent::Event {
+public:
+  Signal(ExecWatcher* parent, int readFd, int writeFd)
+    : m_parent(parent)
+    , m_writeFd(writeFd) {
+    m_fileDesc = readFd;
+  }
+
+  const char* type_name() const override {
+    return "exec_signal";
+  }
+
+  void notify() {
+    ssize_t __attribute__((unused)) result = ::write(m_writeFd, "", 1);
+  }
+
+  void close() {
+    m_parent->poll()->remove_read(this);
+    m_parent->poll()->close(this);
+
+    ::close(m_fileDesc);
+    ::close(m_writeFd);
+    m_fileDesc = -1;
+    m_writeFd  = -1;
+  }
+
+private:
+  void event_read() override {
+    char buffer[64];
+
+    while (::read(m_fileDesc, buffer, sizeof(buffer)) > 0)
+      ;
+
+    m_parent->reap_signaled();
+  }
+  void event_write() override {}
+  void event_error() override {}
+
+  ExecWatcher* m_parent;
+  int          m_writeFd;
+};
+
+void
+ExecWatcher::insert(pid_t pid, std::FILE* output, slot_done slot) {
+  auto child = new Child(this, pid, output, std::move(slot));
+  m_children.push_back(child);
+
+  int pidFd = -1;
+
+#ifdef SYS_pidfd_open
+  pidFd = ::syscall(SYS_pidfd_open, pid, 0);
+#endif
+
+  if (pidFd != -1) {
+    child->open(pidFd);
+  } else {
+    watch_signal();
+
+    // The child may have exited before the handler was installed.
+    m_signal->notify();
+  }
+
+  // Commands also run in the RPC thread, so wake up the main thread to
+  // pick up the new descriptor.
+  if (m_poll == nullptr)
+    torrent::main_thread()->interrupt();
+}
+
+void
+ExecWatcher::cleanup() {
+  while (!m_children.empty())
+    erase(m_children.back());
+
+  if (m_signal != nullptr) {
+    SignalHandler::set_default(SIGCHLD);
+
+    m_signal->close();
+    delete m_signal;
+    m_signal = nullptr;
+  }
+}
+
+torrent::Poll*
+ExecWatcher::poll() {
+  return m_poll != nullptr ? m_poll : torrent::main_thread()->poll();
+}
+
+void
+ExecWatcher::watch_signal() {
+  if (m_signal != nullptr)
+    return;
+
+  int fds[2];
+
+  if (::pipe(fds) == -1)
+    throw torrent::input_error("ExecWatcher could not create a pipe.");
+
+  for (int fd : fds) {
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+  }
+
+  m_signal = new Signal(this, fds[0], fds[1]);
+
+  poll()->open(m_signal);
+  poll()->insert_read(m_signal);
+
+  SignalHandler::set_handler(SIGCHLD, [fd = fds[1]] {
+    int error = errno;
+
+    ssize_t __attribute__((unused)) result = ::write(fd, "", 1);
+
+    errno = error;
+  });
+}
+
+void
+ExecWatcher::reap(Child* child) {
+  int   status;
+  pid_t wpid;
+
+  do {
+    wpid = ::waitpid(child->pid(), &status, WNOHANG);
+  } while (wpid == -1 && errno == EINTR);
+
+  if (wpid == 0)
+    return;
+
+  // Someone else reaped it, so its status is lost.
+  if (wpid == -1)
+    status = -1;
+
+  std::string output;
+
+  if (child->output() != nullptr)
+    output = read_output(child->output());
+
+  slot_done slot = std::move(child->slot());
+
+  erase(child);
+
+  if (slot)
+    slot(status, output);
+}
+
+void
+ExecWatcher::reap_signaled() {
+  // The slots may start new children, so walk a copy.
+  std::vector<Child*> children = m_children;
+
+  for (auto child : children)
+    if (!child->is_polled())
+      reap(child);
+}
+
+void
+ExecWatcher::erase(Child* child) {
+  auto itr = std::find(m_children.begin(), m_children.end(), child);
+
+  if (itr == m_children.end())
+    throw torrent::internal_error("ExecWatcher::erase(...) child not found.");
+
+  m_children.erase(itr);
+
+  child->close();
+  delete child;
+}
+
+}
@@ -0,0 +1,339 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <algorithm>
+#include <vector>
+
+#include <torrent/chunk_manager.h>
+#include <torrent/connection_manager.h>
+#include <torrent/data/file_manager.h>
+#include <torrent/rate.h>
+#include <torrent/throttle.h>
+#include <torrent/torrent.h>
+
+#include "control.h"
+#include "core/curl_stack.h"
+#include "core/download.h"
+#include "core/download_list.h"
+#include "core/manager.h"
+#include "core/view.h"
+#include "core/view_manager.h"
+#include "globals.h"
+#include "rpc/parse_commands.h"
+
+#include "rpc/metrics.h"
+
+namespace rpc {
+
+Metrics::counters_type Metrics::m_counters[SCgiTask::CONTENT_TYPE_SIZE];
+
+namespace {
+
+const char* content_type_names[SCgiTask::CONTENT_TYPE_SIZE] = { "xml",
+                                                                "json",
+                                                                "metrics" };
+
+void
+append_gauge(std::string* out,
+             const char*  name,
+             const char*  help,
+             int64_t      value) {
+  Metrics::append_family(out, name, "gauge", help);
+  Metrics::append_sample(out, name, value);
+}
+
+void
+append_counter(std::string* out,
+               const char*  name,
+               const char*  help,
+               int64_t      value) {
+  Metrics::append_family(out, name, "counter", help);
+  Metrics::append_sample(out, name, value);
+}
+
+struct view_aggregate {
+  std::string label;
+
+  int64_t downloads{ 0 };
+  int64_t complete{ 0 };
+  int64_t active{ 0 };
+  int64_t peers{ 0 };
+  int64_t up_rate{ 0 };
+  int64_t down_rate{ 0 };
+};
+
+std::vector<view_aggregate>
+aggregate_views() {
+  std::vector<view_aggregate> result;
+  torrent::Object views = rpc::call_command("network.metrics.views");
+
+  for (const auto& name : views.as_list()) {
+    if (!name.is_string())
+      continue;
+
+    auto itr = control->view_manager()->find(name.as_string());
+
+    if (itr == control->view_manager()->end())
+      continue;
+
+    view_aggregate aggregate;
+    aggregate.label = Metrics::label("view", name.as_string());
+
+    std::for_each(
+      (*itr)->begin_visible(), (*itr)->end_visible(), [&](core::Download* d) {
+        aggregate.downloads++;
+        aggregate.complete += d->is_done();
+        aggregate.active += d->is_active();
+        aggregate.peers += d->connection_list_size();
+        aggregate.up_rate += d->info()->up_rate()->rate();
+        aggregate.down_rate += d->info()->down_rate()->rate();
+      });
+
+    result.push_back(std::move(aggregate));
+  }
+
+  return result;
+}
+
+void
+render_views(std::string* out) {
+  auto aggregates = aggregate_views();
+
+  if (aggregates.empty())
+    return;
+
+  const struct {
+    const char* name;
+    const char* help;
+    int64_t view_aggregate::*value;
+  } families[] = {
+    { "rtorrent_view_downloads",
+      "Downloads in the view.",
+      &view_aggregate::downloads },
+    { "rtorrent_view_downloads_complete",
+      "Complete downloads in the view.",
+      &view_aggregate::complete },
+    { "rtorrent_view_downloads_active",
+      "Active downloads in the view.",
+      &view_aggregate::active },
+    { "rtorrent_view_peers", "Peers of the view.", &view_aggregate::peers },
+    { "rtorrent_view_up_rate_bytes",
+      "Upload rate of the view in bytes per second.",
+      &view_aggregate::up_rate },
+    { "rtorrent_view_down_rate_bytes",
+      "Download rate of the view in bytes per second.",
+      &view_aggregate::down_rate },
+  };
+
+  for (const auto& family : families) {
+    Metrics::append_family(out, family.name, "gauge", family.help);
+
+    for (const auto& aggregate : aggregates)
+      Metrics::append_sample(
+        out, family.name, aggregate.*family.value, aggregate.label);
+  }
+}
+
+}
+
+void
+Metrics::count_request(SCgiTask::ContentType type,
+                       uint64_t              request_size,
+                       uint64_t              response_size,
+                       bool                  succeeded) {
+  counters_type& counters = m_counters[type];
+
+  counters.requests.fetch_add(1, std::memory_order_relaxed);
+  counters.request_bytes.fetch_add(request_size, std::memory_order_relaxed);
+  counters.response_bytes.fetch_add(response_size, std::memory_order_relaxed);
+
+  if (!succeeded)
+    counters.failed.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string
+Metrics::render() {
+  std::string out;
+  out.reserve(4096);
+
+  append_gauge(&out,
+               "rtorrent_up_rate_bytes",
+               "Upload rate in bytes per second.",
+               torrent::up_rate()->rate());
+  append_gauge(&out,
+               "rtorrent_down_rate_bytes",
+               "Download rate in bytes per second.",
+               torrent::down_rate()->rate());
+  append_counter(&out,
+                 "rtorrent_up_bytes_total",
+                 "Bytes uploaded.",
+                 torrent::up_rate()->total());
+  append_counter(&out,
+                 "rtorrent_down_bytes_total",
+                 "Bytes downloaded.",
+                 torrent::down_rate()->total());
+  append_gauge(&out,
+               "rtorrent_up_max_rate_bytes",
+               "Global upload throttle in bytes per second, 0 if unlimited.",
+               torrent::up_throttle_global()->max_rate());
+  append_gauge(&out,
+               "rtorrent_down_max_rate_bytes",
+               "Global download throttle in bytes per second, 0 if unlimited.",
+               torrent::down_throttle_global()->max_rate());
+
+  torrent::ConnectionManager* cm = torrent::connection_manager();
+
+  append_gauge(&out, "rtorrent_sockets_open", "Open sockets.", cm->size());
+  append_gauge(
+    &out, "rtorrent_sockets_max", "Maximum open sockets.", cm->max_size());
+  append_gauge(&out,
+               "rtorrent_handshakes",
+               "Peer handshakes in progress.",
+               torrent::total_handshakes());
+  append_gauge(&out,
+               "rtorrent_http_requests_open",
+               "Open HTTP requests.",
+               control->core()->http_stack()->active());
+
+  torrent::ChunkManager* chunkManager = torrent::chunk_manager();
+
+  append_gauge(&out,
+               "rtorrent_memory_chunks_bytes",
+               "Memory used by mapped pieces.",
+               chunkManager->memory_usage());
+  append_gauge(&out,
+               "rtorrent_memory_chunks_max_bytes",
+               "Limit on memory used by mapped pieces.",
+               chunkManager->max_memory_usage());
+  append_gauge(&out,
+               "rtorrent_memory_sync_queue_bytes",
+               "Memory of pieces waiting to be synced.",
+               chunkManager->sync_queue_memory_usage());
+  append_gauge(&out,
+               "rtorrent_memory_blocks",
+               "Mapped memory blocks.",
+               chunkManager->memory_block_count());
+
+  torrent::FileManager* fileManager = torrent::file_manager();
+
+  append_gauge(
+    &out, "rtorrent_files_open", "Open files.", fileManager->open_files());
+  append_gauge(&out,
+               "rtorrent_files_max",
+               "Maximum open files.",
+               fileManager->max_open_files());
+  append_counter(&out,
+                 "rtorrent_files_opened_total",
+                 "Files opened.",
+                 fileManager->files_opened_counter());
+  append_counter(&out,
+                 "rtorrent_files_closed_total",
+                 "Files closed.",
+                 fileManager->files_closed_counter());
+  append_counter(&out,
+                 "rtorrent_files_failed_total",
+                 "Files that failed to open.",
+                 fileManager->files_failed_counter());
+
+  append_gauge(&out,
+               "rtorrent_hash_queue_size",
+               "Pieces waiting to be hashed.",
+               torrent::hash_queue_size());
+  append_gauge(&out,
+               "rtorrent_downloads",
+               "Loaded downloads.",
+               control->core()->download_list()->size());
+
+  render_rpc(&out);
+  render_views(&out);
+
+  return out;
+}
+
+void
+Metrics::render_rpc(std::string* out) {
+  const struct {
+    const char* name;
+    const char* help;
+    std::atomic<uint64_t> counters_type::*value;
+  } families[] = {
+    { "rtorrent_rpc_requests_total",
+      "Requests on the SCGI listener.",
+      &counters_type::requests },
+    { "rtorrent_rpc_failed_total",
+      "Requests that could not be answered.",
+      &counters_type::failed },
+    { "rtorrent_rpc_request_bytes_total",
+      "Bytes of request bodies.",
+      &counters_type::request_bytes },
+    { "rtorrent_rpc_response_bytes_total",
+      "Bytes of response bodies.",
+      &counters_type::response_bytes },
+  };
+
+  for (const auto& family : families) {
+    append_family(out, family.name, "counter", family.help);
+
+    for (int type = 0; type < SCgiTask::CONTENT_TYPE_SIZE; type++)
+      append_sample(
+        out,
+        family.name,
+        (m_counters[type].*family.value).load(std::memory_order_relaxed),
+        label("type", content_type_names[type]));
+  }
+}
+
+void
+Metrics::append_family(std::string* out,
+                       const char*  name,
+                       const char*  type,
+                       const char*  help) {
+  *out += "# HELP ";
+  *out += name;
+  *out += ' ';
+  *out += help;
+  *out += "\n# TYPE ";
+  *out += name;
+  *out += ' ';
+  *out += type;
+  *out += '\n';
+}
+
+void
+Metrics::append_sample(std::string*       out,
+                       const char*        name,
+                       int64_t            value,
+                       const std::string& labels) {
+  *out += name;
+
+  if (!labels.empty()) {
+    *out += '{';
+    *out += labels;
+    *out += '}';
+  }
+
+  *out += ' ';
+  *out += std::to_string(value);
+  *out += '\n';
+}
+
+std::string
+Metrics::label(const char* key, const std::string& value) {
+  std::string result = key;
+  result += "=\"";
+
+  for (char c : value) {
+    if (c == '\\' || c == '"')
+      result += '\\';
+
+    if (c == '\n')
+      result += "\\n";
+    else
+      result += c;
+  }
+
+  result += '"';
+  return result;
+}
+
+}
@@ -22,8 +22,11 @@
 #include "rpc/command.h"
 #include "rpc/command_map.h"
 #include "rpc/parse_commands.h"
+#include "rpc/slow_log.h"
 #include "thread_base.h"
 #include "utils/jsonrpc/common.h"
+#include "utils/lock_stats.h"
+#include "utils/trace.h"
 
 using jsonrpccxx::JsonRpcException;
 using nlohmann::json;
@@ -239,34 +242,57 @@ jsonrpc_call_command(const std::string& method, const json& params) {
     throw JsonRpcException(-32601, "method not found: " + method);
   }
 
+  bool locked = !(itr->second.m_flags & CommandMap::flag_no_lock);
+
   try {
     torrent::Object  object;
     rpc::target_type target = rpc::make_target();
 
-    torrent::thread_base::acquire_global_lock();
-    torrent::main_thread()->interrupt();
-
-    if (itr->second.m_flags & CommandMap::flag_no_target) {
-      json_to_object(params, command_base::target_generic, &target)
-        .swap(object);
-    } else if (itr->second.m_flags & CommandMap::flag_file_target) {
-      json_to_object(params, command_base::target_file, &target).swap(object);
-    } else if (itr->second.m_flags & CommandMap::flag_tracker_target) {
-      json_to_object(params, command_base::target_tracker, &target)
-        .swap(object);
-    } else {
-      json_to_object(params, command_base::target_any, &target).swap(object);
+    if (locked) {
+      SlowLog::add_lock_wait(utils::LockStats::acquire(itr->first));
+      torrent::main_thread()->interrupt();
+    }
+
+    {
+      RT_TRACE_SPAN("rpc.params");
+
+      if (itr->second.m_flags & CommandMap::flag_no_target) {
+        json_to_object(params, command_base::target_generic, &target)
+          .swap(object);
+      } else if (itr->second.m_flags & CommandMap::flag_file_target) {
+        json_to_object(params, command_base::target_file, &target).swap(object);
+      } else if (itr->second.m_flags & CommandMap::flag_tracker_target) {
+        json_to_object(params, command_base::target_tracker, &target)
+          .swap(object);
+      } else {
+        json_to_object(params, command_base::target_any, &target).swap(object);
+      }
     }
 
+    auto        start  = SlowLog::clock_type::now();
     const auto& result = rpc::commands.call_command(itr, object, target);
+    auto        called = SlowLog::clock_type::now();
 
-    torrent::thread_base::release_global_lock();
-    return object_to_json(result);
+    if (locked)
+      utils::LockStats::release();
+
+    RT_TRACE_SPAN("rpc.serialize");
+    json value = object_to_json(result);
+
+    SlowLog::add_call(
+      itr->first,
+      std::get<0>(target) != command_base::target_generic,
+      SlowLog::usec_between(start, called),
+      SlowLog::usec_between(called, SlowLog::clock_type::now()));
+
+    return value;
   } catch (torrent::input_error& e) {
-    torrent::thread_base::release_global_lock();
+    if (locked)
+      utils::LockStats::release();
     throw JsonRpcException(-32602, e.what());
   } catch (torrent::local_error& e) {
-    torrent::thread_base::release_global_lock();
+    if (locked)
+      utils::LockStats::release();
     throw JsonRpcException(-32000, e.what());
   }
 }
@@ -288,8 +314,12 @@ RpcJson::is_valid() const {
 
 bool
 RpcJson::process(const char* inBuffer, uint32_t length, res_callback callback) {
-  const std::string& response =
-    m_jsonrpc->HandleRequest(std::string_view(inBuffer, length));
+  std::string response;
+
+  {
+    RT_TRACE_SPAN("json.process");
+    response = m_jsonrpc->HandleRequest(std::string_view(inBuffer, length));
+  }
 
   return callback(response.c_str(), response.size());
 }
@@ -25,6 +25,9 @@ static_assert(false, "XMLRPC is too old");
 #include "rpc/parse_commands.h"
 
 #include "rpc/command.h"
+#include "rpc/slow_log.h"
+#include "utils/lock_stats.h"
+#include "utils/trace.h"
 
 namespace rpc {
 
@@ -516,28 +519,46 @@ xmlrpc_call_command(xmlrpc_env* env, xmlrpc_value* args, void* voidServerInfo) {
     return nullptr;
   }
 
+  utils::LockStats::set_acquirer(itr->first);
+
   try {
     torrent::Object  object;
     rpc::target_type target = rpc::make_target();
 
-    if (itr->second.m_flags & CommandMap::flag_no_target)
-      xmlrpc_to_object(env, args, command_base::target_generic, &target)
-        .swap(object);
-    else if (itr->second.m_flags & CommandMap::flag_file_target)
-      xmlrpc_to_object(env, args, command_base::target_file, &target)
-        .swap(object);
-    else if (itr->second.m_flags & CommandMap::flag_tracker_target)
-      xmlrpc_to_object(env, args, command_base::target_tracker, &target)
-        .swap(object);
-    else
-      xmlrpc_to_object(env, args, command_base::target_any, &target)
-        .swap(object);
+    {
+      RT_TRACE_SPAN("rpc.params");
+
+      if (itr->second.m_flags & CommandMap::flag_no_target)
+        xmlrpc_to_object(env, args, command_base::target_generic, &target)
+          .swap(object);
+      else if (itr->second.m_flags & CommandMap::flag_file_target)
+        xmlrpc_to_object(env, args, command_base::target_file, &target)
+          .swap(object);
+      else if (itr->second.m_flags & CommandMap::flag_tracker_target)
+        xmlrpc_to_object(env, args, command_base::target_tracker, &target)
+          .swap(object);
+      else
+        xmlrpc_to_object(env, args, command_base::target_any, &target)
+          .swap(object);
+    }
 
     if (env->fault_occurred)
       return nullptr;
 
-    return object_to_xmlrpc(env,
-                            rpc::commands.call_command(itr, object, target));
+    auto        start  = SlowLog::clock_type::now();
+    const auto& result = rpc::commands.call_command(itr, object, target);
+    auto        called = SlowLog::clock_type::now();
+
+    RT_TRACE_SPAN("rpc.serialize");
+    xmlrpc_value* value = object_to_xmlrpc(env, result);
+
+    SlowLog::add_call(
+      itr->first,
+      std::get<0>(target) != command_base::target_generic,
+      SlowLog::usec_between(start, called),
+      SlowLog::usec_between(called, SlowLog::clock_type::now()));
+
+    return value;
 
   } catch (xmlrpc_error& e) {
     xmlrpc_env_set_fault(env, e.type(), e.what());
@@ -578,8 +599,13 @@ RpcXml::process(const char* inBuffer, uint32_t length, res_callback callback) {
   xmlrpc_env localEnv;
   xmlrpc_env_init(&localEnv);
 
-  xmlrpc_mem_block* memblock = xmlrpc_registry_process_call(
-    &localEnv, (xmlrpc_registry*)m_registry, nullptr, inBuffer, length);
+  xmlrpc_mem_block* memblock = nullptr;
+
+  {
+    RT_TRACE_SPAN("xml.process");
+    memblock = xmlrpc_registry_process_call(
+      &localEnv, (xmlrpc_registry*)m_registry, nullptr, inBuffer, length);
+  }
 
   if (localEnv.fault_occurred && localEnv.fault_code == XMLRPC_INTERNAL_ERROR)
     throw torrent::internal_error("Internal error in XMLRPC.");
@@ -13,7 +13,10 @@
 
 #include "control.h"
 #include "globals.h"
+#include "rpc/metrics.h"
 #include "rpc/parse_commands.h"
+#include "rpc/slow_log.h"
+#include "utils/lock_stats.h"
 #include "utils/socket_fd.h"
 
 #include "rpc/scgi.h"
@@ -81,6 +84,24 @@ SCgi::open_named(const std::string& filename) {
   m_path = filename;
 }
 
+void
+SCgi::open_inherited(int fd, const std::string& path) {
+  get_fd().set_fd(fd);
+
+  if (!get_fd().set_nonblock()) {
+    get_fd().close();
+    get_fd().clear();
+
+    throw torrent::resource_error(
+      "Could not prepare inherited socket for listening: " +
+      torrent::utils::error_number::current().message());
+  }
+
+  torrent::connection_manager()->inc_socket_count();
+
+  m_path = path;
+}
+
 void
 SCgi::open(void* sa, unsigned int length) {
   try {
@@ -149,24 +170,45 @@ SCgi::event_error() {
 
 bool
 SCgi::receive_call(SCgiTask* task, const char* buffer, uint32_t length) {
-  bool       result   = false;
-  const auto callback = [task](const char* buffer, uint32_t length) {
+  bool       result       = false;
+  uint32_t   responseSize = 0;
+  const auto callback     = [task, &responseSize](const char* buffer,
+                                                  uint32_t    length) {
+    SlowLog::set_response_size(responseSize = length);
     return task->receive_write(buffer, length);
   };
 
+  SlowLog::begin_request(length);
+
   switch (task->type()) {
     case SCgiTask::ContentType::JSON:
       result =
         rpc.dispatch(RpcManager::RPCType::JSON, buffer, length, callback);
       break;
+    case SCgiTask::ContentType::METRICS: {
+      SlowLog::add_lock_wait(utils::LockStats::acquire("metrics"));
+      torrent::main_thread()->interrupt();
+
+      auto        start   = SlowLog::clock_type::now();
+      std::string metrics = Metrics::render();
+      auto        end     = SlowLog::clock_type::now();
+
+      utils::LockStats::release();
+
+      SlowLog::add_call("metrics", false, SlowLog::usec_between(start, end), 0);
+      result = callback(metrics.data(), metrics.size());
+      break;
+    }
     case SCgiTask::ContentType::XML:
     default:
-      torrent::thread_base::acquire_global_lock();
+      SlowLog::add_lock_wait(utils::LockStats::acquire("rpc"));
       torrent::main_thread()->interrupt();
       result = rpc.dispatch(RpcManager::RPCType::XML, buffer, length, callback);
-      torrent::thread_base::release_global_lock();
+      utils::LockStats::release();
   }
 
+  SlowLog::end_request();
+  Metrics::count_request(task->type(), length, responseSize, result);
   return result;
 }
 
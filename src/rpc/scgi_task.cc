@@ -14,6 +14,8 @@
 #include "control.h"
 #include "globals.h"
 #include "utils/socket_fd.h"
+#include "utils/trace.h"
+#include "utils/usdt.h"
 
 #include "rpc/scgi.h"
 
@@ -25,6 +27,49 @@
 
 namespace rpc {
 
+namespace {
+
+// The header is a sequence of NUL terminated names and values.
+std::string_view
+header_value(std::string_view header, std::string_view name) {
+  std::string_view::size_type pos = 0;
+
+  while (pos < header.size()) {
+    const auto nameEnd = header.find('\0', pos);
+
+    if (nameEnd == std::string_view::npos)
+      break;
+
+    auto valueEnd = header.find('\0', nameEnd + 1);
+
+    if (valueEnd == std::string_view::npos)
+      valueEnd = header.size();
+
+    if (header.substr(pos, nameEnd - pos) == name)
+      return header.substr(nameEnd + 1, valueEnd - nameEnd - 1);
+
+    pos = valueEnd + 1;
+  }
+
+  return std::string_view();
+}
+
+bool
+is_metrics_request(std::string_view header) {
+  constexpr std::string_view path = "/metrics";
+
+  if (header_value(header, "REQUEST_METHOD") != "GET")
+    return false;
+
+  auto uri = header_value(header, "REQUEST_URI");
+  uri      = uri.substr(0, uri.find('?'));
+
+  return uri.size() >= path.size() &&
+         uri.substr(uri.size() - path.size()) == path;
+}
+
+}
+
 inline void
 SCgiTask::realloc_buffer(uint32_t    size,
                          const char* buffer,
@@ -80,6 +125,8 @@ SCgiTask::close() {
 
 void
 SCgiTask::event_read() {
+  RT_TRACE_SPAN("scgi.event_read");
+
   int bytes =
     ::recv(m_fileDesc, m_position, m_bufferSize - (m_position - m_buffer), 0);
 
@@ -129,12 +176,16 @@ SCgiTask::event_read() {
     contentSize =
       strtol(header.data() + contentLengthPos + 14 + 1, &contentPos, 0);
 
-    if (*contentPos != '\0' || contentSize <= 0)
+    // Only a GET for metrics comes without a body.
+    if (*contentPos != '\0' || contentSize < 0 ||
+        (contentSize == 0 && !is_metrics_request(header)))
       goto event_read_failed;
 
     // RFC 3875, 4.1.3
-    const auto contentTypePos = header.find("CONTENT_TYPE");
-    if (contentTypePos != std::string_view::npos) {
+    if (contentSize == 0) {
+      m_type = ContentType::METRICS;
+    } else if (const auto contentTypePos = header.find("CONTENT_TYPE");
+               contentTypePos != std::string_view::npos) {
       // length of "CONTENT_TYPE" -> 12
       const auto contentTypeStartPos = contentTypePos + 12 + 1;
       const auto contentTypeEndPos   = header.find('\0', contentTypeStartPos);
@@ -204,10 +255,19 @@ SCgiTask::event_read() {
                     "RPC read.",
                     0);
 
-  // Close if the call failed, else stay open to write back data.
-  if (!m_parent->receive_call(
-        this, m_body, m_bufferSize - std::distance(m_buffer, m_body)))
-    close();
+  {
+    RT_TRACE_REQUEST("scgi.request");
+
+    const uint32_t length = m_bufferSize - std::distance(m_buffer, m_body);
+
+    RT_PROBE3(rpc_request_start, this, (int)m_type, length);
+    const bool result = m_parent->receive_call(this, m_body, length);
+    RT_PROBE3(rpc_request_done, this, (int)m_type, result);
+
+    // Close if the call failed, else stay open to write back data.
+    if (!result)
+      close();
+  }
 
   return;
 
@@ -219,6 +279,8 @@ event_read_failed:
 
 void
 SCgiTask::event_write() {
+  RT_TRACE_SPAN("scgi.event_write");
+
   int bytes = ::send(m_fileDesc, m_position, m_bufferSize, 0);
 
   if (bytes == -1) {
@@ -253,11 +315,22 @@ SCgiTask::receive_write(const char* buffer, uint32_t length) {
     realloc_buffer(buffer_size);
   }
 
-  const auto header = m_type == ContentType::JSON
-                        ? "Status: 200 OK\r\nContent-Type: "
-                          "application/json\r\nContent-Length: %i\r\n\r\n"
-                        : "Status: 200 OK\r\nContent-Type: "
-                          "text/xml\r\nContent-Length: %i\r\n\r\n";
+  const char* header;
+
+  switch (m_type) {
+    case ContentType::JSON:
+      header = "Status: 200 OK\r\nContent-Type: "
+               "application/json\r\nContent-Length: %i\r\n\r\n";
+      break;
+    case ContentType::METRICS:
+      header = "Status: 200 OK\r\nContent-Type: text/plain; version=0.0.4; "
+               "charset=utf-8\r\nContent-Length: %i\r\n\r\n";
+      break;
+    case ContentType::XML:
+    default:
+      header = "Status: 200 OK\r\nContent-Type: "
+               "text/xml\r\nContent-Length: %i\r\n\r\n";
+  }
 
   // Who ever bothers to check the return value?
   int headerSize = snprintf(m_buffer, buffer_size, header, length);
@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <atomic>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+#include <torrent/exceptions.h>
+
+#include "rpc/slow_log.h"
+
+namespace rpc {
+
+namespace {
+
+using clock_type = SlowLog::clock_type;
+
+struct request_state {
+  bool                   active{ false };
+  clock_type::time_point start;
+  SlowLog::entry_type    entry;
+};
+
+thread_local request_state current_request;
+
+std::atomic<uint64_t> log_threshold{ 0 };
+std::atomic<uint32_t> log_max_size{ 64 };
+
+std::mutex              log_mutex;
+SlowLog::container_type log_entries;
+
+// Appends lines to the file until stopped, then writes what is left.
+struct writer_type {
+  std::mutex              mutex;
+  std::condition_variable condition;
+  std::deque<std::string> pending;
+  bool                    stop{ false };
+
+  int         fd{ -1 };
+  std::string path;
+  std::thread thread;
+
+  void run();
+};
+
+void
+writer_type::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    condition.wait(lock, [this] { return stop || !pending.empty(); });
+
+    std::deque<std::string> lines;
+    lines.swap(pending);
+
+    bool stopping = stop;
+
+    lock.unlock();
+
+    for (const auto& line : lines)
+      if (::write(fd, line.data(), line.size()) == -1)
+        break;
+
+    lock.lock();
+
+    if (stopping && pending.empty())
+      return;
+  }
+}
+
+// Never destroyed, so that a writer still running at exit is not
+// destroyed while joinable.
+writer_type* writer = new writer_type;
+
+void
+stop_writer() {
+  std::unique_lock<std::mutex> lock(writer->mutex);
+
+  if (writer->fd == -1)
+    return;
+
+  writer->stop = true;
+  lock.unlock();
+
+  writer->condition.notify_one();
+  writer->thread.join();
+
+  lock.lock();
+  ::close(writer->fd);
+
+  writer->fd   = -1;
+  writer->stop = false;
+  writer->path.clear();
+}
+
+void
+append_escaped(std::string* result, const std::string& str) {
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      *result += '\\';
+
+    if ((unsigned char)c >= 0x20)
+      *result += c;
+  }
+}
+
+}
+
+uint64_t
+SlowLog::threshold() {
+  return log_threshold.load(std::memory_order_relaxed);
+}
+
+void
+SlowLog::set_threshold(uint64_t usec) {
+  log_threshold.store(usec, std::memory_order_relaxed);
+}
+
+uint32_t
+SlowLog::max_size() {
+  return log_max_size.load(std::memory_order_relaxed);
+}
+
+void
+SlowLog::set_max_size(uint32_t size) {
+  log_max_size.store(size, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(log_mutex);
+
+  while (log_entries.size() > size)
+    log_entries.pop_front();
+}
+
+SlowLog::container_type
+SlowLog::entries() {
+  std::lock_guard<std::mutex> lock(log_mutex);
+  return log_entries;
+}
+
+void
+SlowLog::clear() {
+  std::lock_guard<std::mutex> lock(log_mutex);
+  log_entries.clear();
+}
+
+std::string
+SlowLog::file() {
+  std::lock_guard<std::mutex> lock(writer->mutex);
+  return writer->path;
+}
+
+void
+SlowLog::set_file(const std::string& path) {
+  stop_writer();
+
+  if (path.empty())
+    return;
+
+  int fd =
+    ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+
+  if (fd == -1)
+    throw torrent::input_error("Could not open slow request log: " + path);
+
+  std::lock_guard<std::mutex> lock(writer->mutex);
+
+  writer->fd     = fd;
+  writer->path   = path;
+  writer->thread = std::thread([] { writer->run(); });
+}
+
+void
+SlowLog::begin_request(uint64_t request_size) {
+  current_request.active = threshold() != 0;
+
+  if (!current_request.active)
+    return;
+
+  current_request.start              = clock_type::now();
+  current_request.entry              = entry_type();
+  current_request.entry.request_size = request_size;
+}
+
+void
+SlowLog::end_request() {
+  if (!current_request.active)
+    return;
+
+  current_request.active = false;
+
+  entry_type& entry = current_request.entry;
+  entry.total = usec_between(current_request.start, clock_type::now());
+
+  if (entry.total < threshold())
+    return;
+
+  entry.time = std::time(nullptr);
+
+  {
+    std::lock_guard<std::mutex> lock(writer->mutex);
+
+    if (writer->fd != -1) {
+      writer->pending.push_back(format(entry));
+      writer->condition.notify_one();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(log_mutex);
+
+  log_entries.push_back(std::move(entry));
+
+  while (log_entries.size() > max_size())
+    log_entries.pop_front();
+}
+
+void
+SlowLog::add_lock_wait(uint64_t usec) {
+  if (current_request.active)
+    current_request.entry.lock_wait += usec;
+}
+
+void
+SlowLog::add_call(const char* method,
+                  bool        has_target,
+                  uint64_t    execution,
+                  uint64_t    serialization) {
+  if (!current_request.active)
+    return;
+
+  entry_type& entry = current_request.entry;
+
+  if (entry.calls == 0)
+    entry.method = method;
+  else if (entry.method != method)
+    entry.method = "system.multicall";
+
+  entry.calls++;
+  entry.targets += has_target;
+  entry.execution += execution;
+  entry.serialization += serialization;
+}
+
+void
+SlowLog::set_response_size(uint64_t size) {
+  if (current_request.active)
+    current_request.entry.response_size = size;
+}
+
+std::string
+SlowLog::format(const entry_type& entry) {
+  std::string result = "{\"time\":" + std::to_string(entry.time) +
+                       ",\"method\":\"";
+  append_escaped(&result, entry.method);
+
+  char buffer[256];
+  std::snprintf(buffer,
+                sizeof(buffer),
+                "\",\"calls\":%" PRIu32 ",\"targets\":%" PRIu32
+                ",\"request_size\":%" PRIu64 ",\"response_size\":%" PRIu64
+                ",\"lock_wait\":%" PRIu64 ",\"execution\":%" PRIu64
+                ",\"serialization\":%" PRIu64 ",\"total\":%" PRIu64 "}\n",
+                entry.calls,
+                entry.targets,
+                entry.request_size,
+                entry.response_size,
+                entry.lock_wait,
+                entry.execution,
+                entry.serialization,
+                entry.total);
+
+  return result + buffer;
+}
+
+}
@@ -13,6 +13,7 @@
 
 #include "core/manager.h"
 #include "rpc/scgi.h"
+#include "utils/lock_stats.h"
 
 ThreadWorker::~ThreadWorker() {
   if (m_scgi) {
@@ -62,9 +63,9 @@ void
 ThreadWorker::msg_change_rpc_log(ThreadBase* baseThread) {
   ThreadWorker* thread = (ThreadWorker*)baseThread;
 
-  acquire_global_lock();
+  utils::LockStats::acquire("rpc_log");
   thread->change_rpc_log();
-  release_global_lock();
+  utils::LockStats::release();
 }
 
 void
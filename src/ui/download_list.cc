@@ -370,8 +370,8 @@ DownloadList::receive_exit_input(Input type) {
             control->core()->push_log_std("Temporary filter on '" +
                                           current_view()->name() +
                                           "' view: " + pattern);
-          current_view()->set_filter_temp(temp_filter);
-          current_view()->filter();
+          control->view_manager()->set_filter_temp(current_view()->name(),
+                                                   temp_filter);
         }
         break;
 
@@ -260,6 +260,7 @@ ElementFileList::receive_priority() {
   }
 
   m_download->download()->update_priorities();
+  m_download->set_session_dirty();
   update_itr();
 }
 
@@ -278,6 +279,7 @@ ElementFileList::receive_change_all() {
     (*itr)->set_priority(priority);
 
   m_download->download()->update_priorities();
+  m_download->set_session_dirty();
   update_itr();
 }
 
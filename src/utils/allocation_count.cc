@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include "buildinfo.h"
+
+#include <cstdlib>
+#include <new>
+
+#include "utils/allocation_count.h"
+
+#ifdef RT_USE_ALLOCATION_COUNT
+
+namespace {
+
+// Trivial so that it needs no initialization on first use, as
+// operator new may be called before or after anything else in a
+// thread.
+thread_local uint64_t thread_allocations = 0;
+
+}
+
+namespace utils {
+
+uint64_t
+allocation_count() {
+  return thread_allocations;
+}
+
+}
+
+// The array and aligned forms are left to the standard library, the
+// former calls the replaced operator new.
+
+void*
+operator new(std::size_t size) {
+  thread_allocations++;
+
+  while (true) {
+    if (void* ptr = std::malloc(size != 0 ? size : 1))
+      return ptr;
+
+    std::new_handler handler = std::get_new_handler();
+
+    if (handler == nullptr)
+      throw std::bad_alloc();
+
+    handler();
+  }
+}
+
+void*
+operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return operator new(size);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void
+operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+#else
+
+namespace utils {
+
+uint64_t
+allocation_count() {
+  return 0;
+}
+
+}
+
+#endif
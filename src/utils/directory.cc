@@ -2,9 +2,17 @@
 // Copyright (C) 2005-2011, Jari Sundell <jaris@ifi.uio.no>
 
 #include <algorithm>
+#include <cstring>
 #include <dirent.h>
+#include <fcntl.h>
 #include <functional>
+#include <memory>
 #include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include <torrent/exceptions.h>
 #include <torrent/utils/path.h>
@@ -73,4 +81,107 @@ Directory::update(int flags) {
   return true;
 }
 
+void
+DirectoryNames::clear() {
+  m_entries.clear();
+  m_names.clear();
+}
+
+void
+DirectoryNames::insert(const char* name, size_t length, uint8_t type) {
+  m_entries.push_back(entry_type{ static_cast<uint32_t>(m_names.size()),
+                                  static_cast<uint16_t>(length),
+                                  type });
+  m_names.insert(m_names.end(), name, name + length + 1);
+}
+
+bool
+DirectoryNames::update(const std::string& path,
+                       int                flags,
+                       const filter_type& filter) {
+  if (path.empty())
+    throw torrent::input_error(
+      "DirectoryNames::update() tried to open an empty path.");
+
+  auto accept = [flags, &filter](const char* name, size_t length) {
+    if ((flags & update_hide_dot) && name[0] == '.')
+      return false;
+
+    return !filter || filter(name, length);
+  };
+
+#ifdef __linux__
+  struct linux_dirent64 {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+  };
+
+  int fd = ::open(torrent::utils::path_expand(path).c_str(),
+                  O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  if (fd == -1)
+    return false;
+
+  std::unique_ptr<char[]> buffer(new char[buffer_size]);
+
+  while (true) {
+    long result = ::syscall(SYS_getdents64, fd, buffer.get(), buffer_size);
+
+    if (result == -1) {
+      ::close(fd);
+      return false;
+    }
+
+    if (result == 0)
+      break;
+
+    for (long offset = 0; offset < result;) {
+      auto entry = reinterpret_cast<linux_dirent64*>(buffer.get() + offset);
+      offset += entry->d_reclen;
+
+      size_t length = std::strlen(entry->d_name);
+
+      if (accept(entry->d_name, length))
+        insert(entry->d_name, length, entry->d_type);
+    }
+  }
+
+  ::close(fd);
+#else
+  DIR* d = opendir(torrent::utils::path_expand(path).c_str());
+
+  if (d == nullptr)
+    return false;
+
+  while (struct dirent* entry = readdir(d)) {
+    size_t length = std::strlen(entry->d_name);
+
+#ifdef __sun__
+    // No d_type, same as DT_UNKNOWN.
+    uint8_t type = 0;
+#else
+    uint8_t type = entry->d_type;
+#endif
+
+    if (accept(entry->d_name, length))
+      insert(entry->d_name, length, type);
+  }
+
+  closedir(d);
+#endif
+
+  if (flags & update_sort)
+    std::sort(m_entries.begin(),
+              m_entries.end(),
+              [this](const entry_type& left, const entry_type& right) {
+                return std::strcmp(m_names.data() + left.offset,
+                                   m_names.data() + right.offset) < 0;
+              });
+
+  return true;
+}
+
 }
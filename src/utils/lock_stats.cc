@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <algorithm>
+#include <chrono>
+
+#include <torrent/utils/thread_base.h>
+
+#include "utils/lock_stats.h"
+#include "utils/trace.h"
+
+namespace utils {
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct thread_state {
+  bool                   holding{ false };
+  clock_type::time_point hold_start;
+  std::string            acquirer;
+};
+
+thread_local thread_state current;
+
+uint64_t
+usec_between(clock_type::time_point start, clock_type::time_point end) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+    .count();
+}
+
+uint64_t
+usec_since(clock_type::time_point start) {
+  return usec_between(start, clock_type::now());
+}
+
+}
+
+std::atomic<bool>         LockStats::m_enabled{ true };
+LockStats::container_type LockStats::m_entries;
+
+LockStats::entry_type&
+LockStats::find_entry(const char* acquirer) {
+  auto itr = m_entries.find(acquirer);
+
+  if (itr == m_entries.end())
+    itr = m_entries.emplace(acquirer, entry_type()).first;
+
+  return itr->second;
+}
+
+unsigned int
+LockStats::bucket(uint64_t usec) {
+  unsigned int result = 0;
+
+  while (usec != 0 && result < histogram_size - 1) {
+    usec >>= 1;
+    result++;
+  }
+
+  return result;
+}
+
+void
+LockStats::record(histogram_type* histogram,
+                  uint64_t*       count,
+                  uint64_t*       total,
+                  uint64_t*       max,
+                  uint64_t        usec) {
+  (*histogram)[bucket(usec)]++;
+  (*count)++;
+  *total += usec;
+  *max = std::max(*max, usec);
+}
+
+uint64_t
+LockStats::acquire(const char* acquirer) {
+  RT_TRACE_SPAN("lock.wait");
+
+  auto start = clock_type::now();
+
+  torrent::thread_base::acquire_global_lock();
+
+  auto     now  = clock_type::now();
+  uint64_t wait = usec_between(start, now);
+
+  if (!is_enabled())
+    return wait;
+
+  current.hold_start = now;
+  current.holding    = true;
+  current.acquirer   = acquirer;
+
+  entry_type& entry = find_entry(acquirer);
+  record(&entry.wait_histogram,
+         &entry.wait_count,
+         &entry.wait_total,
+         &entry.wait_max,
+         wait);
+
+  return wait;
+}
+
+void
+LockStats::release() {
+  end_hold();
+  torrent::thread_base::release_global_lock();
+}
+
+void
+LockStats::set_acquirer(const char* acquirer) {
+  if (!current.holding || current.acquirer == acquirer)
+    return;
+
+  if (current.acquirer == "rpc")
+    current.acquirer = acquirer;
+  else
+    current.acquirer = "system.multicall";
+}
+
+void
+LockStats::yield() {
+  if (current.holding && is_enabled()) {
+    entry_type& entry = find_entry(current.acquirer.c_str());
+    record(&entry.hold_histogram,
+           &entry.hold_count,
+           &entry.hold_total,
+           &entry.hold_max,
+           usec_since(current.hold_start));
+  }
+
+  torrent::thread_base::release_global_lock();
+}
+
+void
+LockStats::resume(const char* waiter) {
+  RT_TRACE_SPAN("lock.wait");
+
+  auto start = clock_type::now();
+
+  torrent::thread_base::acquire_global_lock();
+
+  if (!is_enabled())
+    return;
+
+  auto now = clock_type::now();
+
+  entry_type& entry = find_entry(waiter);
+  record(&entry.wait_histogram,
+         &entry.wait_count,
+         &entry.wait_total,
+         &entry.wait_max,
+         usec_between(start, now));
+
+  current.hold_start = now;
+}
+
+void
+LockStats::begin_hold(const char* acquirer) {
+  current.hold_start = clock_type::now();
+  current.holding    = is_enabled();
+  current.acquirer   = acquirer;
+}
+
+void
+LockStats::end_hold() {
+  if (!current.holding)
+    return;
+
+  current.holding = false;
+
+  if (!is_enabled())
+    return;
+
+  entry_type& entry = find_entry(current.acquirer.c_str());
+  record(&entry.hold_histogram,
+         &entry.hold_count,
+         &entry.hold_total,
+         &entry.hold_max,
+         usec_since(current.hold_start));
+}
+
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "utils/mapped_file.h"
+
+namespace utils {
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+  : m_data(std::exchange(other.m_data, nullptr))
+  , m_size(std::exchange(other.m_size, 0)) {}
+
+MappedFile&
+MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    close();
+
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+  }
+
+  return *this;
+}
+
+bool
+MappedFile::open(const std::string& filename) {
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd == -1)
+    return false;
+
+  struct stat st;
+
+  if (::fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // The mapping stays valid after the descriptor is closed.
+  ::close(fd);
+
+  if (data == MAP_FAILED)
+    return false;
+
+  ::madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+  m_data = static_cast<const char*>(data);
+  m_size = st.st_size;
+
+  return true;
+}
+
+void
+MappedFile::close() {
+  if (m_data == nullptr)
+    return;
+
+  ::munmap(const_cast<char*>(m_data), m_size);
+
+  m_data = nullptr;
+  m_size = 0;
+}
+
+}
@@ -0,0 +1,306 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "utils/stats_segment.h"
+
+namespace utils {
+
+namespace {
+
+constexpr uint64_t initial_downloads = 64;
+
+StatsSegment::download_type*
+downloads_of(StatsSegment::header_type* header) {
+  return reinterpret_cast<StatsSegment::download_type*>(
+    reinterpret_cast<char*>(header) + sizeof(StatsSegment::header_type));
+}
+
+const StatsSegment::download_type*
+downloads_of(const StatsSegment::header_type* header) {
+  return reinterpret_cast<const StatsSegment::download_type*>(
+    reinterpret_cast<const char*>(header) + sizeof(StatsSegment::header_type));
+}
+
+uint64_t
+size_for(uint64_t downloads) {
+  return sizeof(StatsSegment::header_type) +
+         downloads * sizeof(StatsSegment::download_type);
+}
+
+// Whether 'path' is missing or a regular file starting with the segment
+// magic, such as one left behind by a previous process. Sets errno to
+// EEXIST for any other file.
+bool
+is_replaceable(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+
+  if (fd == -1)
+    return errno == ENOENT;
+
+  struct stat st;
+  uint32_t    value = 0;
+
+  bool result = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+                ::pread(fd, &value, sizeof(value), 0) == sizeof(value) &&
+                value == StatsSegment::magic;
+
+  ::close(fd);
+
+  if (!result)
+    errno = EEXIST;
+
+  return result;
+}
+
+}
+
+bool
+StatsSegment::open(const std::string& path) {
+  close();
+
+  if (!is_replaceable(path))
+    return false;
+
+  // The segment is set up in a temporary file that is renamed over the
+  // path, so readers never see a partial header, and those still
+  // mapping a previous segment keep it rather than have it truncated.
+  std::string tmp_path = path + ".XXXXXX";
+
+  m_fd = ::mkstemp(&tmp_path[0]);
+
+  if (m_fd == -1)
+    return false;
+
+  m_path = tmp_path;
+
+  const auto fail = [this]() {
+    int error = errno;
+
+    close();
+    errno = error;
+    return false;
+  };
+
+  if (::fcntl(m_fd, F_SETFD, FD_CLOEXEC) == -1 ||
+      !resize(size_for(initial_downloads)))
+    return fail();
+
+  m_header->magic         = magic;
+  m_header->version       = version;
+  m_header->header_size   = sizeof(header_type);
+  m_header->download_size = sizeof(download_type);
+  m_header->size          = m_size;
+  m_header->pid           = ::getpid();
+
+  if (::rename(tmp_path.c_str(), path.c_str()) == -1)
+    return fail();
+
+  m_path = path;
+  return true;
+}
+
+void
+StatsSegment::close() {
+  if (m_header != nullptr)
+    ::munmap(m_header, m_size);
+
+  if (m_fd != -1) {
+    struct stat current;
+    struct stat st;
+
+    // Another process may have replaced the file since.
+    if (::fstat(m_fd, &current) == 0 && ::stat(m_path.c_str(), &st) == 0 &&
+        st.st_dev == current.st_dev && st.st_ino == current.st_ino)
+      ::unlink(m_path.c_str());
+
+    ::close(m_fd);
+  }
+
+  m_fd     = -1;
+  m_header = nullptr;
+  m_size   = 0;
+  m_path.clear();
+}
+
+bool
+StatsSegment::resize(uint64_t size) {
+  if (::ftruncate(m_fd, size) == -1)
+    return false;
+
+  void* addr =
+    ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+
+  if (addr == MAP_FAILED)
+    return false;
+
+  if (m_header != nullptr)
+    ::munmap(m_header, m_size);
+
+  m_header = static_cast<header_type*>(addr);
+  m_size   = size;
+  return true;
+}
+
+bool
+StatsSegment::publish(uint64_t                          tick,
+                      const global_type&                global,
+                      const std::vector<download_type>& downloads) {
+  uint64_t required = size_for(downloads.size());
+
+  if (required > m_size && !resize(std::max(required, 2 * m_size)))
+    return false;
+
+  int64_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::system_clock::now().time_since_epoch())
+                  .count();
+
+  uint64_t sequence = m_header->sequence.load(std::memory_order_relaxed);
+
+  m_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  m_header->size           = m_size;
+  m_header->tick           = tick;
+  m_header->time           = time;
+  m_header->download_count = downloads.size();
+  m_header->global         = global;
+
+  std::memcpy(downloads_of(m_header),
+              downloads.data(),
+              downloads.size() * sizeof(download_type));
+
+  m_header->sequence.store(sequence + 2, std::memory_order_release);
+  return true;
+}
+
+void
+StatsSegment::set_name(download_type* download, const std::string& name) {
+  size_t length = std::min<size_t>(name.size(), name_size - 1);
+
+  std::memcpy(download->name, name.data(), length);
+  std::memset(download->name + length, 0, name_size - length);
+}
+
+bool
+StatsSegmentReader::open(const std::string& path) {
+  close();
+
+  const auto fail = [this](int error) {
+    close();
+    errno = error;
+    return false;
+  };
+
+  m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (m_fd == -1)
+    return false;
+
+  struct stat st;
+
+  if (::fstat(m_fd, &st) == -1)
+    return fail(errno);
+
+  if ((uint64_t)st.st_size < size_for(0))
+    return fail(EPROTO);
+
+  if (!remap(st.st_size))
+    return fail(errno);
+
+  if (m_header->magic != StatsSegment::magic ||
+      m_header->version != StatsSegment::version ||
+      m_header->header_size != sizeof(StatsSegment::header_type) ||
+      m_header->download_size != sizeof(StatsSegment::download_type))
+    return fail(EPROTO);
+
+  return true;
+}
+
+void
+StatsSegmentReader::close() {
+  if (m_header != nullptr)
+    ::munmap(const_cast<StatsSegment::header_type*>(m_header), m_size);
+
+  if (m_fd != -1)
+    ::close(m_fd);
+
+  m_fd     = -1;
+  m_header = nullptr;
+  m_size   = 0;
+}
+
+bool
+StatsSegmentReader::remap(uint64_t size) {
+  void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, 0);
+
+  if (addr == MAP_FAILED)
+    return false;
+
+  if (m_header != nullptr)
+    ::munmap(const_cast<StatsSegment::header_type*>(m_header), m_size);
+
+  m_header = static_cast<const StatsSegment::header_type*>(addr);
+  m_size   = size;
+  return true;
+}
+
+bool
+StatsSegmentReader::read(snapshot_type* dest, unsigned int attempts) {
+  for (unsigned int i = 0; i < attempts; i++) {
+    uint64_t sequence = m_header->sequence.load(std::memory_order_acquire);
+
+    if (sequence & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    uint64_t size  = m_header->size;
+    uint32_t count = m_header->download_count;
+
+    dest->tick   = m_header->tick;
+    dest->time   = m_header->time;
+    dest->pid    = m_header->pid;
+    dest->global = m_header->global;
+
+    // The values above may be torn, so only use them once the sequence
+    // shows they were not.
+    bool fits = size <= m_size && size_for(count) <= m_size;
+
+    if (fits) {
+      dest->downloads.resize(count);
+      std::memcpy(dest->downloads.data(),
+                  downloads_of(m_header),
+                  count * sizeof(StatsSegment::download_type));
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (m_header->sequence.load(std::memory_order_relaxed) != sequence)
+      continue;
+
+    if (!fits) {
+      if (!remap(size))
+        return false;
+
+      continue;
+    }
+
+    dest->sequence = sequence;
+    return true;
+  }
+
+  errno = EAGAIN;
+  return false;
+}
+
+}
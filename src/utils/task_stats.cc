@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include <torrent/utils/log.h>
+
+#include "utils/task_stats.h"
+
+namespace utils {
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct tick_state {
+  bool                   active{ false };
+  clock_type::time_point start;
+
+  // Key of the slowest task's entry, valid until the next reset.
+  const std::string* slowest{ nullptr };
+  uint64_t           slowest_time{ 0 };
+};
+
+tick_state current_tick;
+
+uint64_t
+usec_between(clock_type::time_point start, clock_type::time_point end) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+    .count();
+}
+
+const std::string&
+type_name(const std::type_info& info) {
+  static std::unordered_map<std::type_index, std::string> names;
+
+  auto itr = names.find(info);
+
+  if (itr != names.end())
+    return itr->second;
+
+  int   status    = 0;
+  char* demangled = abi::__cxa_demangle(info.name(), nullptr, nullptr, &status);
+
+  std::string name = status == 0 ? demangled : info.name();
+  std::free(demangled);
+
+  return names.emplace(info, std::move(name)).first->second;
+}
+
+}
+
+bool     TaskStats::m_enabled{ false };
+uint64_t TaskStats::m_slowTick{ 100000 };
+
+TaskStats::container_type TaskStats::m_entries;
+TaskStats::histogram_type TaskStats::m_tickHistogram{};
+uint64_t                  TaskStats::m_tickCount{ 0 };
+uint64_t                  TaskStats::m_slowTickCount{ 0 };
+unsigned int              TaskStats::m_resets{ 0 };
+
+std::map<const torrent::utils::priority_item*, std::string> TaskStats::m_names;
+
+void
+TaskStats::reset() {
+  m_entries.clear();
+  m_tickHistogram = histogram_type{};
+  m_tickCount     = 0;
+  m_slowTickCount = 0;
+  m_resets++;
+
+  current_tick.slowest      = nullptr;
+  current_tick.slowest_time = 0;
+}
+
+void
+TaskStats::set_name(const torrent::utils::priority_item* item,
+                    const std::string&                   name) {
+  m_names[item] = name;
+}
+
+void
+TaskStats::erase_name(const torrent::utils::priority_item* item) {
+  m_names.erase(item);
+}
+
+const std::string&
+TaskStats::task_name(torrent::utils::priority_item* item) {
+  auto itr = m_names.find(item);
+
+  if (itr != m_names.end())
+    return itr->second;
+
+  return type_name(item->slot().target_type());
+}
+
+void
+TaskStats::perform(torrent::utils::priority_queue_default* queue,
+                   torrent::utils::timer                   t) {
+  if (!m_enabled) {
+    torrent::utils::priority_queue_perform(queue, t);
+    return;
+  }
+
+  while (!queue->empty() && queue->top()->time() <= t) {
+    torrent::utils::priority_item* item = queue->top();
+    queue->pop();
+    item->clear_time();
+
+    // The item may be deleted by its own slot, so find its entry
+    // first.
+    const std::string& name = task_name(item);
+
+    auto entry = m_entries.find(name);
+
+    if (entry == m_entries.end())
+      entry = m_entries.emplace(name, entry_type()).first;
+
+    unsigned int resets = m_resets;
+    auto         start  = clock_type::now();
+
+    item->slot()();
+
+    uint64_t time = usec_between(start, clock_type::now());
+
+    // A task that reset the statistics must not touch the old entry.
+    if (resets != m_resets)
+      continue;
+
+    entry->second.count++;
+    entry->second.total += time;
+    entry->second.max = std::max(entry->second.max, time);
+
+    if (current_tick.active && time >= current_tick.slowest_time) {
+      current_tick.slowest      = &entry->first;
+      current_tick.slowest_time = time;
+    }
+  }
+}
+
+void
+TaskStats::begin_tick() {
+  current_tick.active       = m_enabled;
+  current_tick.slowest      = nullptr;
+  current_tick.slowest_time = 0;
+
+  if (current_tick.active)
+    current_tick.start = clock_type::now();
+}
+
+void
+TaskStats::end_tick() {
+  if (!current_tick.active)
+    return;
+
+  current_tick.active = false;
+
+  uint64_t time = usec_between(current_tick.start, clock_type::now());
+
+  m_tickHistogram[LockStats::bucket(time)]++;
+  m_tickCount++;
+
+  if (m_slowTick == 0 || time < m_slowTick)
+    return;
+
+  m_slowTickCount++;
+
+  if (current_tick.slowest == nullptr) {
+    lt_log_print(torrent::LOG_WARN,
+                 "Slow main loop tick: %" PRIu64 " us, no tasks were run.",
+                 time);
+    return;
+  }
+
+  lt_log_print(torrent::LOG_WARN,
+               "Slow main loop tick: %" PRIu64 " us, slowest task '%s' took "
+               "%" PRIu64 " us.",
+               time,
+               current_tick.slowest->c_str(),
+               current_tick.slowest_time);
+}
+
+std::string
+TaskStats::report() {
+  std::vector<container_type::const_iterator> sorted;
+
+  for (auto itr = m_entries.begin(); itr != m_entries.end(); itr++)
+    sorted.push_back(itr);
+
+  std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+    return a->second.total > b->second.total;
+  });
+
+  std::string result;
+  char        buffer[128];
+
+  std::snprintf(buffer,
+                sizeof(buffer),
+                "ticks %" PRIu64 ", slow ticks %" PRIu64 "\n",
+                m_tickCount,
+                m_slowTickCount);
+  result += buffer;
+
+  for (unsigned int i = 0; i < m_tickHistogram.size(); i++) {
+    if (m_tickHistogram[i] == 0)
+      continue;
+
+    std::snprintf(buffer,
+                  sizeof(buffer),
+                  "tick %s %" PRIu64 " us: %" PRIu64 "\n",
+                  i + 1 < m_tickHistogram.size() ? "<" : ">=",
+                  (uint64_t)1 << (i + 1 < m_tickHistogram.size() ? i : i - 1),
+                  m_tickHistogram[i]);
+    result += buffer;
+  }
+
+  result += "calls total_us max_us task\n";
+
+  for (const auto& itr : sorted) {
+    std::snprintf(buffer,
+                  sizeof(buffer),
+                  "%" PRIu64 " %" PRIu64 " %" PRIu64 " ",
+                  itr->second.count,
+                  itr->second.total,
+                  itr->second.max);
+    result += buffer;
+    result += itr->first;
+    result += '\n';
+  }
+
+  return result;
+}
+
+}
@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#include <torrent/exceptions.h>
+#include <torrent/utils/log.h>
+
+#include "utils/trace.h"
+
+namespace utils {
+
+namespace {
+
+struct event_type {
+  uint64_t start;
+  uint64_t duration;
+  char     name[Trace::name_size];
+};
+
+// Written by its thread and read when dumping, under its own mutex,
+// which is uncontended otherwise.
+struct ring_type {
+  std::mutex mutex;
+
+  long        tid;
+  std::string thread_name;
+
+  std::array<event_type, Trace::ring_size> events;
+  uint64_t                                 count{ 0 };
+};
+
+std::mutex                              rings_mutex;
+std::vector<std::shared_ptr<ring_type>> rings;
+
+std::mutex  directory_mutex;
+std::string trace_directory;
+
+ring_type*
+current_ring() {
+  thread_local std::shared_ptr<ring_type> ring;
+
+  if (ring != nullptr)
+    return ring.get();
+
+  ring      = std::make_shared<ring_type>();
+  ring->tid = ::syscall(SYS_gettid);
+
+  char name[16] = {};
+
+  if (::pthread_getname_np(::pthread_self(), name, sizeof(name)) == 0)
+    ring->thread_name = name;
+
+  std::lock_guard<std::mutex> lock(rings_mutex);
+  rings.push_back(ring);
+
+  return ring.get();
+}
+
+void
+append_escaped(std::string* result, const char* str) {
+  for (; *str != '\0'; str++) {
+    if (*str == '"' || *str == '\\')
+      *result += '\\';
+
+    if ((unsigned char)*str < 0x20)
+      continue;
+
+    *result += *str;
+  }
+}
+
+void
+append_ring(std::string* result, ring_type* ring, uint64_t since) {
+  std::lock_guard<std::mutex> lock(ring->mutex);
+
+  char buffer[160];
+  int  pid = ::getpid();
+
+  std::snprintf(buffer,
+                sizeof(buffer),
+                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                "\"tid\":%ld,\"args\":{\"name\":\"",
+                pid,
+                ring->tid);
+  *result += buffer;
+  append_escaped(result, ring->thread_name.c_str());
+  *result += "\"}},\n";
+
+  uint64_t first = ring->count > Trace::ring_size
+                     ? ring->count - Trace::ring_size
+                     : 0;
+
+  for (uint64_t i = first; i < ring->count; i++) {
+    const event_type& event = ring->events[i % Trace::ring_size];
+
+    if (event.start < since)
+      continue;
+
+    *result += "{\"name\":\"";
+    append_escaped(result, event.name);
+
+    std::snprintf(buffer,
+                  sizeof(buffer),
+                  "\",\"ph\":\"X\",\"ts\":%" PRIu64 ".%03u,\"dur\":%" PRIu64
+                  ".%03u,\"pid\":%d,\"tid\":%ld},\n",
+                  event.start / 1000,
+                  (unsigned int)(event.start % 1000),
+                  event.duration / 1000,
+                  (unsigned int)(event.duration % 1000),
+                  pid,
+                  ring->tid);
+    *result += buffer;
+  }
+}
+
+}
+
+std::atomic<bool>     Trace::m_enabled{ false };
+std::atomic<uint64_t> Trace::m_slowRequest{ 0 };
+
+std::string
+Trace::directory() {
+  std::lock_guard<std::mutex> lock(directory_mutex);
+  return trace_directory;
+}
+
+void
+Trace::set_directory(const std::string& path) {
+  std::lock_guard<std::mutex> lock(directory_mutex);
+  trace_directory = path;
+}
+
+uint64_t
+Trace::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+void
+Trace::record(const char* name, uint64_t start, uint64_t end) {
+  ring_type* ring = current_ring();
+
+  std::lock_guard<std::mutex> lock(ring->mutex);
+
+  event_type& event = ring->events[ring->count++ % ring_size];
+  event.start       = start;
+  event.duration    = end - start;
+
+  std::strncpy(event.name, name, name_size - 1);
+  event.name[name_size - 1] = '\0';
+}
+
+void
+Trace::record_request(const char* name, uint64_t start, uint64_t end) {
+  record(name, start, end);
+
+  uint64_t threshold = slow_request();
+
+  if (threshold == 0 || end - start < threshold * 1000)
+    return;
+
+  std::string path = directory();
+
+  if (path.empty())
+    return;
+
+  char filename[64];
+  std::snprintf(filename, sizeof(filename), "/trace-%" PRIu64 ".json", start);
+
+  try {
+    write(path + filename, start, true);
+  } catch (const torrent::input_error& e) {
+    lt_log_print(torrent::LOG_WARN, "Could not write trace: %s", e.what());
+  }
+}
+
+void
+Trace::clear() {
+  std::lock_guard<std::mutex> lock(rings_mutex);
+
+  for (const auto& ring : rings) {
+    std::lock_guard<std::mutex> ring_lock(ring->mutex);
+    ring->count = 0;
+  }
+}
+
+std::string
+Trace::json(uint64_t since, bool this_thread) {
+  std::string result = "{\"traceEvents\":[\n";
+
+  if (this_thread) {
+    append_ring(&result, current_ring(), since);
+  } else {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+
+    for (const auto& ring : rings)
+      append_ring(&result, ring.get(), since);
+  }
+
+  // Every event is followed by a comma and newline.
+  if (result.back() != '\n' || result[result.size() - 2] != ',')
+    result += "]";
+  else
+    result.replace(result.size() - 2, 2, "\n]");
+
+  result += ",\"displayTimeUnit\":\"ms\"}\n";
+
+  return result;
+}
+
+void
+Trace::write(const std::string& path, uint64_t since, bool this_thread) {
+  std::string content = json(since, this_thread);
+  std::FILE*  file    = std::fopen(path.c_str(), "w");
+
+  if (file == nullptr)
+    throw torrent::input_error("Could not open file: " + path);
+
+  bool failed = std::fwrite(content.data(), 1, content.size(), file) !=
+                content.size();
+
+  if (std::fclose(file) != 0 || failed)
+    throw torrent::input_error("Could not write file: " + path);
+}
+
+}
@@ -0,0 +1,101 @@
+#include "test/core/dormant_list_test.h"
+
+#include <cctype>
+
+#include <torrent/exceptions.h>
+
+torrent::Object
+DormantListTest::create_session(int64_t state) {
+  torrent::Object object = torrent::Object::create_map();
+
+  torrent::Object& info =
+    object.insert_key("info", torrent::Object::create_map());
+  info.insert_key("name", std::string("name"));
+  info.insert_key("length", int64_t(1234));
+
+  torrent::Object& rtorrent =
+    object.insert_key("rtorrent", torrent::Object::create_map());
+  rtorrent.insert_key("state", state);
+  rtorrent.insert_key("directory", std::string("/downloads/name"));
+  rtorrent.insert_key("chunks_done", int64_t(5));
+  rtorrent.insert_key("custom1", std::string("first"));
+  rtorrent.insert_key("custom5", std::string("fifth"));
+
+  torrent::Object& custom =
+    rtorrent.insert_key("custom", torrent::Object::create_map());
+  custom.insert_key("label", std::string("value"));
+
+  return object;
+}
+
+TEST_F(DormantListTest, test_hash_from_hex) {
+  std::string hex = "000102030405060708090a0b0c0d0e0f10111213";
+  std::string hash;
+
+  for (char c = 0; c < 20; c++)
+    hash.push_back(c);
+
+  ASSERT_EQ(core::DormantList::hash_from_hex(hex), hash);
+
+  for (auto& c : hex)
+    c = std::toupper(c);
+
+  ASSERT_EQ(core::DormantList::hash_from_hex(hex), hash);
+
+  ASSERT_EQ(core::DormantList::hash_from_hex(""), "");
+  ASSERT_EQ(core::DormantList::hash_from_hex(hex.substr(2)), "");
+  ASSERT_EQ(core::DormantList::hash_from_hex(hex + "00"), "");
+  ASSERT_EQ(core::DormantList::hash_from_hex("g" + hex.substr(1)), "");
+}
+
+TEST_F(DormantListTest, test_is_dormant) {
+  ASSERT_TRUE(core::DormantList::is_dormant(create_session(0)));
+  ASSERT_FALSE(core::DormantList::is_dormant(create_session(1)));
+  ASSERT_FALSE(core::DormantList::is_dormant(torrent::Object()));
+
+  torrent::Object hashing = create_session(0);
+  hashing.get_key("rtorrent").insert_key("hashing", int64_t(1));
+  ASSERT_FALSE(core::DormantList::is_dormant(hashing));
+
+  torrent::Object magnet = create_session(0);
+  magnet.insert_key("magnet-uri", std::string("magnet:?xt=urn:btih:"));
+  ASSERT_FALSE(core::DormantList::is_dormant(magnet));
+
+  torrent::Object no_state = create_session(0);
+  no_state.get_key("rtorrent").erase_key("state");
+  ASSERT_FALSE(core::DormantList::is_dormant(no_state));
+
+  torrent::Object no_info = create_session(0);
+  no_info.erase_key("info");
+  ASSERT_FALSE(core::DormantList::is_dormant(no_info));
+}
+
+TEST_F(DormantListTest, test_save_load) {
+  core::DormantList list;
+  std::string       hash_a(20, 'a');
+  std::string       hash_b(20, 'b');
+
+  list.insert(hash_a, "/session/a.torrent", create_session(0));
+  list.insert(hash_b, "", create_session(0));
+
+  core::DormantList loaded;
+  loaded.load_list(list.save_list());
+
+  ASSERT_EQ(loaded.hashes(), list.hashes());
+
+  const auto& entry = loaded.find_throw(hash_a);
+
+  ASSERT_EQ(entry.hash, hash_a);
+  ASSERT_EQ(entry.filename, "/session/a.torrent");
+  ASSERT_EQ(entry.name, "name");
+  ASSERT_EQ(entry.directory, "/downloads/name");
+  ASSERT_EQ(entry.size_bytes, 1234);
+  ASSERT_EQ(entry.chunks_done, 5);
+  ASSERT_EQ(entry.custom_n[0], "first");
+  ASSERT_EQ(entry.custom_n[1], "");
+  ASSERT_EQ(entry.custom_n[4], "fifth");
+  ASSERT_EQ(entry.custom.at("label"), "value");
+
+  ASSERT_EQ(loaded.find_throw(hash_b).filename, "");
+  ASSERT_THROW(loaded.find_throw(std::string(20, 'c')), torrent::input_error);
+}
@@ -0,0 +1,142 @@
+#include "test/core/download_columns_test.h"
+
+#include "rpc/parse.h"
+
+namespace {
+
+// state, complete, up.rate
+const int64_t test_rows[][3] = {
+  { 1, 0, 500 }, { 0, 1, 50 }, { 1, 1, 50 }, { 1, 0, 10 }, { 0, 0, 900 },
+};
+
+std::vector<uint8_t>
+make_mask(std::initializer_list<uint8_t> values) {
+  return std::vector<uint8_t>(values);
+}
+
+}
+
+void
+DownloadColumnsTest::SetUp() {
+  for (size_t i = 0; i < 5; i++) {
+    core::DownloadColumns::value_type
+      values[core::DownloadColumns::COLUMN_MAX_SIZE] = {};
+
+    values[core::DownloadColumns::COLUMN_STATE]    = test_rows[i][0];
+    values[core::DownloadColumns::COLUMN_COMPLETE] = test_rows[i][1];
+    values[core::DownloadColumns::COLUMN_UP_RATE]  = test_rows[i][2];
+
+    m_columns.push_back(download(i), values);
+  }
+}
+
+torrent::Object
+DownloadColumnsTest::parse(const std::string& str) {
+  torrent::Object result;
+  rpc::parse_object(str.c_str(), str.c_str() + str.size(), &result);
+
+  return result;
+}
+
+TEST_F(DownloadColumnsTest, test_column_index) {
+  ASSERT_EQ(core::DownloadColumns::column_index("d.up.rate"),
+            core::DownloadColumns::COLUMN_UP_RATE);
+  ASSERT_EQ(core::DownloadColumns::column_index("d.up.rate="),
+            core::DownloadColumns::COLUMN_UP_RATE);
+  ASSERT_EQ(core::DownloadColumns::column_index("d.up.rate=="), -1);
+  ASSERT_EQ(core::DownloadColumns::column_index("d.name"), -1);
+  ASSERT_EQ(core::DownloadColumns::column_index(""), -1);
+
+  ASSERT_EQ(m_columns.find(download(3)), 3u);
+  ASSERT_EQ(m_columns.find(nullptr), m_columns.size());
+}
+
+TEST_F(DownloadColumnsTest, test_filter) {
+  core::column_filter              plan;
+  core::DownloadColumns::mask_type mask;
+
+  ASSERT_TRUE(core::DownloadColumns::compile_filter(torrent::Object(), &plan));
+  m_columns.filter(plan, &mask);
+  ASSERT_EQ(mask, make_mask({ 1, 1, 1, 1, 1 }));
+
+  ASSERT_TRUE(core::DownloadColumns::compile_filter(
+    parse("((and,((d.state)),((greater,((d.up.rate)),((value,100))))))"),
+    &plan));
+  m_columns.filter(plan, &mask);
+  ASSERT_EQ(mask, make_mask({ 1, 0, 0, 0, 0 }));
+
+  ASSERT_TRUE(core::DownloadColumns::compile_filter(
+    parse("((not,((d.complete))))"), &plan));
+  m_columns.filter(plan, &mask);
+  ASSERT_EQ(mask, make_mask({ 1, 0, 0, 1, 1 }));
+
+  ASSERT_TRUE(core::DownloadColumns::compile_filter(
+    parse("((or,d.complete=,((equal,((d.up.rate)),((value,10))))))"),
+    &plan));
+  m_columns.filter(plan, &mask);
+  ASSERT_EQ(mask, make_mask({ 0, 1, 1, 1, 0 }));
+
+  ASSERT_TRUE(core::DownloadColumns::compile_filter(
+    parse("((less,((value,50)),((d.up.rate))))"), &plan));
+  m_columns.filter(plan, &mask);
+  ASSERT_EQ(mask, make_mask({ 1, 0, 0, 0, 1 }));
+}
+
+TEST_F(DownloadColumnsTest, test_filter_fallback) {
+  core::column_filter plan;
+
+  ASSERT_FALSE(
+    core::DownloadColumns::compile_filter(parse("((d.name))"), &plan));
+  ASSERT_FALSE(
+    core::DownloadColumns::compile_filter(parse("((d.up.rate,1))"), &plan));
+  ASSERT_FALSE(core::DownloadColumns::compile_filter(
+    parse("((and,((d.state)),((d.is_private))))"), &plan));
+  ASSERT_FALSE(core::DownloadColumns::compile_filter(
+    parse("((greater,((d.up.rate)),((value,1k))))"), &plan));
+}
+
+TEST_F(DownloadColumnsTest, test_sort) {
+  core::column_sort            plan;
+  std::vector<core::Download*> downloads;
+
+  for (size_t i = 5; i-- != 0;)
+    downloads.push_back(download(i));
+
+  // Equal keys keep their relative order.
+  ASSERT_TRUE(core::DownloadColumns::compile_sort(
+    parse("((greater,((d.up.rate))))"), &plan));
+  ASSERT_TRUE(m_columns.sort(plan, downloads.begin(), downloads.end()));
+  ASSERT_EQ(downloads,
+            std::vector<core::Download*>({ download(4),
+                                           download(0),
+                                           download(2),
+                                           download(1),
+                                           download(3) }));
+
+  // Equal keys are ordered by address.
+  ASSERT_TRUE(core::DownloadColumns::compile_sort(
+    parse("((compare,-+,d.complete=,d.up.rate=))"), &plan));
+  ASSERT_TRUE(m_columns.sort(plan, downloads.begin(), downloads.end()));
+  ASSERT_EQ(downloads,
+            std::vector<core::Download*>({ download(1),
+                                           download(2),
+                                           download(3),
+                                           download(0),
+                                           download(4) }));
+
+  downloads.push_back(nullptr);
+  ASSERT_FALSE(m_columns.sort(plan, downloads.begin(), downloads.end()));
+}
+
+TEST_F(DownloadColumnsTest, test_sort_fallback) {
+  core::column_sort plan;
+
+  ASSERT_FALSE(
+    core::DownloadColumns::compile_sort(parse("((less,((d.name))))"), &plan));
+  ASSERT_FALSE(core::DownloadColumns::compile_sort(
+    parse("((less,((d.up.rate)),((d.down.rate))))"), &plan));
+  ASSERT_FALSE(core::DownloadColumns::compile_sort(
+    parse("((compare,x,d.up.rate=))"), &plan));
+  ASSERT_FALSE(core::DownloadColumns::compile_sort(
+    parse("((compare,-,d.name=))"), &plan));
+}
@@ -0,0 +1,89 @@
+#include "test/core/event_queue_test.h"
+
+namespace {
+
+const char* opened = "event.download.opened";
+const char* closed = "event.download.closed";
+const char* paused = "event.download.paused";
+
+}
+
+TEST_F(EventQueueTest, test_order) {
+  ASSERT_TRUE(m_queue.push(download(0), opened));
+  ASSERT_TRUE(m_queue.push(download(1), opened));
+  ASSERT_TRUE(m_queue.push(download(0), paused));
+
+  auto events = m_queue.take();
+
+  ASSERT_TRUE(m_queue.empty());
+  ASSERT_EQ(events.size(), 3);
+  ASSERT_EQ(events[0], core::EventQueue::event_type(download(0), opened));
+  ASSERT_EQ(events[1], core::EventQueue::event_type(download(1), opened));
+  ASSERT_EQ(events[2], core::EventQueue::event_type(download(0), paused));
+}
+
+TEST_F(EventQueueTest, test_coalesce_last) {
+  ASSERT_TRUE(m_queue.push(download(0), opened));
+  ASSERT_TRUE(m_queue.push(download(0), closed));
+  ASSERT_FALSE(m_queue.push(download(0), opened));
+
+  auto events = m_queue.take();
+
+  ASSERT_EQ(events.size(), 2);
+  ASSERT_EQ(events[0].second, closed);
+  ASSERT_EQ(events[1].second, opened);
+
+  // Taking clears the coalescing state.
+  ASSERT_TRUE(m_queue.push(download(0), opened));
+}
+
+TEST_F(EventQueueTest, test_take_download) {
+  m_queue.push(download(0), opened);
+  m_queue.push(download(1), opened);
+  m_queue.push(download(0), closed);
+  m_queue.push(download(2), closed);
+
+  auto events = m_queue.take(download(0));
+
+  ASSERT_EQ(events.size(), 2);
+  ASSERT_EQ(events[0].second, opened);
+  ASSERT_EQ(events[1].second, closed);
+
+  ASSERT_EQ(m_queue.size(), 2);
+  ASSERT_TRUE(m_queue.push(download(0), opened));
+}
+
+TEST_F(EventQueueTest, test_erase) {
+  m_queue.push(download(0), opened);
+  m_queue.push(download(1), opened);
+  m_queue.erase(download(0));
+
+  ASSERT_TRUE(m_queue.push(download(0), opened));
+
+  auto events = m_queue.take();
+
+  ASSERT_EQ(events.size(), 2);
+  ASSERT_EQ(events[0].first, download(1));
+  ASSERT_EQ(events[1].first, download(0));
+}
+
+TEST_F(EventQueueTest, test_burst) {
+  // Enough repeats to compact the stale slots several times.
+  for (int i = 0; i < 1000; i++) {
+    m_queue.push(download(i % 3), opened);
+    m_queue.push(download(0), closed);
+  }
+
+  ASSERT_EQ(m_queue.size(), 4);
+
+  m_queue.push(download(1), opened);
+
+  auto events = m_queue.take();
+
+  ASSERT_EQ(events.size(), 4);
+  ASSERT_EQ(events[0], core::EventQueue::event_type(download(2), opened));
+  ASSERT_EQ(events[1], core::EventQueue::event_type(download(0), opened));
+  ASSERT_EQ(events[2], core::EventQueue::event_type(download(0), closed));
+  ASSERT_EQ(events[3], core::EventQueue::event_type(download(1), opened));
+  ASSERT_TRUE(m_queue.empty());
+}
@@ -0,0 +1,115 @@
+#include "test/core/handoff_test.h"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <torrent/download.h>
+
+#include "core/download_list.h"
+#include "core/session_file.h"
+
+void
+HandoffTest::TearDown() {
+  ::unsetenv(core::handoff_env);
+}
+
+int
+HandoffTest::pass_state(const std::string& data) {
+  char path[] = "/tmp/rtorrent_handoff_XXXXXX";
+  int  fd     = ::mkstemp(path);
+
+  ::unlink(path);
+
+  if (fd == -1 ||
+      ::write(fd, data.data(), data.size()) != (ssize_t)data.size() ||
+      ::lseek(fd, 0, SEEK_SET) != 0)
+    return -1;
+
+  ::setenv(core::handoff_env, std::to_string(fd).c_str(), 1);
+  return fd;
+}
+
+TEST_F(HandoffTest, test_no_state) {
+  torrent::Object state;
+
+  ::unsetenv(core::handoff_env);
+
+  ASSERT_FALSE(core::handoff_read(&state));
+  ASSERT_TRUE(state.is_empty());
+}
+
+TEST_F(HandoffTest, test_read_state) {
+  torrent::Object object = torrent::Object::create_map();
+
+  object.insert_key("listen_port", int64_t(6881));
+  object.insert_key("downloads", torrent::Object::create_list())
+    .insert_back(torrent::Object::create_map())
+    .insert_key("name", std::string("a"));
+
+  int fd = pass_state(core::session_file_string(object, 0));
+  ASSERT_NE(fd, -1);
+
+  torrent::Object state;
+
+  ASSERT_TRUE(core::handoff_read(&state));
+  ASSERT_EQ(std::getenv(core::handoff_env), nullptr);
+  ASSERT_EQ(::fcntl(fd, F_GETFD), -1);
+
+  ASSERT_EQ(state.get_key_value("listen_port"), 6881);
+  ASSERT_EQ(state.get_key_list("downloads").size(), 1u);
+  ASSERT_EQ(state.get_key_list("downloads").front().get_key_string("name"),
+            "a");
+}
+
+TEST_F(HandoffTest, test_read_corrupt_state) {
+  torrent::Object object = torrent::Object::create_map();
+  object.insert_key("listen_port", int64_t(6881));
+
+  std::string data = core::session_file_string(object, 0);
+  data[data.find("6881")] = '7';
+
+  ASSERT_NE(pass_state(data), -1);
+
+  torrent::Object state;
+
+  ASSERT_FALSE(core::handoff_read(&state));
+  ASSERT_TRUE(state.is_empty());
+}
+
+TEST_F(HandoffTest, test_arguments) {
+  char  relative[] = "bin/rtorrent";
+  char  absolute[] = "/usr/bin/rtorrent";
+  char  in_path[]  = "rtorrent";
+  char  option[]   = "-n";
+  char* argv[]     = { relative, option };
+
+  char cwd[4096];
+  ASSERT_NE(::getcwd(cwd, sizeof(cwd)), nullptr);
+
+  core::handoff_args args = core::handoff_arguments(2, argv);
+
+  ASSERT_EQ(args.size(), 2u);
+  ASSERT_EQ(args[0], std::string(cwd) + "/bin/rtorrent");
+  ASSERT_EQ(args[1], "-n");
+
+  argv[0] = absolute;
+  ASSERT_EQ(core::handoff_arguments(1, argv)[0], "/usr/bin/rtorrent");
+
+  argv[0] = in_path;
+  ASSERT_EQ(core::handoff_arguments(1, argv)[0], "rtorrent");
+}
+
+TEST_F(HandoffTest, test_handed_over_start_flags) {
+  const int handed_over = torrent::Download::start_no_create |
+                          torrent::Download::start_skip_tracker |
+                          torrent::Download::start_keep_baseline;
+
+  // Downloads passed on by a restart are still running as far as their
+  // trackers know, so they start without a 'started' announce.
+  ASSERT_EQ(core::DownloadList::start_flags(0, true), handed_over);
+  ASSERT_EQ(core::DownloadList::start_flags(0, false), 0);
+  ASSERT_EQ(core::DownloadList::start_flags(
+              torrent::Download::start_keep_baseline, false),
+            torrent::Download::start_keep_baseline);
+}
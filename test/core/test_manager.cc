@@ -0,0 +1,37 @@
+#include <torrent/exceptions.h>
+
+#include "test/core/manager_test.h"
+
+namespace {
+
+const int raw_data = core::Manager::create_raw_data;
+
+const char* torrent_data = "d8:announce0:e";
+const char* data_uri     = "data:application/x-bittorrent;base64,ZGU=";
+
+}
+
+TEST_F(ManagerTest, test_batch_flags) {
+  m_payloads.push_back(std::string(torrent_data));
+  m_payloads.push_back(std::string(data_uri));
+
+  auto flags = core::Manager::batch_flags(
+    m_payloads, core::Manager::create_start | raw_data);
+
+  ASSERT_EQ(flags.size(), 2);
+  ASSERT_EQ(flags[0], core::Manager::create_start | raw_data);
+  ASSERT_EQ(flags[1], core::Manager::create_start);
+}
+
+TEST_F(ManagerTest, test_batch_flags_empty) {
+  ASSERT_TRUE(core::Manager::batch_flags(m_payloads, 0).empty());
+}
+
+TEST_F(ManagerTest, test_batch_flags_not_string) {
+  m_payloads.push_back(std::string(torrent_data));
+  m_payloads.push_back((int64_t)1);
+  m_payloads.push_back(std::string(torrent_data));
+
+  ASSERT_THROW(core::Manager::batch_flags(m_payloads, 0),
+               torrent::input_error);
+}
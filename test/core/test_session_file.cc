@@ -0,0 +1,113 @@
+#include "test/core/session_file_test.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+void
+SessionFileTest::SetUp() {
+  char path[] = "/tmp/rtorrent_session_file_XXXXXX";
+
+  ASSERT_NE(::mkdtemp(path), nullptr);
+  m_dir = path;
+}
+
+void
+SessionFileTest::TearDown() {
+  ::unlink((m_dir + "/a").c_str());
+  ::rmdir(m_dir.c_str());
+}
+
+std::string
+SessionFileTest::read_file(const std::string& filename) {
+  std::ifstream      stream(filename);
+  std::ostringstream result;
+
+  result << stream.rdbuf();
+  return result.str();
+}
+
+void
+SessionFileTest::write_file(const std::string& filename,
+                            const std::string& data) {
+  std::ofstream stream(filename, std::ios::out | std::ios::trunc);
+  stream << data;
+}
+
+static torrent::Object
+create_object() {
+  torrent::Object object = torrent::Object::create_map();
+
+  object.insert_key("name", std::string(100000, 'a'));
+  object.insert_key("size", int64_t(1234));
+
+  return object;
+}
+
+TEST_F(SessionFileTest, test_round_trip) {
+  torrent::Object object = create_object();
+  std::string     filename(m_dir + "/a");
+
+  ASSERT_TRUE(core::session_file_write(filename, object, 0));
+  ASSERT_EQ(read_file(filename), core::session_file_string(object, 0));
+  ASSERT_EQ(::access((filename + ".new").c_str(), F_OK), -1);
+
+  torrent::Object result;
+
+  ASSERT_TRUE(core::session_file_read(filename, &result));
+  ASSERT_FALSE(result.has_key("~checksum"));
+  ASSERT_EQ(result.get_key_string("name"), std::string(100000, 'a'));
+  ASSERT_EQ(result.get_key_value("size"), 1234);
+}
+
+TEST_F(SessionFileTest, test_corrupted) {
+  std::string filename(m_dir + "/a");
+  std::string data = core::session_file_string(create_object(), 0);
+
+  // Change the 'size' value while keeping the file valid bencode.
+  data.replace(data.find("i1234e"), 6, "i4321e");
+  write_file(filename, data);
+
+  torrent::Object result;
+  ASSERT_FALSE(core::session_file_read(filename, &result));
+}
+
+TEST_F(SessionFileTest, test_no_checksum) {
+  std::string     filename(m_dir + "/a");
+  torrent::Object result;
+
+  write_file(filename, "d4:sizei1234ee");
+
+  ASSERT_TRUE(core::session_file_read(filename, &result));
+  ASSERT_EQ(result.get_key_value("size"), 1234);
+
+  write_file(filename, "d4:size");
+  ASSERT_FALSE(core::session_file_read(filename, &result));
+}
+
+TEST_F(SessionFileTest, test_stale_legacy_checksum) {
+  std::string     filename(m_dir + "/a");
+  torrent::Object result;
+
+  // A dictionary checksum left stale by a tool that rewrote the file.
+  write_file(filename, "d4:sizei4321e9:~checksumi1234ee");
+
+  ASSERT_TRUE(core::session_file_read(filename, &result));
+  ASSERT_FALSE(result.has_key("~checksum"));
+  ASSERT_EQ(result.get_key_value("size"), 4321);
+}
+
+TEST_F(SessionFileTest, test_bad_trailer) {
+  std::string filename(m_dir + "/a");
+  std::string data = core::session_file_string(create_object(), 0);
+
+  ASSERT_EQ(data.substr(data.size() - 16, 7), "~crc32:");
+  ASSERT_EQ(data.back(), '\n');
+
+  data[data.size() - 2] = data[data.size() - 2] == '0' ? '1' : '0';
+  write_file(filename, data);
+
+  torrent::Object result;
+  ASSERT_FALSE(core::session_file_read(filename, &result));
+}
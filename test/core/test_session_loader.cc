@@ -0,0 +1,51 @@
+#include "test/core/session_loader_test.h"
+
+static bool
+read_entry(size_t index, core::SessionLoader::part_list* parts) {
+  if (index % 7 == 3)
+    return false;
+
+  std::string value = "i" + std::to_string(index) + "e";
+
+  parts->push_back({ "", "torrent", "d5:index" + value + "e" });
+  parts->push_back({ "rtorrent", "rtorrent", "d5:index" + value + "e" });
+  parts->push_back({ "libtorrent_resume", "resume", "invalid" });
+
+  return true;
+}
+
+TEST_F(SessionLoaderTest, test_input_order) {
+  const size_t size = 1000;
+
+  for (unsigned int threads : { 1, 4 }) {
+    core::SessionLoader loader(size, &read_entry);
+    loader.start(threads);
+
+    ASSERT_EQ(loader.threads(), threads);
+
+    for (size_t index = 0; index < size; index++) {
+      core::SessionLoader::object_ptr object = loader.next();
+
+      if (index % 7 == 3) {
+        ASSERT_TRUE(object == nullptr);
+        continue;
+      }
+
+      ASSERT_TRUE(object != nullptr);
+      ASSERT_EQ(object->get_key_value("index"), (int64_t)index);
+      ASSERT_EQ(object->get_key("rtorrent").get_key_value("index"),
+                (int64_t)index);
+      ASSERT_FALSE(object->has_key("libtorrent_resume"));
+    }
+
+    ASSERT_TRUE(loader.next() == nullptr);
+  }
+}
+
+TEST_F(SessionLoaderTest, test_stop_early) {
+  core::SessionLoader loader(100000, &read_entry);
+  loader.start(4);
+
+  ASSERT_TRUE(loader.next() != nullptr);
+  loader.stop();
+}
@@ -0,0 +1,248 @@
+#include "test/core/session_pack_test.h"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <torrent/exceptions.h>
+
+void
+SessionPackTest::SetUp() {
+  char path[] = "/tmp/rtorrent_session_pack_XXXXXX";
+  int  fd     = ::mkstemp(path);
+
+  ASSERT_NE(fd, -1);
+  ::close(fd);
+
+  m_path = path;
+  ::unlink(m_path.c_str());
+
+  m_pack.open(m_path);
+}
+
+void
+SessionPackTest::TearDown() {
+  m_pack.close();
+
+  ::unlink(m_path.c_str());
+  ::unlink((m_path + ".new").c_str());
+}
+
+std::string
+SessionPackTest::get(char c, core::SessionPack::part_type part) {
+  std::string result;
+
+  if (!m_pack.get(hash(c), part, &result))
+    return "<missing>";
+
+  return result;
+}
+
+void
+SessionPackTest::reopen() {
+  m_pack.close();
+  m_pack.open(m_path);
+}
+
+TEST_F(SessionPackTest, test_put_get) {
+  m_pack.put(hash('a'), core::SessionPack::PART_TORRENT, "torrent a");
+  m_pack.put(hash('a'), core::SessionPack::PART_RESUME, "resume a");
+  m_pack.put(hash('b'), core::SessionPack::PART_TORRENT, "torrent b");
+
+  ASSERT_TRUE(m_pack.has_pending());
+  ASSERT_EQ(get('a', core::SessionPack::PART_TORRENT), "<missing>");
+
+  ASSERT_TRUE(m_pack.flush());
+  ASSERT_FALSE(m_pack.has_pending());
+
+  ASSERT_EQ(get('a', core::SessionPack::PART_TORRENT), "torrent a");
+  ASSERT_EQ(get('a', core::SessionPack::PART_RESUME), "resume a");
+  ASSERT_EQ(get('a', core::SessionPack::PART_RTORRENT), "<missing>");
+
+  m_pack.put(hash('a'), core::SessionPack::PART_RESUME, "resume a2");
+  ASSERT_TRUE(m_pack.flush());
+  reopen();
+
+  ASSERT_EQ(m_pack.size(), 2u);
+  ASSERT_EQ(m_pack.keys(),
+            core::SessionPack::key_list({ hash('a'), hash('b') }));
+  ASSERT_EQ(get('a', core::SessionPack::PART_RESUME), "resume a2");
+  ASSERT_EQ(get('b', core::SessionPack::PART_TORRENT), "torrent b");
+}
+
+TEST_F(SessionPackTest, test_remove) {
+  m_pack.put(hash('a'), core::SessionPack::PART_TORRENT, "torrent a");
+  m_pack.put(hash('b'), core::SessionPack::PART_TORRENT, "torrent b");
+  m_pack.remove(hash('a'));
+  ASSERT_TRUE(m_pack.flush());
+  reopen();
+
+  ASSERT_EQ(m_pack.keys(), core::SessionPack::key_list({ hash('b') }));
+  ASSERT_EQ(get('a', core::SessionPack::PART_TORRENT), "<missing>");
+}
+
+TEST_F(SessionPackTest, test_truncated_tail) {
+  m_pack.put(hash('a'), core::SessionPack::PART_TORRENT, "torrent a");
+  ASSERT_TRUE(m_pack.flush());
+
+  uint64_t size = m_pack.file_size();
+
+  m_pack.put(hash('b'), core::SessionPack::PART_TORRENT, "torrent b");
+  ASSERT_TRUE(m_pack.flush());
+  m_pack.close();
+
+  // Simulate a crash in the middle of the second flush.
+  ASSERT_EQ(::truncate(m_path.c_str(), size + 10), 0);
+  m_pack.open(m_path);
+
+  ASSERT_EQ(m_pack.file_size(), size);
+  ASSERT_EQ(m_pack.keys(), core::SessionPack::key_list({ hash('a') }));
+}
+
+TEST_F(SessionPackTest, test_bad_checksum) {
+  m_pack.put(hash('a'), core::SessionPack::PART_TORRENT, "torrent a");
+  ASSERT_TRUE(m_pack.flush());
+  m_pack.put(hash('a'), core::SessionPack::PART_TORRENT, "torrent b");
+  ASSERT_TRUE(m_pack.flush());
+
+  uint64_t size = m_pack.file_size();
+  m_pack.close();
+
+  // Flip the last byte of the payload of the second record.
+  int  fd = ::open(m_path.c_str(), O_RDWR);
+  char c  = 'x';
+
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(::pwrite(fd, &c, 1, size - 1), 1);
+  ::close(fd);
+
+  m_pack.open(m_path);
+
+  ASSERT_EQ(get('a', core::SessionPack::PART_TORRENT), "torrent a");
+}
+
+TEST_F(SessionPackTest, test_corrupt_header) {
+  m_pack.put(hash('a'), core::SessionPack::PART_TORRENT, "torrent a");
+  ASSERT_TRUE(m_pack.flush());
+
+  uint64_t offset = m_pack.file_size();
+
+  m_pack.put(hash('b'), core::SessionPack::PART_TORRENT, "torrent b");
+  ASSERT_TRUE(m_pack.flush());
+  m_pack.put(hash('c'), core::SessionPack::PART_TORRENT, "torrent c");
+  ASSERT_TRUE(m_pack.flush());
+
+  uint64_t size = m_pack.file_size();
+  m_pack.close();
+
+  // Break the magic of the middle record.
+  int  fd = ::open(m_path.c_str(), O_RDWR);
+  char c  = 'x';
+
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(::pwrite(fd, &c, 1, offset), 1);
+  ::close(fd);
+
+  m_pack.open(m_path);
+
+  ASSERT_EQ(m_pack.file_size(), size);
+  ASSERT_EQ(m_pack.keys(),
+            core::SessionPack::key_list({ hash('a'), hash('c') }));
+  ASSERT_EQ(get('c', core::SessionPack::PART_TORRENT), "torrent c");
+}
+
+TEST_F(SessionPackTest, test_corrupt_large_record) {
+  m_pack.put(hash('a'), core::SessionPack::PART_TORRENT, "torrent a");
+  ASSERT_TRUE(m_pack.flush());
+
+  uint64_t offset = m_pack.file_size();
+
+  // A 33 byte header plus this payload places the magic of the following
+  // record across the first 64 KiB boundary of the resync scan.
+  m_pack.put(
+    hash('b'), core::SessionPack::PART_TORRENT, std::string(65502, 'b'));
+  ASSERT_TRUE(m_pack.flush());
+  ASSERT_EQ(m_pack.file_size(), offset + 65535);
+
+  m_pack.put(hash('c'), core::SessionPack::PART_TORRENT, "torrent c");
+  ASSERT_TRUE(m_pack.flush());
+  m_pack.close();
+
+  int  fd = ::open(m_path.c_str(), O_RDWR);
+  char c  = 'x';
+
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(::pwrite(fd, &c, 1, offset), 1);
+  ::close(fd);
+
+  m_pack.open(m_path);
+
+  ASSERT_EQ(m_pack.keys(),
+            core::SessionPack::key_list({ hash('a'), hash('c') }));
+  ASSERT_EQ(get('c', core::SessionPack::PART_TORRENT), "torrent c");
+}
+
+TEST_F(SessionPackTest, test_corrupt_tail) {
+  m_pack.put(hash('a'), core::SessionPack::PART_TORRENT, "torrent a");
+  ASSERT_TRUE(m_pack.flush());
+
+  uint64_t size = m_pack.file_size();
+  m_pack.close();
+
+  int fd = ::open(m_path.c_str(), O_RDWR);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(::pwrite(fd, "garbage garbage garbage garbage garbage", 39, size),
+            39);
+  ::close(fd);
+
+  // Garbage that is not an incomplete record is left alone, and records
+  // appended after it are found again.
+  m_pack.open(m_path);
+  ASSERT_EQ(m_pack.file_size(), size + 39);
+
+  m_pack.put(hash('b'), core::SessionPack::PART_TORRENT, "torrent b");
+  ASSERT_TRUE(m_pack.flush());
+
+  reopen();
+
+  ASSERT_EQ(m_pack.keys(),
+            core::SessionPack::key_list({ hash('a'), hash('b') }));
+  ASSERT_EQ(get('b', core::SessionPack::PART_TORRENT), "torrent b");
+}
+
+TEST_F(SessionPackTest, test_compact) {
+  for (int i = 0; i < 10; i++) {
+    m_pack.put(hash('a'),
+               core::SessionPack::PART_RESUME,
+               "resume a" + std::to_string(i));
+    ASSERT_TRUE(m_pack.flush());
+  }
+
+  m_pack.put(hash('b'), core::SessionPack::PART_TORRENT, "torrent b");
+  m_pack.put(hash('a'), core::SessionPack::PART_TORRENT, "torrent a");
+  ASSERT_TRUE(m_pack.flush());
+
+  uint64_t size = m_pack.file_size();
+
+  ASSERT_TRUE(m_pack.compact());
+  ASSERT_LT(m_pack.file_size(), size);
+  ASSERT_EQ(m_pack.file_size(), m_pack.live_size() + 8);
+
+  reopen();
+
+  ASSERT_EQ(m_pack.keys(),
+            core::SessionPack::key_list({ hash('b'), hash('a') }));
+  ASSERT_EQ(get('a', core::SessionPack::PART_RESUME), "resume a9");
+  ASSERT_EQ(get('a', core::SessionPack::PART_TORRENT), "torrent a");
+}
+
+TEST_F(SessionPackTest, test_not_a_pack) {
+  m_pack.close();
+
+  int fd = ::open(m_path.c_str(), O_WRONLY | O_TRUNC);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(::write(fd, "d4:infoe", 8), 8);
+  ::close(fd);
+
+  ASSERT_THROW(m_pack.open(m_path), torrent::storage_error);
+}
@@ -0,0 +1,82 @@
+#include "test/core/session_writer_test.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+void
+SessionWriterTest::SetUp() {
+  char path[] = "/tmp/rtorrent_session_writer_XXXXXX";
+
+  ASSERT_NE(::mkdtemp(path), nullptr);
+  m_dir = path;
+
+  m_writer.start();
+}
+
+void
+SessionWriterTest::TearDown() {
+  m_writer.stop();
+
+  ::unlink((m_dir + "/a").c_str());
+  ::unlink((m_dir + "/b").c_str());
+  ::rmdir(m_dir.c_str());
+}
+
+std::string
+SessionWriterTest::read_file(const std::string& filename) {
+  std::ifstream      stream(filename);
+  std::ostringstream result;
+
+  if (!stream.is_open())
+    return "<missing>";
+
+  result << stream.rdbuf();
+  return result.str();
+}
+
+TEST_F(SessionWriterTest, test_write_in_order) {
+  for (int i = 0; i < 10; i++) {
+    core::SessionWriter::job_type job;
+
+    job.hash = "a";
+    job.files.push_back({ m_dir + "/a", "a" + std::to_string(i) });
+    job.files.push_back({ m_dir + "/b", "b" + std::to_string(i) });
+    m_writer.push(std::move(job));
+  }
+
+  core::SessionWriter::job_type job;
+  job.unlinks.push_back(m_dir + "/b");
+  m_writer.push(std::move(job));
+
+  m_writer.stop();
+  ASSERT_EQ(m_writer.pending(), 0u);
+
+  core::SessionWriter::result_list results;
+  m_writer.collect(&results);
+
+  ASSERT_EQ(results.size(), 11u);
+  ASSERT_TRUE(results.front().success);
+  ASSERT_EQ(results.front().hash, "a");
+
+  ASSERT_EQ(read_file(m_dir + "/a"), "a9");
+  ASSERT_EQ(read_file(m_dir + "/b"), "<missing>");
+  ASSERT_EQ(read_file(m_dir + "/a.new"), "<missing>");
+}
+
+TEST_F(SessionWriterTest, test_write_failed) {
+  core::SessionWriter::job_type job;
+
+  job.hash = "c";
+  job.files.push_back({ m_dir + "/missing/c", "c" });
+  m_writer.push(std::move(job));
+  m_writer.stop();
+
+  core::SessionWriter::result_list results;
+  m_writer.collect(&results);
+
+  ASSERT_EQ(results.size(), 1u);
+  ASSERT_EQ(results.front().hash, "c");
+  ASSERT_FALSE(results.front().success);
+}
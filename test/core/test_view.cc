@@ -0,0 +1,50 @@
+#include "test/core/view_test.h"
+
+TEST_F(ViewTest, test_filter_name_substring) {
+  std::string substring;
+
+  ASSERT_TRUE(core::View::filter_name_substring(name_filter("Ubuntu 20"),
+                                                &substring));
+  ASSERT_EQ(substring, "ubuntu 20");
+
+  ASSERT_TRUE(core::View::filter_name_substring(name_filter(""), &substring));
+  ASSERT_EQ(substring, "");
+
+  // Regular expressions, other commands and non-strings are not
+  // plain substrings.
+  ASSERT_FALSE(
+    core::View::filter_name_substring(name_filter("a.b"), &substring));
+  ASSERT_FALSE(
+    core::View::filter_name_substring(name_filter("a|b"), &substring));
+  ASSERT_FALSE(core::View::filter_name_substring(
+    std::string("match={d.name=,ubuntu}"), &substring));
+  ASSERT_FALSE(core::View::filter_name_substring(
+    std::string("d.is_open="), &substring));
+  ASSERT_FALSE(
+    core::View::filter_name_substring(torrent::Object((int64_t)1), &substring));
+}
+
+TEST_F(ViewTest, test_refinement_without_temp_filter) {
+  // The visible rows may be stale, so the first temporary filter must
+  // rescan every download.
+  ASSERT_FALSE(m_view.is_filter_temp_refinement(name_filter("ubuntu")));
+}
+
+TEST_F(ViewTest, test_refinement_extends_name) {
+  m_view.set_filter_temp(name_filter("ubu"));
+
+  ASSERT_TRUE(m_view.is_filter_temp_refinement(name_filter("ubuntu")));
+  ASSERT_TRUE(m_view.is_filter_temp_refinement(name_filter("UBUNTU")));
+  ASSERT_TRUE(m_view.is_filter_temp_refinement(name_filter("ubu")));
+
+  ASSERT_FALSE(m_view.is_filter_temp_refinement(name_filter("ub")));
+  ASSERT_FALSE(m_view.is_filter_temp_refinement(name_filter("debian")));
+  ASSERT_FALSE(
+    m_view.is_filter_temp_refinement(std::string("d.is_open=")));
+}
+
+TEST_F(ViewTest, test_refinement_after_other_filter) {
+  m_view.set_filter_temp(std::string("d.is_open="));
+
+  ASSERT_FALSE(m_view.is_filter_temp_refinement(name_filter("ubuntu")));
+}
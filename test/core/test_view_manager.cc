@@ -0,0 +1,70 @@
+#include <torrent/exceptions.h>
+
+#include "control.h"
+#include "globals.h"
+#include "test/core/view_manager_test.h"
+
+void
+ViewManagerTest::SetUp() {
+  // Views take their initial downloads from the client's list.
+  if (control == nullptr) {
+    setlocale(LC_ALL, "");
+    cachedTime = torrent::utils::timer::current();
+    control    = new Control;
+  }
+}
+
+TEST_F(ViewManagerTest, test_index) {
+  for (const char* name : { "first", "second", "third" })
+    m_views.insert(name);
+
+  ASSERT_EQ(m_views.size(), 3);
+
+  for (const char* name : { "first", "second", "third" }) {
+    auto itr = m_views.find(name);
+
+    ASSERT_NE(itr, m_views.end());
+    ASSERT_EQ((*itr)->name(), name);
+  }
+
+  ASSERT_EQ(m_views.find("fourth"), m_views.end());
+  ASSERT_THROW(m_views.find_throw("fourth"), torrent::input_error);
+  ASSERT_THROW(m_views.insert("second"), torrent::input_error);
+  ASSERT_THROW(m_views.insert(""), torrent::input_error);
+}
+
+TEST_F(ViewManagerTest, test_index_clear) {
+  m_views.insert("first");
+  m_views.insert("second");
+  m_views.clear();
+
+  ASSERT_EQ(m_views.find("first"), m_views.end());
+
+  // The positions are handed out again from the start.
+  core::View* view = *m_views.insert("second");
+
+  ASSERT_EQ(m_views.find_ptr_throw("second"), view);
+  ASSERT_EQ(m_views.find("first"), m_views.end());
+}
+
+TEST_F(ViewManagerTest, test_stats) {
+  core::View* view = *m_views.insert("stats");
+
+  ASSERT_EQ(view->stats().filter_count, 0u);
+  ASSERT_EQ(view->stats().sort_count, 0u);
+
+  // Without a sort command the view is left alone.
+  m_views.sort("stats");
+
+  ASSERT_EQ(view->stats().filter_count, 1u);
+  ASSERT_EQ(view->stats().sort_count, 0u);
+
+  view->set_sort_current(std::string("d.name="));
+  m_views.sort("stats");
+  view->filter();
+
+  ASSERT_EQ(view->stats().filter_count, 3u);
+  ASSERT_EQ(view->stats().sort_count, 1u);
+  ASSERT_GE(view->stats().filter_time, view->stats().filter_last);
+  ASSERT_GE(view->stats().sort_time, view->stats().sort_last);
+}
@@ -1,3 +1,8 @@
+#include "buildinfo.h"
+
+#include <torrent/exceptions.h>
+#include <vector>
+
 #include "test/rpc/command_map_test.h"
 #include "command_helpers.h"
 #include "rpc/command_map.h"
@@ -40,3 +45,65 @@ TEST_F(CommandMapTest, test_basics) {
   ASSERT_TRUE(m_map.call_command("test_b", (int64_t)1).as_value() == 2);
   ASSERT_TRUE(m_map.call_command("any_string", "").as_value() == 3);
 }
+
+TEST_F(CommandMapTest, test_profile) {
+  CMD2_ANY("test_a", &cmd_test_map_a);
+  CMD2_ANY("test_b",
+           std::bind(&cmd_test_map_b,
+                     std::placeholders::_1,
+                     std::placeholders::_2,
+                     (uint64_t)2));
+
+  const auto& profile_a = m_map.find("test_a")->second.m_profile;
+  const auto& profile_b = m_map.find("test_b")->second.m_profile;
+
+  m_map.call_command("test_a", (int64_t)1);
+  ASSERT_EQ(profile_a.m_calls.load(), 0);
+
+  m_map.set_profiling(true);
+  m_map.call_command("test_a", (int64_t)1);
+  m_map.call_command("test_a", std::string(64, 'a'));
+  m_map.call_command("test_b", (int64_t)1);
+  m_map.set_profiling(false);
+
+  ASSERT_EQ(profile_a.m_calls.load(), 2);
+  ASSERT_EQ(profile_b.m_calls.load(), 1);
+  ASSERT_GE(profile_a.m_time.load(), profile_a.m_timeMax.load());
+#ifdef RT_USE_ALLOCATION_COUNT
+  ASSERT_GE(profile_a.m_allocations.load(), 1);
+#else
+  ASSERT_EQ(profile_a.m_allocations.load(), 0);
+#endif
+
+  m_map.profile_reset();
+
+  ASSERT_EQ(profile_a.m_calls.load(), 0);
+  ASSERT_EQ(profile_a.m_time.load(), 0);
+  ASSERT_EQ(profile_a.m_timeMax.load(), 0);
+  ASSERT_EQ(profile_a.m_allocations.load(), 0);
+}
+
+TEST_F(CommandMapTest, test_modifier) {
+  CMD2_ANY("test_a.set", &cmd_test_map_a);
+  CMD2_ANY("test_modify", &cmd_test_map_a);
+
+  std::vector<void*> modified;
+
+  m_map.slot_modified() = [&modified](const rpc::target_type& target) {
+    modified.push_back(std::get<1>(target));
+  };
+
+  core::Download* download = reinterpret_cast<core::Download*>(m_commands);
+
+  // The key alone does not make a command a modifier.
+  m_map.call_command_d("test_a.set", download, (int64_t)1);
+  ASSERT_TRUE(modified.empty());
+
+  m_map.set_modifier("test_modify");
+  m_map.call_command_d("test_modify", download, (int64_t)1);
+
+  ASSERT_EQ(modified.size(), 1);
+  ASSERT_EQ(modified.front(), download);
+
+  ASSERT_THROW(m_map.set_modifier("test_missing"), torrent::internal_error);
+}
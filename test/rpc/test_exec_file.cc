@@ -0,0 +1,182 @@
+#include "test/rpc/exec_file_test.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <torrent/exceptions.h>
+#include <unistd.h>
+
+#include "command_helpers.h"
+
+std::vector<torrent::Object::list_type> ExecFileTest::callbacks;
+
+void
+ExecFileTest::SetUp() {
+  torrent::thread_base::acquire_global_lock();
+
+  m_poll = ExecWatcherTest::create_poll();
+  ASSERT_NE(m_poll, nullptr);
+
+  m_exec.set_poll(m_poll);
+  callbacks.clear();
+
+  if (rpc::commands.find("test_exec_file.done") == rpc::commands.end())
+    CMD2_ANY_LIST("test_exec_file.done", [](const auto&, const auto& args) {
+      callbacks.push_back(args);
+      return torrent::Object();
+    });
+}
+
+void
+ExecFileTest::TearDown() {
+  m_exec.cleanup();
+
+  delete m_poll;
+  m_poll = nullptr;
+
+  torrent::thread_base::release_global_lock();
+}
+
+bool
+ExecFileTest::wait_pending() {
+  for (int i = 0; i < 100 && m_exec.pending() != 0; i++)
+    m_poll->do_poll(50000, torrent::Poll::poll_worker_thread);
+
+  return m_exec.pending() == 0;
+}
+
+TEST_F(ExecFileTest, test_capture) {
+  auto result = execute({ "sh", "-c", "echo foo; echo bar >&2" },
+                        rpc::ExecFile::flag_capture);
+
+  ASSERT_EQ(result.as_string(), "foo\n");
+}
+
+TEST_F(ExecFileTest, test_status) {
+  ASSERT_EQ(execute({ "sh", "-c", "exit 0" }, 0).as_value(), 0);
+  ASSERT_NE(execute({ "sh", "-c", "exit 3" }, 0).as_value(), 0);
+
+  ASSERT_THROW(execute({ "sh", "-c", "exit 3" }, rpc::ExecFile::flag_throw),
+               torrent::input_error);
+}
+
+TEST_F(ExecFileTest, test_not_found) {
+  ASSERT_NE(execute({ "/nonexistent/rtorrent-test" }, 0).as_value(), 0);
+
+  ASSERT_THROW(execute({ "/nonexistent/rtorrent-test" },
+                       rpc::ExecFile::flag_throw),
+               torrent::input_error);
+}
+
+TEST_F(ExecFileTest, test_close_descriptors) {
+  int fd = ::open("/dev/null", O_RDONLY);
+  ASSERT_NE(fd, -1);
+
+  // Not close-on-exec, so only the spawn may close it.
+  int high = ::dup2(fd, 100);
+  ::close(fd);
+  ASSERT_EQ(high, 100);
+
+  auto result =
+    execute({ "sh", "-c", "test -e /dev/fd/100 && echo open || echo closed" },
+            rpc::ExecFile::flag_capture);
+
+  ::close(high);
+
+  ASSERT_EQ(result.as_string(), "closed\n");
+}
+
+TEST_F(ExecFileTest, test_async) {
+  auto pid =
+    execute_async({ "test_exec_file.done", "sh", "-c", "echo foo; exit 2" }, 0);
+
+  ASSERT_GT(pid.as_value(), 0);
+  ASSERT_EQ(m_exec.pending(), 1);
+  ASSERT_TRUE(wait_pending());
+
+  ASSERT_EQ(callbacks.size(), 1);
+  ASSERT_EQ(callbacks[0].size(), 2);
+  ASSERT_EQ(WEXITSTATUS(callbacks[0][0].as_value()), 2);
+  ASSERT_EQ(callbacks[0][1].as_string(), "");
+}
+
+TEST_F(ExecFileTest, test_async_capture) {
+  execute_async({ "test_exec_file.done", "sh", "-c", "echo foo; echo bar >&2" },
+                rpc::ExecFile::flag_capture);
+
+  ASSERT_TRUE(wait_pending());
+
+  ASSERT_EQ(callbacks.size(), 1);
+  ASSERT_EQ(callbacks[0][0].as_value(), 0);
+  ASSERT_EQ(callbacks[0][1].as_string(), "foo\n");
+}
+
+TEST_F(ExecFileTest, test_async_no_callback) {
+  execute_async({ "", "sh", "-c", "exit 0" }, rpc::ExecFile::flag_capture);
+
+  ASSERT_TRUE(wait_pending());
+  ASSERT_TRUE(callbacks.empty());
+}
+
+TEST_F(ExecFileTest, test_async_errors) {
+  ASSERT_THROW(execute_async({ "test_exec_file.missing", "true" }, 0),
+               torrent::input_error);
+  ASSERT_THROW(execute_async({ "test_exec_file.done" }, 0),
+               torrent::input_error);
+
+  ASSERT_EQ(m_exec.pending(), 0);
+}
+
+TEST_F(ExecFileTest, test_background) {
+  char path[] = "/tmp/rtorrent-test-XXXXXX";
+  int  fd     = ::mkstemp(path);
+  ASSERT_NE(fd, -1);
+  ::close(fd);
+
+  int logFds[2];
+  ASSERT_EQ(::pipe(logFds), 0);
+  m_exec.set_log_fd(logFds[1]);
+
+  std::string command = "printf 'out%s' put; echo done > " + std::string(path);
+
+  auto result = execute({ "sh", "-c", command.c_str() },
+                        rpc::ExecFile::flag_background);
+
+  m_exec.set_log_fd(-1);
+  ::close(logFds[1]);
+
+  ASSERT_EQ(result.as_value(), 0);
+
+  // The detached task is no child of ours, and the intermediate one has
+  // been reaped.
+  errno = 0;
+  ASSERT_EQ(::waitpid(-1, nullptr, WNOHANG), -1);
+  ASSERT_EQ(errno, ECHILD);
+
+  struct stat st {};
+
+  for (int i = 0; i < 100; i++) {
+    if (::stat(path, &st) == 0 && st.st_size != 0)
+      break;
+
+    ::usleep(50000);
+  }
+
+  ::unlink(path);
+  ASSERT_NE(st.st_size, 0);
+
+  // Its output goes to /dev/null rather than the log.
+  std::string log;
+  char        buffer[256];
+  ssize_t     length;
+
+  while ((length = ::read(logFds[0], buffer, sizeof(buffer))) > 0)
+    log.append(buffer, length);
+
+  ::close(logFds[0]);
+
+  ASSERT_NE(log.find("Background task"), std::string::npos);
+  ASSERT_EQ(log.find("output"), std::string::npos);
+}
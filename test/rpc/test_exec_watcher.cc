@@ -0,0 +1,118 @@
+#include "test/rpc/exec_watcher_test.h"
+
+#include <algorithm>
+#include <csignal>
+#include <sys/wait.h>
+#include <torrent/poll_epoll.h>
+#include <torrent/poll_select.h>
+#include <unistd.h>
+#include <vector>
+
+void
+ExecWatcherTest::SetUp() {
+  m_poll = create_poll();
+  ASSERT_NE(m_poll, nullptr);
+
+  m_watcher.set_poll(m_poll);
+}
+
+void
+ExecWatcherTest::TearDown() {
+  m_watcher.cleanup();
+
+  delete m_poll;
+  m_poll = nullptr;
+}
+
+pid_t
+ExecWatcherTest::start(const char* command, std::FILE* output) {
+  std::fflush(nullptr);
+
+  pid_t pid = fork();
+
+  if (pid != 0)
+    return pid;
+
+  if (output != nullptr)
+    dup2(fileno(output), 1);
+
+  execlp("sh", "sh", "-c", command, nullptr);
+  _exit(127);
+}
+
+bool
+ExecWatcherTest::wait_all(torrent::Poll* poll, rpc::ExecWatcher* watcher) {
+  for (int i = 0; i < 100 && watcher->size() != 0; i++)
+    poll->do_poll(50000, torrent::Poll::poll_worker_thread);
+
+  return watcher->size() == 0;
+}
+
+torrent::Poll*
+ExecWatcherTest::create_poll() {
+  torrent::Poll* poll = torrent::PollEPoll::create(256);
+
+  return poll != nullptr ? poll : torrent::PollSelect::create(256);
+}
+
+TEST_F(ExecWatcherTest, test_status) {
+  std::vector<int> statuses;
+
+  for (const char* command : { "exit 0", "sleep 0.1; exit 3", "exit 7" })
+    m_watcher.insert(start(command),
+                     nullptr,
+                     [&statuses](int status, const std::string& output) {
+                       ASSERT_TRUE(output.empty());
+                       statuses.push_back(WEXITSTATUS(status));
+                     });
+
+  ASSERT_EQ(m_watcher.size(), 3);
+  ASSERT_TRUE(wait_all(m_poll, &m_watcher));
+
+  std::sort(statuses.begin(), statuses.end());
+  ASSERT_EQ(statuses, std::vector<int>({ 0, 3, 7 }));
+}
+
+TEST_F(ExecWatcherTest, test_output) {
+  std::FILE* output = std::tmpfile();
+  ASSERT_NE(output, nullptr);
+
+  std::string captured;
+
+  m_watcher.insert(start("echo foo; echo bar", output),
+                   output,
+                   [&captured](int, const std::string& output) {
+                     captured = output;
+                   });
+
+  ASSERT_TRUE(wait_all(m_poll, &m_watcher));
+  ASSERT_EQ(captured, "foo\nbar\n");
+}
+
+TEST_F(ExecWatcherTest, test_insert_from_slot) {
+  int done = 0;
+
+  m_watcher.insert(start("exit 0"), nullptr, [this, &done](int, const auto&) {
+    done++;
+    m_watcher.insert(
+      start("exit 0"), nullptr, [&done](int, const auto&) { done++; });
+  });
+
+  ASSERT_TRUE(wait_all(m_poll, &m_watcher));
+  ASSERT_EQ(done, 2);
+}
+
+TEST_F(ExecWatcherTest, test_cleanup) {
+  bool  called = false;
+  pid_t pid    = start("sleep 10");
+
+  m_watcher.insert(
+    pid, nullptr, [&called](int, const auto&) { called = true; });
+  m_watcher.cleanup();
+
+  ASSERT_EQ(m_watcher.size(), 0);
+
+  ::kill(pid, SIGKILL);
+  ASSERT_EQ(::waitpid(pid, nullptr, 0), pid);
+  ASSERT_FALSE(called);
+}
@@ -0,0 +1,63 @@
+#include "test/rpc/metrics_test.h"
+
+#include <string>
+
+namespace {
+
+// The sample of 'name' with the given labels, or an empty string.
+std::string
+find_sample(const std::string& out, const std::string& sample) {
+  auto pos = out.find("\n" + sample + " ");
+
+  if (pos == std::string::npos)
+    return std::string();
+
+  pos += sample.size() + 2;
+  return out.substr(pos, out.find('\n', pos) - pos);
+}
+
+}
+
+TEST_F(MetricsTest, test_family) {
+  std::string out;
+
+  rpc::Metrics::append_family(&out, "rtorrent_test", "gauge", "A test.");
+  rpc::Metrics::append_sample(&out, "rtorrent_test", -42);
+  rpc::Metrics::append_sample(
+    &out, "rtorrent_test", 7, rpc::Metrics::label("view", "main"));
+
+  ASSERT_EQ(out,
+            "# HELP rtorrent_test A test.\n"
+            "# TYPE rtorrent_test gauge\n"
+            "rtorrent_test -42\n"
+            "rtorrent_test{view=\"main\"} 7\n");
+}
+
+TEST_F(MetricsTest, test_label) {
+  ASSERT_EQ(rpc::Metrics::label("view", ""), "view=\"\"");
+  ASSERT_EQ(rpc::Metrics::label("view", "a\"b\\c\nd"),
+            "view=\"a\\\"b\\\\c\\nd\"");
+}
+
+TEST_F(MetricsTest, test_count_request) {
+  std::string before;
+  rpc::Metrics::render_rpc(&before);
+
+  rpc::Metrics::count_request(rpc::SCgiTask::ContentType::JSON, 100, 200, true);
+  rpc::Metrics::count_request(rpc::SCgiTask::ContentType::JSON, 10, 0, false);
+
+  std::string after;
+  rpc::Metrics::render_rpc(&after);
+
+  const auto delta = [&](const std::string& sample) {
+    return std::stoll(find_sample(after, sample)) -
+           std::stoll(find_sample(before, sample));
+  };
+
+  ASSERT_EQ(delta("rtorrent_rpc_requests_total{type=\"json\"}"), 2);
+  ASSERT_EQ(delta("rtorrent_rpc_failed_total{type=\"json\"}"), 1);
+  ASSERT_EQ(delta("rtorrent_rpc_request_bytes_total{type=\"json\"}"), 110);
+  ASSERT_EQ(delta("rtorrent_rpc_response_bytes_total{type=\"json\"}"), 200);
+  ASSERT_EQ(delta("rtorrent_rpc_requests_total{type=\"xml\"}"), 0);
+  ASSERT_EQ(delta("rtorrent_rpc_requests_total{type=\"metrics\"}"), 0);
+}
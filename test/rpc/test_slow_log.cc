@@ -0,0 +1,114 @@
+#include "test/rpc/slow_log_test.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+void
+slow_request(const char* method, uint64_t request_size) {
+  rpc::SlowLog::begin_request(request_size);
+  rpc::SlowLog::add_lock_wait(10);
+  rpc::SlowLog::add_call(method, true, 100, 20);
+  rpc::SlowLog::set_response_size(2 * request_size);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  rpc::SlowLog::end_request();
+}
+
+}
+
+TEST_F(SlowLogTest, test_request) {
+  slow_request("d.name", 100);
+
+  auto entries = rpc::SlowLog::entries();
+  ASSERT_EQ(entries.size(), 1);
+
+  const auto& entry = entries.front();
+  ASSERT_EQ(entry.method, "d.name");
+  ASSERT_EQ(entry.calls, 1);
+  ASSERT_EQ(entry.targets, 1);
+  ASSERT_EQ(entry.request_size, 100);
+  ASSERT_EQ(entry.response_size, 200);
+  ASSERT_EQ(entry.lock_wait, 10);
+  ASSERT_EQ(entry.execution, 100);
+  ASSERT_EQ(entry.serialization, 20);
+  ASSERT_GE(entry.total, 1000);
+  ASSERT_NE(entry.time, 0);
+}
+
+TEST_F(SlowLogTest, test_threshold) {
+  rpc::SlowLog::set_threshold(0);
+  slow_request("d.name", 100);
+
+  rpc::SlowLog::set_threshold(60 * 1000000);
+  slow_request("d.name", 100);
+
+  ASSERT_TRUE(rpc::SlowLog::entries().empty());
+}
+
+TEST_F(SlowLogTest, test_multicall) {
+  rpc::SlowLog::begin_request(100);
+  rpc::SlowLog::add_call("d.name", true, 1, 1);
+  rpc::SlowLog::add_call("d.size_bytes", true, 1, 1);
+  rpc::SlowLog::add_call("system.time", false, 1, 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  rpc::SlowLog::end_request();
+
+  auto entries = rpc::SlowLog::entries();
+  ASSERT_EQ(entries.size(), 1);
+  ASSERT_EQ(entries.front().method, "system.multicall");
+  ASSERT_EQ(entries.front().calls, 3);
+  ASSERT_EQ(entries.front().targets, 2);
+  ASSERT_EQ(entries.front().execution, 3);
+}
+
+TEST_F(SlowLogTest, test_max_size) {
+  rpc::SlowLog::set_max_size(2);
+
+  slow_request("first", 1);
+  slow_request("second", 2);
+  slow_request("third", 3);
+
+  auto entries = rpc::SlowLog::entries();
+  ASSERT_EQ(entries.size(), 2);
+  ASSERT_EQ(entries.front().method, "second");
+  ASSERT_EQ(entries.back().method, "third");
+}
+
+TEST_F(SlowLogTest, test_file) {
+  char path[] = "/tmp/rtorrent_test_slow_log_XXXXXX";
+  int  fd     = ::mkstemp(path);
+  ASSERT_NE(fd, -1);
+  ::close(fd);
+
+  rpc::SlowLog::set_file(path);
+  ASSERT_EQ(rpc::SlowLog::file(), path);
+
+  slow_request("d.name", 100);
+  slow_request("d.\"quoted\"", 100);
+
+  // Closing writes what is pending.
+  rpc::SlowLog::set_file("");
+  ASSERT_EQ(rpc::SlowLog::file(), "");
+
+  std::ifstream     file(path);
+  std::stringstream content;
+  content << file.rdbuf();
+
+  auto entries = rpc::SlowLog::entries();
+  ASSERT_EQ(content.str(),
+            rpc::SlowLog::format(entries[0]) +
+              rpc::SlowLog::format(entries[1]));
+  ASSERT_EQ(content.str().rfind("{\"time\":", 0), 0);
+  ASSERT_NE(content.str().find("\"method\":\"d.\\\"quoted\\\"\""),
+            std::string::npos);
+
+  std::remove(path);
+}
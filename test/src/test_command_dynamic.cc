@@ -13,11 +13,13 @@ initialize_command_dynamic();
 
 void
 CommandDynamicTest::SetUp() {
-  if (rpc::commands.empty()) {
+  if (control == nullptr) {
     setlocale(LC_ALL, "");
     cachedTime = torrent::utils::timer::current();
     control    = new Control;
+  }
 
+  if (rpc::commands.find("method.insert") == rpc::commands.end()) {
     initialize_command_logic();
     initialize_command_dynamic();
   }
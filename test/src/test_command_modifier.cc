@@ -0,0 +1,67 @@
+#include "control.h"
+#include "globals.h"
+#include "rpc/parse_commands.h"
+#include "test/src/command_modifier_test.h"
+
+void
+initialize_command_download();
+void
+initialize_command_file();
+void
+initialize_command_tracker();
+
+void
+CommandModifierTest::SetUp() {
+  if (control == nullptr) {
+    setlocale(LC_ALL, "");
+    cachedTime = torrent::utils::timer::current();
+    control    = new Control;
+  }
+
+  if (rpc::commands.find("d.name") == rpc::commands.end()) {
+    initialize_command_download();
+    initialize_command_file();
+    initialize_command_tracker();
+  }
+}
+
+static bool
+is_modifier(const char* key) {
+  auto itr = rpc::commands.find(key);
+
+  return itr != rpc::commands.end() &&
+         (itr->second.m_flags & rpc::CommandMap::flag_modifier);
+}
+
+TEST_F(CommandModifierTest, test_download) {
+  for (const char* key : { "d.views.push_back",
+                           "d.views.push_back_unique",
+                           "d.views.remove",
+                           "d.tracker.insert",
+                           "d.delete_tied",
+                           "d.custom.set",
+                           "d.custom1.set",
+                           "d.directory.set",
+                           "d.priority.set",
+                           "d.throttle_name.set",
+                           "d.tied_to_file.set",
+                           "d.timestamp.started.set_if_z" })
+    ASSERT_TRUE(is_modifier(key)) << key;
+
+  for (const char* key : { "d.name", "d.views", "d.views.has", "d.custom" })
+    ASSERT_FALSE(is_modifier(key)) << key;
+}
+
+TEST_F(CommandModifierTest, test_file_tracker) {
+  for (const char* key : { "f.priority.set",
+                           "f.prioritize_first.enable",
+                           "f.prioritize_last.disable",
+                           "f.set_create_queued",
+                           "t.enable",
+                           "t.disable",
+                           "t.is_enabled.set" })
+    ASSERT_TRUE(is_modifier(key)) << key;
+
+  for (const char* key : { "f.priority", "t.is_enabled", "t.url" })
+    ASSERT_FALSE(is_modifier(key)) << key;
+}
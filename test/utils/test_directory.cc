@@ -0,0 +1,96 @@
+#include "test/utils/directory_test.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <unistd.h>
+
+#include "core/download_store.h"
+
+void
+DirectoryTest::SetUp() {
+  char path[] = "/tmp/rtorrent_directory_XXXXXX";
+
+  ASSERT_NE(::mkdtemp(path), nullptr);
+  m_dir = std::string(path) + '/';
+}
+
+void
+DirectoryTest::TearDown() {
+  for (const auto& name : m_files) {
+    ::unlink((m_dir + name).c_str());
+  }
+
+  ::rmdir(m_dir.c_str());
+}
+
+void
+DirectoryTest::create_file(const std::string& name) {
+  std::ofstream(m_dir + name).put('x');
+  m_files.push_back(name);
+}
+
+static std::vector<std::string>
+list_names(const utils::DirectoryNames& names) {
+  std::vector<std::string> result;
+
+  for (size_t index = 0; index < names.size(); index++) {
+    result.emplace_back(names.name(index));
+    EXPECT_EQ(names.length(index), result.back().size());
+  }
+
+  return result;
+}
+
+TEST_F(DirectoryTest, test_missing) {
+  utils::DirectoryNames names;
+
+  ASSERT_FALSE(names.update(m_dir + "missing", 0));
+  ASSERT_TRUE(names.empty());
+}
+
+TEST_F(DirectoryTest, test_sort_hide_dot) {
+  create_file("c");
+  create_file("a");
+  create_file(".hidden");
+  create_file("b");
+
+  utils::DirectoryNames names;
+
+  ASSERT_TRUE(names.update(m_dir,
+                           utils::DirectoryNames::update_sort |
+                             utils::DirectoryNames::update_hide_dot));
+
+  ASSERT_EQ(list_names(names), std::vector<std::string>({ "a", "b", "c" }));
+}
+
+TEST_F(DirectoryTest, test_many_entries) {
+  // More than fits in a single getdents64 buffer.
+  for (int i = 0; i < 5000; i++) {
+    create_file(std::string(40, 'a') + std::to_string(i));
+  }
+
+  utils::DirectoryNames names;
+
+  ASSERT_TRUE(names.update(m_dir, utils::DirectoryNames::update_hide_dot));
+  ASSERT_EQ(names.size(), 5000u);
+}
+
+TEST_F(DirectoryTest, test_session_format) {
+  std::string hash(40, 'A');
+
+  create_file(hash + ".torrent");
+  create_file(hash + ".torrent.rtorrent");
+  create_file(std::string(40, 'a') + ".torrent");
+  create_file("rtorrent.lock");
+
+  utils::DirectoryNames names;
+
+  ASSERT_TRUE(names.update(m_dir,
+                           utils::DirectoryNames::update_hide_dot,
+                           [](const char* name, size_t length) {
+                             return core::DownloadStore::is_correct_format(
+                               name, length);
+                           }));
+
+  ASSERT_EQ(list_names(names), std::vector<std::string>({ hash + ".torrent" }));
+}
@@ -0,0 +1,71 @@
+#include "test/utils/lock_stats_test.h"
+
+TEST_F(LockStatsTest, test_bucket) {
+  ASSERT_EQ(utils::LockStats::bucket(0), 0);
+  ASSERT_EQ(utils::LockStats::bucket(1), 1);
+  ASSERT_EQ(utils::LockStats::bucket(2), 2);
+  ASSERT_EQ(utils::LockStats::bucket(3), 2);
+  ASSERT_EQ(utils::LockStats::bucket(4), 3);
+  ASSERT_EQ(utils::LockStats::bucket(1023), 10);
+  ASSERT_EQ(utils::LockStats::bucket(1024), 11);
+  ASSERT_EQ(utils::LockStats::bucket(UINT64_MAX),
+            utils::LockStats::histogram_size - 1);
+}
+
+TEST_F(LockStatsTest, test_hold) {
+  utils::LockStats::begin_hold("main");
+  utils::LockStats::end_hold();
+  utils::LockStats::begin_hold("main");
+  utils::LockStats::end_hold();
+
+  // Not holding, nothing to record.
+  utils::LockStats::end_hold();
+
+  const auto& entries = utils::LockStats::entries();
+  ASSERT_EQ(entries.size(), 1);
+
+  const auto& entry = entries.at("main");
+  ASSERT_EQ(entry.hold_count, 2);
+  ASSERT_EQ(entry.wait_count, 0);
+  ASSERT_GE(entry.hold_max * 2, entry.hold_total);
+
+  uint64_t histogram_count = 0;
+
+  for (auto count : entry.hold_histogram)
+    histogram_count += count;
+
+  ASSERT_EQ(histogram_count, 2);
+}
+
+TEST_F(LockStatsTest, test_acquirer) {
+  utils::LockStats::begin_hold("rpc");
+  utils::LockStats::set_acquirer("d.name");
+  utils::LockStats::set_acquirer("d.name");
+  utils::LockStats::end_hold();
+
+  utils::LockStats::begin_hold("rpc");
+  utils::LockStats::set_acquirer("d.name");
+  utils::LockStats::set_acquirer("d.size_bytes");
+  utils::LockStats::end_hold();
+
+  const auto& entries = utils::LockStats::entries();
+  ASSERT_EQ(entries.size(), 2);
+  ASSERT_EQ(entries.at("d.name").hold_count, 1);
+  ASSERT_EQ(entries.at("system.multicall").hold_count, 1);
+  ASSERT_EQ(entries.count("rpc"), 0);
+}
+
+TEST_F(LockStatsTest, test_disabled) {
+  utils::LockStats::set_enabled(false);
+  utils::LockStats::begin_hold("main");
+  utils::LockStats::end_hold();
+
+  ASSERT_TRUE(utils::LockStats::entries().empty());
+
+  utils::LockStats::set_enabled(true);
+  utils::LockStats::begin_hold("main");
+  utils::LockStats::end_hold();
+  utils::LockStats::reset();
+
+  ASSERT_TRUE(utils::LockStats::entries().empty());
+}
@@ -0,0 +1,90 @@
+#include "test/utils/mpsc_queue_test.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct item_type : public utils::MpscQueueNode {
+  item_type(unsigned int p, unsigned int s)
+    : producer(p)
+    , sequence(s) {}
+
+  unsigned int producer;
+  unsigned int sequence;
+};
+
+}
+
+TEST_F(MpscQueueTest, test_empty) {
+  utils::MpscQueue<item_type> queue;
+
+  ASSERT_TRUE(queue.empty());
+  ASSERT_EQ(queue.pop(), nullptr);
+}
+
+TEST_F(MpscQueueTest, test_order) {
+  utils::MpscQueue<item_type> queue;
+  item_type                   items[] = { { 0, 0 }, { 0, 1 }, { 0, 2 } };
+
+  queue.push(&items[0]);
+  queue.push(&items[1]);
+
+  ASSERT_FALSE(queue.empty());
+  ASSERT_EQ(queue.pop(), &items[0]);
+
+  queue.push(&items[2]);
+
+  ASSERT_EQ(queue.pop(), &items[1]);
+  ASSERT_EQ(queue.pop(), &items[2]);
+  ASSERT_EQ(queue.pop(), nullptr);
+  ASSERT_TRUE(queue.empty());
+
+  // Nodes may be queued again once popped.
+  queue.push(&items[0]);
+
+  ASSERT_EQ(queue.pop(), &items[0]);
+  ASSERT_EQ(queue.pop(), nullptr);
+}
+
+TEST_F(MpscQueueTest, test_stress) {
+  constexpr unsigned int producers    = 8;
+  constexpr unsigned int per_producer = 100000;
+
+  utils::MpscQueue<item_type> queue;
+  std::vector<std::thread>    threads;
+
+  for (unsigned int p = 0; p < producers; p++) {
+    threads.emplace_back([&queue, p] {
+      for (unsigned int s = 0; s < per_producer; s++)
+        queue.push(new item_type(p, s));
+    });
+  }
+
+  // Each producer's items must arrive in order, none lost or repeated.
+  std::vector<unsigned int> next(producers, 0);
+  unsigned int              received = 0;
+
+  while (received != producers * per_producer) {
+    std::unique_ptr<item_type> item(queue.pop());
+
+    if (item == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    ASSERT_LT(item->producer, producers);
+    ASSERT_EQ(item->sequence, next[item->producer]);
+
+    next[item->producer]++;
+    received++;
+  }
+
+  for (auto& thread : threads)
+    thread.join();
+
+  ASSERT_EQ(queue.pop(), nullptr);
+  ASSERT_TRUE(queue.empty());
+}
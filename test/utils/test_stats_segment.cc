@@ -0,0 +1,209 @@
+#include "test/utils/stats_segment_test.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+
+namespace {
+
+std::vector<utils::StatsSegment::download_type>
+make_downloads(size_t count, int64_t value) {
+  std::vector<utils::StatsSegment::download_type> downloads(count);
+
+  for (size_t i = 0; i < count; i++) {
+    std::memset(downloads[i].hash, 'A' + i % 6, utils::StatsSegment::hash_size);
+    utils::StatsSegment::set_name(&downloads[i], "download");
+
+    downloads[i].flags    = utils::StatsSegment::flag_active;
+    downloads[i].peers    = i;
+    downloads[i].up_rate  = value;
+    downloads[i].up_total = value;
+  }
+
+  return downloads;
+}
+
+}
+
+TEST_F(StatsSegmentTest, test_publish) {
+  utils::StatsSegment segment;
+  ASSERT_TRUE(segment.open(m_path));
+  ASSERT_EQ(segment.path(), m_path);
+
+  utils::StatsSegment::global_type global{};
+  global.up_rate         = 100;
+  global.hash_queue_size = 3;
+
+  ASSERT_TRUE(segment.publish(7, global, make_downloads(2, 42)));
+
+  utils::StatsSegmentReader                reader;
+  utils::StatsSegmentReader::snapshot_type snapshot;
+
+  ASSERT_TRUE(reader.open(m_path));
+  ASSERT_TRUE(reader.read(&snapshot));
+
+  ASSERT_EQ(snapshot.sequence, 2);
+  ASSERT_EQ(snapshot.tick, 7);
+  ASSERT_EQ(snapshot.pid, (uint32_t)::getpid());
+  ASSERT_GT(snapshot.time, 0);
+  ASSERT_EQ(snapshot.global.up_rate, 100);
+  ASSERT_EQ(snapshot.global.hash_queue_size, 3);
+  ASSERT_EQ(snapshot.downloads.size(), 2);
+  ASSERT_EQ(snapshot.downloads[1].peers, 1);
+  ASSERT_EQ(snapshot.downloads[1].up_rate, 42);
+  ASSERT_STREQ(snapshot.downloads[1].name, "download");
+
+  // Closing removes the file, the reader keeps its mapping.
+  segment.close();
+  ASSERT_EQ(::access(m_path.c_str(), F_OK), -1);
+  ASSERT_TRUE(reader.read(&snapshot));
+  ASSERT_EQ(snapshot.tick, 7);
+}
+
+TEST_F(StatsSegmentTest, test_grow) {
+  utils::StatsSegment segment;
+  ASSERT_TRUE(segment.open(m_path));
+  ASSERT_TRUE(segment.publish(1, {}, make_downloads(1, 1)));
+
+  utils::StatsSegmentReader                reader;
+  utils::StatsSegmentReader::snapshot_type snapshot;
+
+  ASSERT_TRUE(reader.open(m_path));
+  ASSERT_TRUE(reader.read(&snapshot));
+  ASSERT_EQ(snapshot.downloads.size(), 1);
+
+  ASSERT_TRUE(segment.publish(2, {}, make_downloads(1000, 2)));
+  ASSERT_TRUE(reader.read(&snapshot));
+  ASSERT_EQ(snapshot.tick, 2);
+  ASSERT_EQ(snapshot.downloads.size(), 1000);
+  ASSERT_EQ(snapshot.downloads[999].peers, 999);
+
+  ASSERT_TRUE(segment.publish(3, {}, make_downloads(0, 3)));
+  ASSERT_TRUE(reader.read(&snapshot));
+  ASSERT_TRUE(snapshot.downloads.empty());
+}
+
+TEST_F(StatsSegmentTest, test_set_name) {
+  utils::StatsSegment::download_type download;
+
+  utils::StatsSegment::set_name(&download,
+                                std::string(utils::StatsSegment::name_size * 2,
+                                            'x'));
+
+  ASSERT_EQ(std::strlen(download.name), utils::StatsSegment::name_size - 1);
+}
+
+TEST_F(StatsSegmentTest, test_invalid) {
+  utils::StatsSegmentReader reader;
+
+  int fd = ::open(m_path.c_str(), O_WRONLY | O_CREAT, 0600);
+  ASSERT_NE(fd, -1);
+  ::close(fd);
+
+  // An empty file is not a segment.
+  ASSERT_FALSE(reader.open(m_path));
+  ASSERT_EQ(errno, EPROTO);
+  ASSERT_FALSE(reader.is_open());
+
+  ASSERT_FALSE(reader.open(m_path + ".missing"));
+  ASSERT_EQ(errno, ENOENT);
+}
+
+TEST_F(StatsSegmentTest, test_foreign_file) {
+  int fd = ::open(m_path.c_str(), O_WRONLY | O_CREAT, 0600);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(::write(fd, "not a segment", 13), 13);
+  ::close(fd);
+
+  // Files that are not segments are left alone.
+  utils::StatsSegment segment;
+  ASSERT_FALSE(segment.open(m_path));
+  ASSERT_EQ(errno, EEXIST);
+  ASSERT_FALSE(segment.is_open());
+
+  struct stat st;
+  ASSERT_EQ(::stat(m_path.c_str(), &st), 0);
+  ASSERT_EQ(st.st_size, 13);
+}
+
+TEST_F(StatsSegmentTest, test_replace) {
+  utils::StatsSegment previous;
+  ASSERT_TRUE(previous.open(m_path));
+  ASSERT_TRUE(previous.publish(1, {}, make_downloads(1, 1)));
+
+  utils::StatsSegmentReader                reader;
+  utils::StatsSegmentReader::snapshot_type snapshot;
+  ASSERT_TRUE(reader.open(m_path));
+
+  // A segment left by a previous process is replaced, and readers of
+  // the old one keep their copy.
+  utils::StatsSegment segment;
+  ASSERT_TRUE(segment.open(m_path));
+  ASSERT_TRUE(segment.publish(2, {}, make_downloads(2, 2)));
+
+  ASSERT_TRUE(reader.read(&snapshot));
+  ASSERT_EQ(snapshot.tick, 1);
+
+  // Closing the replaced segment does not remove the new file.
+  previous.close();
+  ASSERT_EQ(::access(m_path.c_str(), F_OK), 0);
+
+  utils::StatsSegmentReader current;
+  ASSERT_TRUE(current.open(m_path));
+  ASSERT_TRUE(current.read(&snapshot));
+  ASSERT_EQ(snapshot.tick, 2);
+  ASSERT_EQ(snapshot.downloads.size(), 2);
+}
+
+TEST_F(StatsSegmentTest, test_concurrent) {
+  utils::StatsSegment segment;
+  ASSERT_TRUE(segment.open(m_path));
+  ASSERT_TRUE(segment.publish(0, {}, make_downloads(0, 0)));
+
+  utils::StatsSegmentReader reader;
+  ASSERT_TRUE(reader.open(m_path));
+
+  std::atomic<bool> done{ false };
+  std::atomic<int>  torn{ 0 };
+  std::atomic<int>  reads{ 0 };
+
+  // Every snapshot published has the tick in all values, so a torn
+  // read shows up as a mismatch.
+  std::thread thread([&] {
+    utils::StatsSegmentReader::snapshot_type snapshot;
+
+    while (!done) {
+      if (!reader.read(&snapshot))
+        continue;
+
+      reads++;
+
+      if (snapshot.global.up_rate != (int64_t)snapshot.tick ||
+          snapshot.downloads.size() != snapshot.tick % 100)
+        torn++;
+
+      for (const auto& download : snapshot.downloads)
+        if (download.up_rate != (int64_t)snapshot.tick)
+          torn++;
+    }
+  });
+
+  for (uint64_t tick = 1; tick <= 20000; tick++) {
+    utils::StatsSegment::global_type global{};
+    global.up_rate = tick;
+
+    ASSERT_TRUE(
+      segment.publish(tick, global, make_downloads(tick % 100, tick)));
+  }
+
+  while (reads == 0)
+    std::this_thread::yield();
+
+  done = true;
+  thread.join();
+
+  ASSERT_EQ(torn, 0);
+}
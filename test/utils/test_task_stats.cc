@@ -0,0 +1,106 @@
+#include "test/utils/task_stats_test.h"
+
+#include <memory>
+
+namespace {
+
+const auto queued_time = torrent::utils::timer::from_seconds(1);
+const auto run_time    = torrent::utils::timer::from_seconds(2);
+
+}
+
+TEST_F(TaskStatsTest, test_perform) {
+  torrent::utils::priority_queue_default queue;
+  torrent::utils::priority_item          named;
+  torrent::utils::priority_item          unnamed;
+  torrent::utils::priority_item          later;
+
+  int calls = 0;
+
+  named.slot()   = [&calls] { calls++; };
+  unnamed.slot() = [&calls] { calls++; };
+  later.slot()   = [&calls] { calls++; };
+
+  utils::TaskStats::set_name(&named, "named");
+
+  torrent::utils::priority_queue_insert(&queue, &named, queued_time);
+  torrent::utils::priority_queue_insert(&queue, &unnamed, queued_time);
+  torrent::utils::priority_queue_insert(
+    &queue, &later, torrent::utils::timer::from_seconds(3));
+
+  utils::TaskStats::perform(&queue, run_time);
+  utils::TaskStats::erase_name(&named);
+
+  ASSERT_EQ(calls, 2);
+  ASSERT_FALSE(named.is_queued());
+  ASSERT_TRUE(later.is_queued());
+
+  const auto& entries = utils::TaskStats::entries();
+  ASSERT_EQ(entries.size(), 2);
+  ASSERT_EQ(entries.at("named").count, 1);
+
+  // The other task is named by the type of its lambda.
+  auto unnamed_entry = entries.begin()->first == "named"
+                         ? std::next(entries.begin())
+                         : entries.begin();
+  ASSERT_NE(unnamed_entry->first.find("lambda"), std::string::npos);
+
+  torrent::utils::priority_queue_erase(&queue, &later);
+}
+
+TEST_F(TaskStatsTest, test_disabled) {
+  torrent::utils::priority_queue_default queue;
+  torrent::utils::priority_item          item;
+
+  int calls = 0;
+
+  item.slot() = [&calls] { calls++; };
+
+  utils::TaskStats::set_enabled(false);
+  torrent::utils::priority_queue_insert(&queue, &item, queued_time);
+
+  utils::TaskStats::begin_tick();
+  utils::TaskStats::perform(&queue, run_time);
+  utils::TaskStats::end_tick();
+
+  ASSERT_EQ(calls, 1);
+  ASSERT_TRUE(utils::TaskStats::entries().empty());
+  ASSERT_EQ(utils::TaskStats::tick_count(), 0);
+}
+
+TEST_F(TaskStatsTest, test_task_deletes_itself) {
+  torrent::utils::priority_queue_default queue;
+
+  auto item = std::make_unique<torrent::utils::priority_item>();
+  item->slot() = [&item] { item.reset(); };
+
+  utils::TaskStats::set_name(item.get(), "self");
+  torrent::utils::priority_queue_insert(&queue, item.get(), queued_time);
+
+  utils::TaskStats::begin_tick();
+  utils::TaskStats::perform(&queue, run_time);
+  utils::TaskStats::end_tick();
+
+  ASSERT_EQ(item, nullptr);
+  ASSERT_EQ(utils::TaskStats::entries().at("self").count, 1);
+  ASSERT_EQ(utils::TaskStats::tick_count(), 1);
+}
+
+TEST_F(TaskStatsTest, test_task_resets) {
+  torrent::utils::priority_queue_default queue;
+  torrent::utils::priority_item          item;
+
+  item.slot() = [] { utils::TaskStats::reset(); };
+
+  utils::TaskStats::set_name(&item, "reset");
+  torrent::utils::priority_queue_insert(&queue, &item, queued_time);
+
+  utils::TaskStats::begin_tick();
+  utils::TaskStats::perform(&queue, run_time);
+  utils::TaskStats::end_tick();
+  utils::TaskStats::erase_name(&item);
+
+  ASSERT_TRUE(utils::TaskStats::entries().empty());
+  ASSERT_EQ(utils::TaskStats::tick_count(), 1);
+  ASSERT_NE(utils::TaskStats::report().find("ticks 1,"), std::string::npos);
+}
@@ -0,0 +1,100 @@
+#include "test/utils/trace_test.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+size_t
+count_events(const std::string& json, const std::string& name) {
+  size_t      count  = 0;
+  std::string needle = "{\"name\":\"" + name + "\",\"ph\":\"X\"";
+
+  for (auto pos = json.find(needle); pos != std::string::npos;
+       pos      = json.find(needle, pos + 1))
+    count++;
+
+  return count;
+}
+
+}
+
+TEST_F(TraceTest, test_empty) {
+  std::string json = utils::Trace::json(0, true);
+
+  ASSERT_EQ(json.rfind("{\"traceEvents\":[\n", 0), 0);
+  ASSERT_NE(json.find("\"ph\":\"M\""), std::string::npos);
+  ASSERT_EQ(json.find(",\n]"), std::string::npos);
+  ASSERT_EQ(count_events(json, "span"), 0);
+}
+
+TEST_F(TraceTest, test_span) {
+  {
+    utils::TraceSpan span("span");
+  }
+
+  utils::Trace::set_enabled(false);
+
+  {
+    utils::TraceSpan span("span");
+  }
+
+  std::string json = utils::Trace::json(0, true);
+
+  ASSERT_EQ(count_events(json, "span"), 1);
+  ASSERT_NE(json.find("\"ts\":"), std::string::npos);
+  ASSERT_NE(json.find("\"dur\":"), std::string::npos);
+}
+
+TEST_F(TraceTest, test_escape) {
+  utils::Trace::record("a\"b\\c", 1000, 2000);
+
+  std::string json = utils::Trace::json(0, true);
+
+  ASSERT_EQ(count_events(json, "a\\\"b\\\\c"), 1);
+  ASSERT_NE(json.find("\"ts\":1.000,\"dur\":1.000"), std::string::npos);
+}
+
+TEST_F(TraceTest, test_ring) {
+  for (unsigned int i = 0; i < utils::Trace::ring_size + 10; i++)
+    utils::Trace::record(i < 10 ? "old" : "new", 1000 + i, 2000 + i);
+
+  std::string json = utils::Trace::json(0, true);
+
+  ASSERT_EQ(count_events(json, "old"), 0);
+  ASSERT_EQ(count_events(json, "new"), utils::Trace::ring_size);
+
+  json = utils::Trace::json(1000 + utils::Trace::ring_size, true);
+
+  ASSERT_EQ(count_events(json, "new"), 10);
+}
+
+TEST_F(TraceTest, test_slow_request) {
+  char directory[] = "/tmp/rtorrent_test_trace_XXXXXX";
+  ASSERT_NE(::mkdtemp(directory), nullptr);
+
+  utils::Trace::set_directory(directory);
+  utils::Trace::set_slow_request(1);
+
+  // Too fast, not written.
+  utils::Trace::record_request("request", 1000, 2000);
+
+  utils::Trace::record("call", 1000, 1500000);
+  utils::Trace::record_request("request", 1000, 2000000);
+
+  std::string   path = std::string(directory) + "/trace-1000.json";
+  std::ifstream file(path);
+  ASSERT_TRUE(file.good());
+
+  std::stringstream content;
+  content << file.rdbuf();
+
+  ASSERT_EQ(count_events(content.str(), "call"), 1);
+  ASSERT_EQ(count_events(content.str(), "request"), 2);
+
+  std::remove(path.c_str());
+  ::rmdir(directory);
+}
@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2021, Contributors to the rTorrent project
+
+// Prints the statistics rtorrent publishes with 'system.stats_segment.set'.
+//
+//   rtorrent-stats [-d] [-w seconds] path
+//
+// -d also lists the downloads, -w prints again every so many seconds.
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+#include "utils/stats_segment.h"
+
+namespace {
+
+void
+print_global(const utils::StatsSegmentReader::snapshot_type& snapshot) {
+  const utils::StatsSegment::global_type& global = snapshot.global;
+
+  std::printf("pid %" PRIu32 "\n", snapshot.pid);
+  std::printf("tick %" PRIu64 "\n", snapshot.tick);
+  std::printf("time %" PRId64 "\n", snapshot.time);
+  std::printf("downloads %zu\n", snapshot.downloads.size());
+  std::printf("up_rate %" PRId64 "\n", global.up_rate);
+  std::printf("up_total %" PRId64 "\n", global.up_total);
+  std::printf("up_max_rate %" PRId64 "\n", global.up_max_rate);
+  std::printf("down_rate %" PRId64 "\n", global.down_rate);
+  std::printf("down_total %" PRId64 "\n", global.down_total);
+  std::printf("down_max_rate %" PRId64 "\n", global.down_max_rate);
+  std::printf("sockets_open %" PRId64 "\n", global.sockets_open);
+  std::printf("sockets_max %" PRId64 "\n", global.sockets_max);
+  std::printf("files_open %" PRId64 "\n", global.files_open);
+  std::printf("files_max %" PRId64 "\n", global.files_max);
+  std::printf("memory_usage %" PRId64 "\n", global.memory_usage);
+  std::printf("memory_max %" PRId64 "\n", global.memory_max);
+  std::printf("hash_queue_size %" PRId64 "\n", global.hash_queue_size);
+}
+
+void
+print_downloads(const utils::StatsSegmentReader::snapshot_type& snapshot) {
+  std::printf("\nhash\tflags\tpeers\tup_rate\tdown_rate\tbytes_done\t"
+              "size_bytes\tratio\tname\n");
+
+  for (const auto& download : snapshot.downloads)
+    std::printf("%.*s\t%c%c%c%c\t%" PRIu32 "\t%" PRId64 "\t%" PRId64
+                "\t%" PRId64 "\t%" PRId64 "\t%" PRId64 "\t%s\n",
+                (int)utils::StatsSegment::hash_size,
+                download.hash,
+                download.flags & utils::StatsSegment::flag_open ? 'O' : '-',
+                download.flags & utils::StatsSegment::flag_active ? 'A' : '-',
+                download.flags & utils::StatsSegment::flag_complete ? 'C'
+                                                                    : '-',
+                download.flags & utils::StatsSegment::flag_hashing ? 'H' : '-',
+                download.peers,
+                download.up_rate,
+                download.down_rate,
+                download.bytes_done,
+                download.size_bytes,
+                download.ratio,
+                download.name);
+}
+
+}
+
+int
+main(int argc, char** argv) {
+  bool downloads = false;
+  int  wait      = 0;
+  int  opt;
+
+  while ((opt = ::getopt(argc, argv, "dw:")) != -1) {
+    switch (opt) {
+      case 'd':
+        downloads = true;
+        break;
+      case 'w':
+        wait = std::atoi(optarg);
+        break;
+      default:
+        std::fprintf(stderr, "usage: %s [-d] [-w seconds] path\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (optind + 1 != argc) {
+    std::fprintf(stderr, "usage: %s [-d] [-w seconds] path\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  utils::StatsSegmentReader                reader;
+  utils::StatsSegmentReader::snapshot_type snapshot;
+
+  if (!reader.open(argv[optind])) {
+    std::fprintf(
+      stderr, "%s: %s: %s\n", argv[0], argv[optind], std::strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  while (true) {
+    if (!reader.read(&snapshot)) {
+      std::fprintf(stderr, "%s: %s\n", argv[0], std::strerror(errno));
+      return EXIT_FAILURE;
+    }
+
+    print_global(snapshot);
+
+    if (downloads)
+      print_downloads(snapshot);
+
+    if (wait <= 0)
+      return EXIT_SUCCESS;
+
+    std::printf("\n");
+    std::fflush(stdout);
+    ::sleep(wait);
+  }
+}